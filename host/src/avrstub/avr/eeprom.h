@@ -0,0 +1,19 @@
+#ifndef __is_included__2f6a1c3e_cd02_11f1_a4b1_02fc00000003
+#define __is_included__2f6a1c3e_cd02_11f1_a4b1_02fc00000003 1
+
+/*
+	Host stand in for avr/eeprom.h, implemented by the self test on top of
+	a RAM image of the EEPROM
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+void eeprom_read_block(void* lpDst, const void* lpSrc, size_t dwLength);
+uint8_t eeprom_read_byte(const uint8_t* lpAddress);
+uint16_t eeprom_read_word(const uint16_t* lpAddress);
+void eeprom_write_byte(uint8_t* lpAddress, uint8_t bValue);
+void eeprom_update_byte(uint8_t* lpAddress, uint8_t bValue);
+int eeprom_is_ready(void);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef __is_included__2f6a1c3e_cd02_11f1_a4b1_02fc00000002
+#define __is_included__2f6a1c3e_cd02_11f1_a4b1_02fc00000002 1
+
+/*
+	Host stand in for avr/interrupt.h - interrupt handlers become plain
+	functions the self test calls directly
+*/
+
+#define ISR(vector)						void vector(void)
+
+static inline void cli(void) { }
+static inline void sei(void) { }
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef __is_included__2f6a1c3e_cd02_11f1_a4b1_02fc00000001
+#define __is_included__2f6a1c3e_cd02_11f1_a4b1_02fc00000001 1
+
+/*
+	Host stand in for the AVR register file
+
+	Lets piezoselftest compile firmware sources on the host. Registers are
+	plain variables defined by the self test, nothing has side effects.
+*/
+
+#include <stdint.h>
+
+#define E2END							0x3FF
+
+extern volatile uint8_t SREG;
+extern volatile uint8_t TWAR;
+extern volatile uint8_t TWCR;
+extern volatile uint8_t TWDR;
+extern volatile uint8_t TWSR;
+extern volatile uint16_t TCNT1;
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef __is_included__2f6a1c3e_cd02_11f1_a4b1_02fc00000005
+#define __is_included__2f6a1c3e_cd02_11f1_a4b1_02fc00000005 1
+
+#include <stdint.h>
+
+/*
+	CRC-8-CCITT (polynomial 0x07) as documented for avr-libc
+*/
+static inline uint8_t _crc8_ccitt_update(uint8_t inCrc, uint8_t inData) {
+	uint8_t i;
+	uint8_t data = inCrc ^ inData;
+
+	for(i = 0; i < 8; i=i+1) {
+		if((data & 0x80) != 0) {
+			data = (uint8_t)((data << 1) ^ 0x07);
+		} else {
+			data = (uint8_t)(data << 1);
+		}
+	}
+	return data;
+}
+
+#endif
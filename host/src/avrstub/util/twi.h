@@ -0,0 +1,27 @@
+#ifndef __is_included__2f6a1c3e_cd02_11f1_a4b1_02fc00000004
+#define __is_included__2f6a1c3e_cd02_11f1_a4b1_02fc00000004 1
+
+/*
+	TWI status codes of util/twi.h (slave modes only)
+*/
+
+#define TW_STATUS						(TWSR & 0xF8)
+
+#define TW_SR_SLA_ACK					0x60
+#define TW_SR_ARB_LOST_SLA_ACK			0x68
+#define TW_SR_GCALL_ACK					0x70
+#define TW_SR_ARB_LOST_GCALL_ACK		0x78
+#define TW_SR_DATA_ACK					0x80
+#define TW_SR_DATA_NACK					0x88
+#define TW_SR_GCALL_DATA_ACK			0x90
+#define TW_SR_GCALL_DATA_NACK			0x98
+#define TW_SR_STOP						0xA0
+#define TW_ST_SLA_ACK					0xA8
+#define TW_ST_ARB_LOST_SLA_ACK			0xB0
+#define TW_ST_DATA_ACK					0xB8
+#define TW_ST_DATA_NACK					0xC0
+#define TW_ST_LAST_DATA					0xC8
+#define TW_NO_INFO						0xF8
+#define TW_BUS_ERROR					0x00
+
+#endif
@@ -1,7 +1,11 @@
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/types.h>
+#include <sys/sysctl.h>
 
 #include <dev/iicbus/iic.h>
 
@@ -11,6 +15,7 @@ struct i2cBusImpl {
 	struct i2cBus			obj;
 
 	int						fd;
+	int						iBusUnit;		/* Unit of the iicbus the device is attached to, -1 if unknown */
 };
 
 
@@ -90,6 +95,43 @@ static enum i2cError i2cBusImpl_i2cWrite(
 
 	return i2cE_Ok;
 }
+static enum i2cError i2cBusImpl_i2cWriteRead(
+	struct i2cBus* lpBus,
+	uint32_t devAddr,
+	uint8_t* lpData,
+	unsigned long int dwDataLength,
+	uint8_t* lpOut,
+	unsigned long int dwOutLength
+) {
+	struct i2cBusImpl* lpThis;
+	struct iic_msg msg[2];
+	struct iic_rdwr_data rdwr;
+
+	if(lpBus == NULL) {
+		return i2cE_InvalidParam;
+	}
+
+	lpThis = (struct i2cBusImpl*)(lpBus->lpReserved);
+
+	msg[0].slave = devAddr << 1;
+	msg[0].flags = 0;
+	msg[0].len   = dwDataLength;
+	msg[0].buf   = lpData;
+
+	msg[1].slave = devAddr << 1;
+	msg[1].flags = IIC_M_RD;
+	msg[1].len   = dwOutLength;
+	msg[1].buf   = lpOut;
+
+	rdwr.msgs = msg;
+	rdwr.nmsgs = 2;
+
+	if(ioctl(lpThis->fd, I2CRDWR, &rdwr) < 0) {
+		return i2cE_Failed;
+	}
+
+	return i2cE_Ok;
+}
 static enum i2cError i2cBusImpl_i2cScan(
 	struct i2cBus* lpBus,
 	i2cScan_ResultCallback lpfnCallbackDeviceFound
@@ -130,11 +172,122 @@ static enum i2cError i2cBusImpl_i2cScan(
 	return i2cE_Ok;
 }
 
+/*
+	The bus frequency is a sysctl of the iicbus (dev.iicbus.N.frequency).
+	Controllers pick up a changed value when the bus is reset
+*/
+static enum i2cError i2cBusImpl_i2cSetSpeed(
+	struct i2cBus* lpBus,
+	uint32_t dwSpeed
+) {
+	struct i2cBusImpl* lpThis;
+	char strName[64];
+	unsigned int freq = (unsigned int)dwSpeed;
+	struct iiccmd cmd;
+
+	if(lpBus == NULL) {
+		return i2cE_InvalidParam;
+	}
+	if(dwSpeed == 0) {
+		return i2cE_InvalidParam;
+	}
+
+	lpThis = (struct i2cBusImpl*)(lpBus->lpReserved);
+	if(lpThis->iBusUnit < 0) {
+		return i2cE_Failed;
+	}
+
+	snprintf(strName, sizeof(strName), "dev.iicbus.%d.frequency", lpThis->iBusUnit);
+	if(sysctlbyname(strName, NULL, NULL, &freq, sizeof(freq)) < 0) {
+		return i2cE_Failed;
+	}
+
+	memset(&cmd, 0, sizeof(cmd));
+	if(ioctl(lpThis->fd, I2CRSTCARD, &cmd) < 0) {
+		return i2cE_Failed;
+	}
+
+	return i2cE_Ok;
+}
+static enum i2cError i2cBusImpl_i2cGetSpeed(
+	struct i2cBus* lpBus,
+	uint32_t* lpSpeedOut
+) {
+	struct i2cBusImpl* lpThis;
+	char strName[64];
+	unsigned int freq;
+	size_t freqLen = sizeof(freq);
+
+	if((lpBus == NULL) || (lpSpeedOut == NULL)) {
+		return i2cE_InvalidParam;
+	}
+
+	lpThis = (struct i2cBusImpl*)(lpBus->lpReserved);
+	if(lpThis->iBusUnit < 0) {
+		return i2cE_Failed;
+	}
+
+	snprintf(strName, sizeof(strName), "dev.iicbus.%d.frequency", lpThis->iBusUnit);
+	if(sysctlbyname(strName, &freq, &freqLen, NULL, 0) < 0) {
+		return i2cE_Failed;
+	}
+
+	(*lpSpeedOut) = (uint32_t)freq;
+	return i2cE_Ok;
+}
+
+/*
+	Unit number at the end of a device or driver name (/dev/iic1, iicbus1)
+*/
+static int i2cUnitFromName(
+	char* lpName
+) {
+	size_t len = strlen(lpName);
+
+	while((len > 0) && (lpName[len-1] >= '0') && (lpName[len-1] <= '9')) {
+		len = len - 1;
+	}
+	if(lpName[len] == 0) {
+		return -1;
+	}
+	return atoi(&(lpName[len]));
+}
+/*
+	The iic device does not necessarily carry the same unit number as
+	the iicbus it is attached to - ask for its parent
+*/
+static int i2cBusUnitFromDevice(
+	char* lpDeviceName
+) {
+	char strName[64];
+	char strParent[32];
+	size_t parentLen = sizeof(strParent) - 1;
+	int iUnit = i2cUnitFromName(lpDeviceName);
+
+	if(iUnit < 0) {
+		return -1;
+	}
+
+	snprintf(strName, sizeof(strName), "dev.iic.%d.%%parent", iUnit);
+	if(sysctlbyname(strName, strParent, &parentLen, NULL, 0) < 0) {
+		return -1;
+	}
+	strParent[parentLen] = 0;
+	if(strncmp(strParent, "iicbus", 6) != 0) {
+		return -1;
+	}
+
+	return i2cUnitFromName(strParent);
+}
+
 static struct i2cBusVTBL i2cDefaultVTBL = {
 	&i2cBusImpl_i2cRelease,
 	&i2cBusImpl_i2cRead,
 	&i2cBusImpl_i2cWrite,
-	&i2cBusImpl_i2cScan
+	&i2cBusImpl_i2cScan,
+	&i2cBusImpl_i2cWriteRead,
+	&i2cBusImpl_i2cSetSpeed,
+	&i2cBusImpl_i2cGetSpeed
 };
 
 static char* i2cDefaultDevices[] = {
@@ -145,9 +298,11 @@ static char* i2cDefaultDevices[] = {
 
 enum i2cError i2cConnect(
 	struct i2cBus** lpOut,
-	char* lpBusName
+	char* lpBusName,
+	uint32_t dwBusSpeed
 ) {
 	struct i2cBusImpl* lpNew;
+	char* lpOpened = lpBusName;
 
 	if(lpOut == NULL) {
 		return i2cE_InvalidParam;
@@ -166,6 +321,7 @@ enum i2cError i2cConnect(
 		unsigned long int i;
 		for(i = 0; i < i2cDefaultDevices_LEN; i=i+1) {
 			if((lpNew->fd = open(i2cDefaultDevices[i], O_RDWR)) >= 0) {
+				lpOpened = i2cDefaultDevices[i];
 				break;
 			}
 		}
@@ -178,6 +334,15 @@ enum i2cError i2cConnect(
 
 	lpNew->obj.lpReserved = (void*)lpNew;
 	lpNew->obj.vtbl = &i2cDefaultVTBL;
+	lpNew->iBusUnit = i2cBusUnitFromDevice(lpOpened);
+
+	if(dwBusSpeed != 0) {
+		if(i2cBusImpl_i2cSetSpeed(&(lpNew->obj), dwBusSpeed) != i2cE_Ok) {
+			close(lpNew->fd);
+			free(lpNew);
+			return i2cE_Failed;
+		}
+	}
 
 	(*lpOut) = (struct i2cBus*)(&(lpNew->obj));
 	return i2cE_Ok;
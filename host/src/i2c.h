@@ -30,6 +30,30 @@ typedef enum i2cError (*i2cWrite)(
 	uint8_t* lpData,
 	unsigned long int dwDataLength
 );
+/*
+	Writes lpData and reads dwOutLength bytes after a repeated start
+	without releasing the bus in between
+*/
+typedef enum i2cError (*i2cWriteRead)(
+	struct i2cBus* lpBus,
+	uint32_t devAddr,
+	uint8_t* lpData,
+	unsigned long int dwDataLength,
+	uint8_t* lpOut,
+	unsigned long int dwOutLength
+);
+/*
+	Bus speed (SCL frequency) in Hz, e.g. 100000 for standard and 400000
+	for fast mode. Usually requires elevated privileges
+*/
+typedef enum i2cError (*i2cSetSpeed)(
+	struct i2cBus* lpBus,
+	uint32_t dwSpeed
+);
+typedef enum i2cError (*i2cGetSpeed)(
+	struct i2cBus* lpBus,
+	uint32_t* lpSpeedOut
+);
 typedef void (*i2cScan_ResultCallback)(
 	struct i2cBus* lpBus,
 	uint32_t devAddr
@@ -44,15 +68,23 @@ struct i2cBusVTBL {
 	i2cRead					read;
 	i2cWrite				write;
 	i2cScan					scan;
+	i2cWriteRead			writeRead;
+	i2cSetSpeed				setSpeed;
+	i2cGetSpeed				getSpeed;
 };
 struct i2cBus {
 	struct i2cBusVTBL*		vtbl;
 	void*					lpReserved;
 };
 
+/*
+	Opens the bus. A dwBusSpeed other than 0 sets the bus speed, 0 keeps
+	the speed currently configured for the bus
+*/
 enum i2cError i2cConnect(
 	struct i2cBus** lpOut,
-	char* lpBusName
+	char* lpBusName,
+	uint32_t dwBusSpeed
 );
 
 
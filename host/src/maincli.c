@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
 
 #include "./i2c.h"
 #include "./piezoboard.h"
@@ -23,6 +24,46 @@ static void printfUUID(struct sysUuid* lpUUID) {
 	);
 }
 
+/*
+	Parses the unsigned integer argument at argv[idx] and checks it
+	against the allowed range. Prints an error message and returns
+	false in case the argument is missing or invalid
+*/
+static bool parseUnsignedArgument(int argc, char* argv[], unsigned long int idx, unsigned long int dwMin, unsigned long int dwMax, char* lpName, unsigned long int* lpOut) {
+	if(argc <= idx) {
+		printf("Missing %s\n", lpName);
+		return false;
+	}
+	if(sscanf(argv[idx], "%lu", lpOut) != 1) {
+		printf("Invalid %s %s\n", lpName, argv[idx]);
+		return false;
+	}
+	if(((*lpOut) < dwMin) || ((*lpOut) > dwMax)) {
+		printf("Invalid %s %lu (allowed %lu-%lu)\n", lpName, (*lpOut), dwMin, dwMax);
+		return false;
+	}
+	return true;
+}
+
+/*
+	Same as parseUnsignedArgument for signed values
+*/
+static bool parseSignedArgument(int argc, char* argv[], unsigned long int idx, signed long int dwMin, signed long int dwMax, char* lpName, signed long int* lpOut) {
+	if(argc <= idx) {
+		printf("Missing %s\n", lpName);
+		return false;
+	}
+	if(sscanf(argv[idx], "%ld", lpOut) != 1) {
+		printf("Invalid %s %s\n", lpName, argv[idx]);
+		return false;
+	}
+	if(((*lpOut) < dwMin) || ((*lpOut) > dwMax)) {
+		printf("Invalid %s %ld (allowed %ld-%ld)\n", lpName, (*lpOut), dwMin, dwMax);
+		return false;
+	}
+	return true;
+}
+
 static void printUsage(int argc, char* argv[]) {
 	printf("Usage: %s [OPTIONS] [COMMANDS]\n\n", argv[0]);
 
@@ -31,6 +72,8 @@ static void printUsage(int argc, char* argv[]) {
 	printf("\t\tSets the used I2C port (ex.: /dev/iic1)\n");
 	printf("\t-tries NUMBER\n");
 	printf("\t\tSets the number of retries (default 3)\n");
+	printf("\t-speed HZ\n");
+	printf("\t\tSets the I2C bus speed (ex.: 100000 or 400000, default: keep the configured speed)\n");
 
 	printf("\nSupported commands:\n");
 
@@ -49,10 +92,71 @@ static void printUsage(int argc, char* argv[]) {
 	printf("\tgetalpha\n\t\tGet the current alpha value\n");
 	printf("\tsetalpha THRESHOLD\n\t\tSet the current alpha value (integer 0-100)\n");
 
+	printf("\tgetfilter\n\t\tGet the current filter mode and median window\n");
+	printf("\tsetfilter MODE WINDOW\n\t\tSets the filter mode and median window (1-15)\n");
+	printf("\t\t0\tMoving average (see alpha)\n");
+	printf("\t\t1\tRunning median\n");
+
+	printf("\tgetdet\n\t\tGet the current detector mode and slope parameters\n");
+	printf("\tsetdet MODE DISTANCE THRESHOLD\n\t\tSets the detector mode, slope distance (1-8 samples) and slope threshold\n");
+	printf("\t\t0\tDeviation from calibrated centerline\n");
+	printf("\t\t1\tSlope (difference over DISTANCE samples)\n");
+
+	printf("\tgetthmode\n\t\tGet the threshold mode and sigma factor\n");
+	printf("\tsetthmode MODE K\n\t\tSets the threshold mode and the sigma factor K (in tenths, 1-255)\n");
+	printf("\t\t0\tAbsolute threshold (see setth)\n");
+	printf("\t\t1\tK/10 standard deviations of the noise measured during calibration\n");
+	printf("\tnoise\n\t\tGet the noise standard deviation measured during calibration and the effective thresholds\n");
+
+	printf("\tgettrack\n\t\tGet the baseline tracking configuration\n");
+	printf("\tsettrack SHIFT MARGIN\n\t\tSets the baseline tracker time constant to 2^SHIFT samples (4-24, 0 disables)\n\t\tand the freeze margin in percent of the threshold (1-100)\n");
+	printf("\tgetqualify\n\t\tGet hysteresis and trigger qualification settings\n");
+	printf("\tsetqualify RELEASE SAMPLES CHANNELS\n\t\tSets the release threshold in percent of the threshold (1-100, 100 disables hysteresis),\n\t\tthe consecutive samples a channel has to stay above threshold (1-255)\n\t\tand the number of channels that have to qualify at the same time (1-4)\n");
+	printf("\tsetvote VOTES WINDOW\n\t\tRequires VOTES channels (1-4) to qualify within WINDOW samples per channel (0-255,\n\t\t0 requires them to be qualified at the same time)\n");
+
+	printf("\tgetsampling\n\t\tGet the current sampling configuration\n");
+	printf("\tsetsampling RATE PRESCALER FLAGS\n\t\tSets samples per second and channel (0: free running), ADC prescaler (1-7)\n\t\tand flags (1: 8 bit fast mode)\n");
+
+	printf("\tgetchannels\n\t\tGet the mask of active piezo channels\n");
+	printf("\tsetchannels MASK\n\t\tSets the mask of active piezo channels (1-15, bit 0: A0 ... bit 3: A3)\n");
+
+	printf("\tgetbiquad STAGE\n\t\tGet the number of active biquad stages and the coefficients of STAGE (0-1)\n");
+	printf("\tsetbiquad STAGES STAGE B0 B1 B2 A1 A2\n\t\tSets the number of active biquad stages (0 disables) and the Q2.14 coefficients\n\t\tof STAGE (16384 = 1.0, see piezofilter for coefficient design)\n");
+
+	printf("\tlatency\n\t\tGet last and maximum trigger latency (CPU cycles) since last query\n");
+
+	printf("\tevents\n\t\tRead and remove all trigger events recorded by the board\n");
+	printf("\tclearevents\n\t\tDiscard all recorded trigger events\n");
+
+	printf("\tcapstatus\n\t\tGet the state of the waveform capture and its memory budget\n");
+	printf("\tsetcapture POST\n\t\tSets the number of samples (all channels) recorded after the trigger\n");
+	printf("\tarm\n\t\tRestarts the waveform capture, waiting for the next trigger\n");
+	printf("\tforcetrigger\n\t\tTriggers the waveform capture immediately\n");
+	printf("\tcapdump\n\t\tPrints the frozen capture window (index, channel, ADC value)\n");
+
+	printf("\ttelemetry\n\t\tPrints the firmware telemetry counters (triggers, bus and sampling errors)\n");
+	printf("\tresettelemetry\n\t\tClears the firmware telemetry counters\n");
+	printf("\tstream ENCODING BLOCKS\n\t\tStreams BLOCKS blocks of raw samples (capture is disabled meanwhile) and prints them (block sequence, channel:value). ENCODING 0 transfers 16 bit samples, 1 packs 10 bit samples, 2 sends small deltas\n");
+	printf("\ttrace BLOCKS\n\t\tStreams BLOCKS blocks of raw samples and prints them as a trace for piezofilter (one line per conversion round, one column per active channel)\n");
+	printf("\tbench ENCODING COUNT\n\t\tMeasures the throughput of COUNT bulk stream reads at 100 kHz and 400 kHz (streaming is enabled with ENCODING meanwhile, see stream)\n");
+	printf("\tlive COUNT\n\t\tReads the live register map COUNT times without framed requests (status, raw values, averages)\n");
+
+	printf("\tprofile\n\t\tPrints cycle statistics of the ADC and TWI interrupts and the main loop (firmware built with PROFILER=1 only)\n");
+	printf("\tresetprofile\n\t\tClears the cycle statistics\n");
+	printf("\tfiltersweep SECONDS\n\t\tRuns the moving average and every median window for SECONDS each and prints the ADC interrupt cycles\n\t\t(PROFILER=1 only) and the piezo detections counted meanwhile, then restores the filter\n");
+
 	printf("\trst\n\t\tReset the board and erase EEPROM\n");
 	printf("\tcal\n\t\tExecute recalibration for baseline\n");
 
 	printf("\tst\n\t\tStore settings in EEPROM\n");
+
+	printf("\tgetsettings\n\t\tPrints the complete settings block read in a single transaction\n");
+	printf("\tsetinit SAMPLES\n\t\tSets the calibration length in samples per channel (1-65535)\n");
+	printf("\tsetdebounce MILLISECONDS\n\t\tSets the time the output stays asserted after a trigger (1-65535)\n");
+
+	printf("\ttunings\n\t\tLists the tuning profile slots holding settings\n");
+	printf("\tsavetuning SLOT\n\t\tSaves the current settings and calibration as tuning profile SLOT\n");
+	printf("\tusetuning SLOT PERSIST\n\t\tActivates tuning profile SLOT, PERSIST 1 also stores it as power up settings\n");
 }
 
 int main(int argc, char* argv[]) {
@@ -65,6 +169,7 @@ int main(int argc, char* argv[]) {
 
 	char* lpPortName = NULL;
 	unsigned long int dwRetryCount = 3;
+	unsigned long int dwBusSpeed = 0;
 
 	if(argc < 2) {
 		printUsage(argc, argv);
@@ -89,6 +194,9 @@ int main(int argc, char* argv[]) {
 			if(argc <= (i+1)) { printf("Missing number of retries\n"); printUsage(argc, argv); return 1; }
 			if(sscanf(argv[i+1], "%lu", &dwRetryCount) != 1) { printf("Invalid retry count %s\n", argv[i+1]); printUsage(argc, argv); return 1; }
 			i = i + 1;
+		} else if(strcmp(argv[i], "-speed") == 0) {
+			if(!parseUnsignedArgument(argc, argv, i+1, 10000, PIEZOBOARD_BUS_SPEED_FAST, "bus speed", &dwBusSpeed)) { printUsage(argc, argv); return 1; }
+			i = i + 1;
 		} else if(strcmp(argv[i], "id") == 0) { continue; }
 		else if(strcmp(argv[i], "getth") == 0) { continue; }
 		else if(strcmp(argv[i], "setth") == 0) { i = i + 1; continue; }
@@ -96,9 +204,50 @@ int main(int argc, char* argv[]) {
 		else if(strcmp(argv[i], "setalpha") == 0) { i = i + 1; continue; }
 		else if(strcmp(argv[i], "gettrig") == 0) { continue; }
 		else if(strcmp(argv[i], "settrig") == 0) { i = i + 1; continue; }
+		else if(strcmp(argv[i], "getfilter") == 0) { continue; }
+		else if(strcmp(argv[i], "setfilter") == 0) { i = i + 2; continue; }
+		else if(strcmp(argv[i], "getdet") == 0) { continue; }
+		else if(strcmp(argv[i], "setdet") == 0) { i = i + 3; continue; }
+		else if(strcmp(argv[i], "getthmode") == 0) { continue; }
+		else if(strcmp(argv[i], "setthmode") == 0) { i = i + 2; continue; }
+		else if(strcmp(argv[i], "noise") == 0) { continue; }
+		else if(strcmp(argv[i], "gettrack") == 0) { continue; }
+		else if(strcmp(argv[i], "settrack") == 0) { i = i + 2; continue; }
+		else if(strcmp(argv[i], "getqualify") == 0) { continue; }
+		else if(strcmp(argv[i], "setqualify") == 0) { i = i + 3; continue; }
+		else if(strcmp(argv[i], "setvote") == 0) { i = i + 2; continue; }
+		else if(strcmp(argv[i], "getsampling") == 0) { continue; }
+		else if(strcmp(argv[i], "setsampling") == 0) { i = i + 3; continue; }
+		else if(strcmp(argv[i], "getchannels") == 0) { continue; }
+		else if(strcmp(argv[i], "setchannels") == 0) { i = i + 1; continue; }
+		else if(strcmp(argv[i], "getbiquad") == 0) { i = i + 1; continue; }
+		else if(strcmp(argv[i], "setbiquad") == 0) { i = i + 7; continue; }
+		else if(strcmp(argv[i], "latency") == 0) { continue; }
+		else if(strcmp(argv[i], "events") == 0) { continue; }
+		else if(strcmp(argv[i], "clearevents") == 0) { continue; }
+		else if(strcmp(argv[i], "capstatus") == 0) { continue; }
+		else if(strcmp(argv[i], "setcapture") == 0) { i = i + 1; continue; }
+		else if(strcmp(argv[i], "arm") == 0) { continue; }
+		else if(strcmp(argv[i], "forcetrigger") == 0) { continue; }
+		else if(strcmp(argv[i], "capdump") == 0) { continue; }
+		else if(strcmp(argv[i], "telemetry") == 0) { continue; }
+		else if(strcmp(argv[i], "resettelemetry") == 0) { continue; }
+		else if(strcmp(argv[i], "live") == 0) { i = i + 1; continue; }
+		else if(strcmp(argv[i], "stream") == 0) { i = i + 2; continue; }
+		else if(strcmp(argv[i], "trace") == 0) { i = i + 1; continue; }
+		else if(strcmp(argv[i], "bench") == 0) { i = i + 2; continue; }
+		else if(strcmp(argv[i], "profile") == 0) { continue; }
+		else if(strcmp(argv[i], "resetprofile") == 0) { continue; }
+		else if(strcmp(argv[i], "filtersweep") == 0) { i = i + 1; continue; }
 		else if(strcmp(argv[i], "rst") == 0) { continue; }
 		else if(strcmp(argv[i], "cal") == 0) { continue; }
 		else if(strcmp(argv[i], "st") == 0) { continue; }
+		else if(strcmp(argv[i], "getsettings") == 0) { continue; }
+		else if(strcmp(argv[i], "setinit") == 0) { i = i + 1; continue; }
+		else if(strcmp(argv[i], "setdebounce") == 0) { i = i + 1; continue; }
+		else if(strcmp(argv[i], "tunings") == 0) { continue; }
+		else if(strcmp(argv[i], "savetuning") == 0) { i = i + 1; continue; }
+		else if(strcmp(argv[i], "usetuning") == 0) { i = i + 2; continue; }
 		else {
 			printf("Unknown command %s\n", argv[i]);
 			printUsage(argc, argv);
@@ -106,7 +255,7 @@ int main(int argc, char* argv[]) {
 		}
 	}
 
-	ei2c = i2cConnect(&lpBus, lpPortName);
+	ei2c = i2cConnect(&lpBus, lpPortName, (uint32_t)dwBusSpeed);
 	if(ei2c != i2cE_Ok) {
 		printf("%s:%u Failed to connect with I2C device (%u)\n", __FILE__, __LINE__, ei2c);
 		return 1;
@@ -128,6 +277,9 @@ int main(int argc, char* argv[]) {
 		} else if(strcmp(argv[i], "-tries") == 0) {
 			i = i + 1;
 			continue;
+		} else if(strcmp(argv[i], "-speed") == 0) {
+			i = i + 1;
+			continue;
 		} else if(strcmp(argv[i], "id") == 0) {
 			struct sysUuid lpBoardUUID;
 			uint8_t boardVersion;
@@ -141,8 +293,6 @@ int main(int argc, char* argv[]) {
 
 			printf("Board UUID: "); printfUUID(&lpBoardUUID); printf("\n");
 			printf("Board Version: %u\n", boardVersion);
-
-			usleep(100*1000);
 		} else if(strcmp(argv[i], "getth") == 0) {
 			uint8_t currentThreshold;
 
@@ -154,8 +304,6 @@ int main(int argc, char* argv[]) {
 			}
 
 			printf("Current threshold: %u\n", currentThreshold);
-
-			usleep(100*1000);
 		} else if(strcmp(argv[i], "setth") == 0) {
 			unsigned long int readValue;
 			uint8_t nextThreshold;
@@ -189,8 +337,6 @@ int main(int argc, char* argv[]) {
 
 			printf("Set new threshold value %u\n", nextThreshold);
 			i = i + 1;
-
-			usleep(100*1000);
 		} else if(strcmp(argv[i], "getalpha") == 0) {
 			uint8_t currentAlpha;
 
@@ -202,8 +348,6 @@ int main(int argc, char* argv[]) {
 			}
 
 			printf("Current alpha: %u\n", currentAlpha);
-
-			usleep(100*1000);
 		} else if(strcmp(argv[i], "setalpha") == 0) {
 			unsigned long int readValue;
 			uint8_t nextAlpha;
@@ -237,8 +381,6 @@ int main(int argc, char* argv[]) {
 
 			printf("Set new alpha value %u\n", nextAlpha);
 			i = i + 1;
-
-			usleep(100*1000);
 		} else if(strcmp(argv[i], "gettrig") == 0) {
 			enum piezoTriggerMode currentTriggerMode;
 
@@ -256,8 +398,6 @@ int main(int argc, char* argv[]) {
 				case piezoTriggerMode_PiezoOrCapacitive:	printf("Trigger mode: Piezo or external\n"); break;
 				default:									printf("Trigger mode: Unknown\n"); break;
 			}
-
-			usleep(100*1000);
 		} else if(strcmp(argv[i], "settrig") == 0) {
 			unsigned long int readValue;
 			enum piezoTriggerMode newMode;
@@ -299,8 +439,888 @@ int main(int argc, char* argv[]) {
 
 			printf("Set new trigger mode value %u\n", newMode);
 			i = i + 1;
+		} else if(strcmp(argv[i], "getfilter") == 0) {
+			enum piezoFilterMode currentFilterMode;
+			uint8_t currentWindow;
+
+			e = lpPzb->vtbl->getFilterMode(lpPzb, &currentFilterMode, &currentWindow);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query current filter mode (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			switch(currentFilterMode) {
+				case piezoFilterMode_MovingAverage:		printf("Filter mode: Moving average\n"); break;
+				case piezoFilterMode_RunningMedian:		printf("Filter mode: Running median\n"); break;
+				default:								printf("Filter mode: Unknown\n"); break;
+			}
+			printf("Median window: %u\n", currentWindow);
+		} else if(strcmp(argv[i], "setfilter") == 0) {
+			unsigned long int readMode;
+			unsigned long int readWindow;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 0, 1, "filter mode", &readMode)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+2, 1, 15, "median window", &readWindow)) { printUsage(argc, argv); r = 1; break; }
+
+			e = lpPzb->vtbl->setFilterMode(lpPzb, (readMode == 0) ? piezoFilterMode_MovingAverage : piezoFilterMode_RunningMedian, (uint8_t)readWindow);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to set filter mode (code %u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Set filter mode %lu with window %lu\n", readMode, readWindow);
+			i = i + 2;
+		} else if(strcmp(argv[i], "getdet") == 0) {
+			enum piezoDetectorMode currentDetectorMode;
+			uint8_t currentDistance;
+			uint16_t currentSlopeThreshold;
+
+			e = lpPzb->vtbl->getDetectorMode(lpPzb, &currentDetectorMode, &currentDistance, &currentSlopeThreshold);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query current detector mode (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			switch(currentDetectorMode) {
+				case piezoDetectorMode_Deviation:		printf("Detector mode: Deviation\n"); break;
+				case piezoDetectorMode_Slope:			printf("Detector mode: Slope\n"); break;
+				default:								printf("Detector mode: Unknown\n"); break;
+			}
+			printf("Slope distance: %u\n", currentDistance);
+			printf("Slope threshold: %u\n", currentSlopeThreshold);
+		} else if(strcmp(argv[i], "setdet") == 0) {
+			unsigned long int readMode;
+			unsigned long int readDistance;
+			unsigned long int readThreshold;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 0, 1, "detector mode", &readMode)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+2, 1, 8, "slope distance", &readDistance)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+3, 0, 1023, "slope threshold", &readThreshold)) { printUsage(argc, argv); r = 1; break; }
+
+			e = lpPzb->vtbl->setDetectorMode(lpPzb, (readMode == 0) ? piezoDetectorMode_Deviation : piezoDetectorMode_Slope, (uint8_t)readDistance, (uint16_t)readThreshold);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to set detector mode (code %u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Set detector mode %lu with distance %lu and slope threshold %lu\n", readMode, readDistance, readThreshold);
+			i = i + 3;
+		} else if(strcmp(argv[i], "getthmode") == 0) {
+			enum piezoThresholdMode currentMode;
+			uint8_t currentFactor;
+
+			e = lpPzb->vtbl->getThresholdMode(lpPzb, &currentMode, &currentFactor);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query threshold mode (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			switch(currentMode) {
+				case piezoThresholdMode_Absolute:		printf("Threshold mode: absolute\n"); break;
+				case piezoThresholdMode_NoiseSigma:		printf("Threshold mode: noise sigma\n"); break;
+				default:								printf("Threshold mode: unknown (%u)\n", currentMode); break;
+			}
+			printf("Sigma factor: %u.%u\n", currentFactor / 10, currentFactor % 10);
+		} else if(strcmp(argv[i], "setthmode") == 0) {
+			unsigned long int readMode;
+			unsigned long int readFactor;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 0, 1, "threshold mode", &readMode)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+2, 1, 255, "sigma factor", &readFactor)) { printUsage(argc, argv); r = 1; break; }
+
+			e = lpPzb->vtbl->setThresholdMode(lpPzb, (enum piezoThresholdMode)readMode, (uint8_t)readFactor);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to set threshold mode (code %u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Set threshold mode %lu with sigma factor %lu\n", readMode, readFactor);
+			i = i + 2;
+		} else if(strcmp(argv[i], "noise") == 0) {
+			bool bValid;
+			bool bRestored;
+			uint16_t sigma[4];
+			uint16_t threshold[4];
+			unsigned long int iChannel;
+
+			e = lpPzb->vtbl->getNoiseStatistics(lpPzb, &bValid, &bRestored, sigma, threshold);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query noise statistics (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			if(!bValid) {
+				printf("No noise statistics available (no calibration since power up)\n");
+			} else if(bRestored) {
+				printf("Calibration restored from EEPROM and verified at power up\n");
+			}
+			for(iChannel = 0; iChannel < 4; iChannel = iChannel + 1) {
+				printf("Channel %lu: sigma %7.3f counts, threshold %7.3f counts\n",
+					iChannel,
+					((double)sigma[iChannel]) / PIEZOBOARD_FIXEDPOINT_ONE,
+					((double)threshold[iChannel]) / PIEZOBOARD_FIXEDPOINT_ONE
+				);
+			}
+		} else if(strcmp(argv[i], "gettrack") == 0) {
+			uint8_t currentShift;
+			uint8_t currentMargin;
+
+			e = lpPzb->vtbl->getBaselineTracking(lpPzb, &currentShift, &currentMargin);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query baseline tracking (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			if(currentShift == 0) {
+				printf("Baseline tracking: disabled\n");
+			} else {
+				printf("Baseline tracking: time constant %lu samples per channel\n", 1UL << currentShift);
+			}
+			printf("Freeze margin: %u%% of threshold\n", currentMargin);
+		} else if(strcmp(argv[i], "settrack") == 0) {
+			unsigned long int readShift;
+			unsigned long int readMargin;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 0, PIEZOBOARD_TRACKSHIFT_MAX, "tracker shift", &readShift)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+2, 1, 100, "freeze margin", &readMargin)) { printUsage(argc, argv); r = 1; break; }
+
+			e = lpPzb->vtbl->setBaselineTracking(lpPzb, (uint8_t)readShift, (uint8_t)readMargin);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to set baseline tracking (code %u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Set baseline tracker shift %lu, freeze margin %lu%%\n", readShift, readMargin);
+			i = i + 2;
+		} else if(strcmp(argv[i], "getqualify") == 0) {
+			uint8_t currentRelease;
+			uint8_t currentSamples;
+			uint8_t currentChannels;
+			uint8_t currentWindow;
+
+			e = lpPzb->vtbl->getQualifier(lpPzb, &currentRelease, &currentSamples, &currentChannels, &currentWindow);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query trigger qualification (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Release threshold: %u%% of threshold\n", currentRelease);
+			printf("Minimum samples above threshold: %u\n", currentSamples);
+			printf("Minimum qualified channels: %u\n", currentChannels);
+			if(currentWindow == 0) {
+				printf("Coincidence window: none (channels have to be qualified at the same time)\n");
+			} else {
+				printf("Coincidence window: %u samples per channel\n", currentWindow);
+			}
+		} else if(strcmp(argv[i], "setqualify") == 0) {
+			unsigned long int readRelease;
+			unsigned long int readSamples;
+			unsigned long int readChannels;
+			uint8_t currentWindow;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 1, 100, "release percentage", &readRelease)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+2, 1, 255, "minimum samples", &readSamples)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+3, 1, 4, "minimum channels", &readChannels)) { printUsage(argc, argv); r = 1; break; }
+
+			/* Keep the coincidence window */
+			e = lpPzb->vtbl->getQualifier(lpPzb, NULL, NULL, NULL, &currentWindow);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query trigger qualification (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			e = lpPzb->vtbl->setQualifier(lpPzb, (uint8_t)readRelease, (uint8_t)readSamples, (uint8_t)readChannels, currentWindow);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to set trigger qualification (code %u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Set release threshold %lu%%, %lu samples on %lu channels\n", readRelease, readSamples, readChannels);
+			i = i + 3;
+		} else if(strcmp(argv[i], "setvote") == 0) {
+			unsigned long int readVotes;
+			unsigned long int readWindow;
+			uint8_t currentRelease;
+			uint8_t currentSamples;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 1, 4, "votes", &readVotes)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+2, 0, 255, "coincidence window", &readWindow)) { printUsage(argc, argv); r = 1; break; }
+
+			/* Keep hysteresis and minimum samples */
+			e = lpPzb->vtbl->getQualifier(lpPzb, &currentRelease, &currentSamples, NULL, NULL);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query trigger qualification (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			e = lpPzb->vtbl->setQualifier(lpPzb, currentRelease, currentSamples, (uint8_t)readVotes, (uint8_t)readWindow);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to set channel voting (code %u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Set %lu of the active channels within %lu samples\n", readVotes, readWindow);
+			i = i + 2;
+		} else if(strcmp(argv[i], "getsampling") == 0) {
+			uint16_t currentRate;
+			uint8_t currentPrescaler;
+			uint8_t currentFlags;
+
+			e = lpPzb->vtbl->getSampling(lpPzb, &currentRate, &currentPrescaler, &currentFlags);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query sampling configuration (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			if(currentRate == 0) {
+				printf("Sample rate: free running\n");
+			} else {
+				printf("Sample rate: %u per channel\n", currentRate);
+			}
+			printf("ADC prescaler: %u (/%u)\n", currentPrescaler, 1 << currentPrescaler);
+			printf("8 bit fast mode: %s\n", ((currentFlags & PIEZOBOARD_SAMPLINGFLAG__FAST8BIT) != 0) ? "yes" : "no");
+		} else if(strcmp(argv[i], "setsampling") == 0) {
+			unsigned long int readRate;
+			unsigned long int readPrescaler;
+			unsigned long int readFlags;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 0, 65535, "sample rate", &readRate)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+2, 1, 7, "ADC prescaler", &readPrescaler)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+3, 0, 1, "sampling flags", &readFlags)) { printUsage(argc, argv); r = 1; break; }
+
+			e = lpPzb->vtbl->setSampling(lpPzb, (uint16_t)readRate, (uint8_t)readPrescaler, (uint8_t)readFlags);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to set sampling configuration (code %u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Set sample rate %lu, prescaler %lu, flags %lu\n", readRate, readPrescaler, readFlags);
+			i = i + 3;
+		} else if(strcmp(argv[i], "getchannels") == 0) {
+			uint8_t currentMask;
+
+			e = lpPzb->vtbl->getActiveChannels(lpPzb, &currentMask);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query active channels (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Active channels: 0x%02x (A0: %s, A1: %s, A2: %s, A3: %s)\n",
+				currentMask,
+				((currentMask & 0x01) != 0) ? "on" : "off",
+				((currentMask & 0x02) != 0) ? "on" : "off",
+				((currentMask & 0x04) != 0) ? "on" : "off",
+				((currentMask & 0x08) != 0) ? "on" : "off"
+			);
+		} else if(strcmp(argv[i], "setchannels") == 0) {
+			unsigned long int readMask;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 1, 15, "channel mask", &readMask)) { printUsage(argc, argv); r = 1; break; }
+
+			e = lpPzb->vtbl->setActiveChannels(lpPzb, (uint8_t)readMask);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to set active channels (code %u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Set active channel mask 0x%02lx\n", readMask);
+			i = i + 1;
+		} else if(strcmp(argv[i], "getbiquad") == 0) {
+			unsigned long int readStage;
+			uint8_t currentStages;
+			struct piezoBiquadCoefficients currentCoefficients;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 0, PIEZOBOARD_BIQUAD_STAGES_MAX-1, "biquad stage", &readStage)) { printUsage(argc, argv); r = 1; break; }
+
+			e = lpPzb->vtbl->getBiquad(lpPzb, (uint8_t)readStage, &currentStages, &currentCoefficients);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query biquad stage (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Active biquad stages: %u\n", currentStages);
+			printf("Stage %lu: b0 %d, b1 %d, b2 %d, a1 %d, a2 %d (%s)\n",
+				readStage,
+				currentCoefficients.b0, currentCoefficients.b1, currentCoefficients.b2,
+				currentCoefficients.a1, currentCoefficients.a2,
+				(readStage < currentStages) ? "active" : "inactive"
+			);
+			i = i + 1;
+		} else if(strcmp(argv[i], "setbiquad") == 0) {
+			unsigned long int readStages;
+			unsigned long int readStage;
+			signed long int readCoefficients[5];
+			struct piezoBiquadCoefficients newCoefficients;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 0, PIEZOBOARD_BIQUAD_STAGES_MAX, "number of biquad stages", &readStages)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+2, 0, PIEZOBOARD_BIQUAD_STAGES_MAX-1, "biquad stage", &readStage)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseSignedArgument(argc, argv, i+3, -32768, 32767, "coefficient b0", &(readCoefficients[0]))) { printUsage(argc, argv); r = 1; break; }
+			if(!parseSignedArgument(argc, argv, i+4, -32768, 32767, "coefficient b1", &(readCoefficients[1]))) { printUsage(argc, argv); r = 1; break; }
+			if(!parseSignedArgument(argc, argv, i+5, -32768, 32767, "coefficient b2", &(readCoefficients[2]))) { printUsage(argc, argv); r = 1; break; }
+			if(!parseSignedArgument(argc, argv, i+6, -32768, 32767, "coefficient a1", &(readCoefficients[3]))) { printUsage(argc, argv); r = 1; break; }
+			if(!parseSignedArgument(argc, argv, i+7, -32768, 32767, "coefficient a2", &(readCoefficients[4]))) { printUsage(argc, argv); r = 1; break; }
+
+			newCoefficients.b0 = (int16_t)readCoefficients[0];
+			newCoefficients.b1 = (int16_t)readCoefficients[1];
+			newCoefficients.b2 = (int16_t)readCoefficients[2];
+			newCoefficients.a1 = (int16_t)readCoefficients[3];
+			newCoefficients.a2 = (int16_t)readCoefficients[4];
+
+			e = lpPzb->vtbl->setBiquad(lpPzb, (uint8_t)readStages, (uint8_t)readStage, &newCoefficients);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to set biquad stage (code %u, unstable or too large coefficients are rejected)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Set biquad stage %lu, %lu stages active\n", readStage, readStages);
+			i = i + 7;
+		} else if(strcmp(argv[i], "latency") == 0) {
+			uint16_t latencyLast;
+			uint16_t latencyMax;
+
+			e = lpPzb->vtbl->getTriggerLatency(lpPzb, &latencyLast, &latencyMax);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query trigger latency (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Last trigger latency: %u cycles\n", latencyLast);
+			printf("Maximum trigger latency: %u cycles\n", latencyMax);
+		} else if(strcmp(argv[i], "events") == 0) {
+			struct piezoEvent event;
+			uint8_t bPending;
+			uint8_t bLost;
+			unsigned long int iChannel;
+
+			for(;;) {
+				e = lpPzb->vtbl->readEvent(lpPzb, true, &event, &bPending, &bLost);
+				if(e != piezoE_Ok) {
+					printf("%s:%u Failed to read event (%u)\n", __FILE__, __LINE__, e);
+					r = 2;
+					break;
+				}
+				if(bPending == 0) {
+					break;
+				}
+
+				printf("Event at %lu us: mode %u, first channel %u, output %s\n",
+					(unsigned long int)event.dwTimestamp,
+					event.triggerMode,
+					event.bFirstChannel,
+					((event.bFlags & PIEZOBOARD_EVENTFLAG__FIRED) != 0) ? "asserted" : "not asserted"
+				);
+				for(iChannel = 0; iChannel < 4; iChannel = iChannel + 1) {
+					if(event.bCrossOffset[iChannel] == PIEZOBOARD_EVENT_OFFSET_NONE) {
+						printf("\tChannel %lu: peak %7.3f counts, not crossed\n", iChannel, ((double)event.peakDeviation[iChannel]) / PIEZOBOARD_FIXEDPOINT_ONE);
+					} else {
+						printf("\tChannel %lu: peak %7.3f counts, crossed after %u conversions\n", iChannel, ((double)event.peakDeviation[iChannel]) / PIEZOBOARD_FIXEDPOINT_ONE, event.bCrossOffset[iChannel]);
+					}
+				}
+
+			}
+			if(r != 0) {
+				break;
+			}
+			if(bLost != 0) {
+				printf("%u events have been lost due to a full event log\n", bLost);
+			}
+		} else if(strcmp(argv[i], "clearevents") == 0) {
+			e = lpPzb->vtbl->clearEvents(lpPzb);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to clear events (code %u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+			printf("Cleared event log\n");
+		} else if(strcmp(argv[i], "capstatus") == 0) {
+			struct piezoCaptureStatus status;
+
+			e = lpPzb->vtbl->getCaptureStatus(lpPzb, &status);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query capture status (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			switch(status.state) {
+				case piezoCaptureState_Armed:		printf("Capture state: armed\n"); break;
+				case piezoCaptureState_Triggered:	printf("Capture state: triggered\n"); break;
+				case piezoCaptureState_Frozen:		printf("Capture state: frozen\n"); break;
+				case piezoCaptureState_Disabled:	printf("Capture state: disabled while streaming\n"); break;
+				default:							printf("Capture state: unknown (%u)\n", status.state); break;
+			}
+			printf("Buffer: %u samples, %u bytes RAM\n", status.slots, status.bytes);
+			printf("Post trigger samples: %u\n", status.postTrigger);
+			printf("Valid samples: %u\n", status.validSamples);
+			if(status.state == piezoCaptureState_Frozen) {
+				printf("Trigger sample index: %u\n", status.triggerIndex);
+			}
+		} else if(strcmp(argv[i], "setcapture") == 0) {
+			unsigned long int readPost;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 0, 65535, "post trigger samples", &readPost)) { printUsage(argc, argv); r = 1; break; }
+
+			e = lpPzb->vtbl->setCapturePostTrigger(lpPzb, (uint16_t)readPost);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to set capture configuration (code %u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Set %lu post trigger samples (ignored by the board if larger than the buffer)\n", readPost);
+			i = i + 1;
+		} else if((strcmp(argv[i], "arm") == 0) || (strcmp(argv[i], "forcetrigger") == 0)) {
+			bool bForce = (strcmp(argv[i], "forcetrigger") == 0) ? true : false;
+
+			e = lpPzb->vtbl->armCapture(lpPzb, bForce);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to arm capture (code %u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+			printf("%s\n", bForce ? "Forced capture trigger" : "Armed capture");
+		} else if(strcmp(argv[i], "capdump") == 0) {
+			struct piezoCaptureStatus status;
+			uint16_t values[PIEZOBOARD_CAPTURE_CHUNK_MAX];
+			uint8_t channels[PIEZOBOARD_CAPTURE_CHUNK_MAX];
+			uint8_t bCount;
+			unsigned long int dwOffset;
+			unsigned long int j;
+
+			e = lpPzb->vtbl->getCaptureStatus(lpPzb, &status);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query capture status (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+			if(status.state != piezoCaptureState_Frozen) {
+				printf("Capture is not frozen (no trigger yet)\n");
+				r = 2;
+				break;
+			}
+
+			printf("# %u samples, trigger at index %u\n", status.validSamples, status.triggerIndex);
+			for(dwOffset = 0; dwOffset < status.validSamples; dwOffset = dwOffset + bCount) {
+				unsigned long int dwChunk = status.validSamples - dwOffset;
+				if(dwChunk > PIEZOBOARD_CAPTURE_CHUNK_MAX) { dwChunk = PIEZOBOARD_CAPTURE_CHUNK_MAX; }
+
+				e = lpPzb->vtbl->readCapture(lpPzb, (uint16_t)dwOffset, (uint8_t)dwChunk, values, channels, &bCount);
+				if((e != piezoE_Ok) || (bCount == 0)) {
+					printf("%s:%u Failed to read capture at offset %lu (%u)\n", __FILE__, __LINE__, dwOffset, e);
+					r = 2;
+					break;
+				}
+				for(j = 0; j < bCount; j=j+1) {
+					printf("%lu\t%u\t%u\n", dwOffset + j, channels[j], values[j]);
+				}
+			}
+			if(r != 0) {
+				break;
+			}
+		} else if(strcmp(argv[i], "telemetry") == 0) {
+			struct piezoTelemetry telemetry;
+
+			e = lpPzb->vtbl->getTelemetry(lpPzb, &telemetry);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query telemetry (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Triggers (piezo veto):          %lu\n", (unsigned long int)telemetry.dwTriggers[piezoTriggerMode_PiezoVeto]);
+			printf("Triggers (piezo only):          %lu\n", (unsigned long int)telemetry.dwTriggers[piezoTriggerMode_PiezoOnly]);
+			printf("Triggers (capacitive):          %lu\n", (unsigned long int)telemetry.dwTriggers[piezoTriggerMode_Capacitive]);
+			printf("Triggers (piezo or capacitive): %lu\n", (unsigned long int)telemetry.dwTriggers[piezoTriggerMode_PiezoOrCapacitive]);
+			printf("Suppressed during debounce:     %lu\n", (unsigned long int)telemetry.dwDebounceSuppressed);
+			printf("Calibrations:                   %lu\n", (unsigned long int)telemetry.dwCalibrations);
+			printf("ADC interrupt overruns:         %lu\n", (unsigned long int)telemetry.dwAdcOverruns);
+			printf("I2C receive overflows:          %lu\n", (unsigned long int)telemetry.dwRxOverflows);
+			printf("I2C checksum errors:            %lu\n", (unsigned long int)telemetry.dwChecksumErrors);
+			printf("I2C resynchronizations:         %lu\n", (unsigned long int)telemetry.dwResyncs);
+			printf("I2C transmit underruns:         %lu\n", (unsigned long int)telemetry.dwTxUnderruns);
+			printf("I2C bus errors:                 %lu\n", (unsigned long int)telemetry.dwBusErrors);
+			printf("I2C responses discarded:        %lu\n", (unsigned long int)telemetry.dwTxRejected);
+		} else if(strcmp(argv[i], "resettelemetry") == 0) {
+			e = lpPzb->vtbl->resetTelemetry(lpPzb);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to reset telemetry (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+			printf("Telemetry counters cleared\n");
+		} else if(strcmp(argv[i], "stream") == 0) {
+			unsigned long int readEncoding;
+			unsigned long int readBlocks;
+			unsigned long int dwReceived = 0;
+			unsigned long int dwSamples = 0;
+			unsigned long int dwOverflows = 0;
+			unsigned long int dwRead;
+			unsigned long int j;
+			unsigned long int k;
+			struct piezoStreamBlock blocks[PIEZOBOARD_STREAM_READ_BLOCKS_MAX];
+			struct piezoStreamStatus streamStatus;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 0, 2, "encoding", &readEncoding)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+2, 1, 1000000, "blocks", &readBlocks)) { printUsage(argc, argv); r = 1; break; }
+			i = i + 2;
+
+			e = lpPzb->vtbl->setStream(lpPzb, true, (enum piezoStreamEncoding)readEncoding);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to enable streaming (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			while(dwReceived < readBlocks) {
+				e = lpPzb->vtbl->readStream(lpPzb, blocks, PIEZOBOARD_STREAM_READ_BLOCKS_MAX, &dwRead);
+				if(e != piezoE_Ok) {
+					printf("%s:%u Failed to read stream (%u)\n", __FILE__, __LINE__, e);
+					r = 2;
+					break;
+				}
+				if(dwRead == 0) {
+					usleep(1000);
+					continue;
+				}
+
+				for(j = 0; (j < dwRead) && (dwReceived < readBlocks); j=j+1) {
+					if(blocks[j].bOverflow) { dwOverflows = dwOverflows + 1; }
+					printf("%3u%s", blocks[j].bSequence, blocks[j].bOverflow ? "!" : " ");
+					for(k = 0; k < blocks[j].bSamples; k=k+1) {
+						printf(" %u:%4u", blocks[j].channels[k], blocks[j].values[k]);
+					}
+					printf("\n");
+					dwSamples = dwSamples + blocks[j].bSamples;
+					dwReceived = dwReceived + 1;
+				}
+			}
+
+			if(lpPzb->vtbl->getStreamStatus(lpPzb, &streamStatus) == piezoE_Ok) {
+				printf("Samples received: %lu (%.1f per block), blocks after a gap: %lu, samples dropped by the board: %lu\n", dwSamples, (dwReceived > 0) ? ((double)dwSamples) / ((double)dwReceived) : 0.0, dwOverflows, (unsigned long int)streamStatus.dwDroppedSamples);
+			}
+			e = lpPzb->vtbl->setStream(lpPzb, false, piezoStreamEncoding_Raw);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to disable streaming (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+			}
+			if(r != 0) { break; }
+		} else if(strcmp(argv[i], "trace") == 0) {
+			unsigned long int readBlocks;
+			unsigned long int dwReceived = 0;
+			unsigned long int dwRead;
+			unsigned long int j;
+			unsigned long int k;
+			unsigned long int iChannel;
+			uint8_t bActiveMask;
+			uint8_t bRowMask = 0;
+			uint16_t row[4];
+			struct piezoStreamBlock blocks[PIEZOBOARD_STREAM_READ_BLOCKS_MAX];
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 1, 1000000, "blocks", &readBlocks)) { printUsage(argc, argv); r = 1; break; }
+			i = i + 1;
+
+			e = lpPzb->vtbl->getActiveChannels(lpPzb, &bActiveMask);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query active channels (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+			e = lpPzb->vtbl->setStream(lpPzb, true, piezoStreamEncoding_Raw);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to enable streaming (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("# Raw ADC counts, columns: channels of mask 0x%02x in ascending order\n", bActiveMask);
+			while(dwReceived < readBlocks) {
+				e = lpPzb->vtbl->readStream(lpPzb, blocks, PIEZOBOARD_STREAM_READ_BLOCKS_MAX, &dwRead);
+				if(e != piezoE_Ok) {
+					printf("%s:%u Failed to read stream (%u)\n", __FILE__, __LINE__, e);
+					r = 2;
+					break;
+				}
+				if(dwRead == 0) {
+					usleep(1000);
+					continue;
+				}
+
+				for(j = 0; (j < dwRead) && (dwReceived < readBlocks); j=j+1) {
+					if(blocks[j].bOverflow) {
+						/* Samples are missing, a row spanning the gap would mix two points in time */
+						printf("# gap\n");
+						bRowMask = 0;
+					}
+					for(k = 0; k < blocks[j].bSamples; k=k+1) {
+						if(blocks[j].channels[k] > 3) { continue; }
+						if((bRowMask & (1 << blocks[j].channels[k])) != 0) {
+							/* Next conversion round starts, partial rows (first block, gaps) are dropped */
+							if(bRowMask == bActiveMask) {
+								for(iChannel = 0; iChannel < 4; iChannel=iChannel+1) {
+									if((bActiveMask & (1 << iChannel)) != 0) { printf("%u ", row[iChannel]); }
+								}
+								printf("\n");
+							}
+							bRowMask = 0;
+						}
+						row[blocks[j].channels[k]] = blocks[j].values[k];
+						bRowMask = bRowMask | (1 << blocks[j].channels[k]);
+					}
+					dwReceived = dwReceived + 1;
+				}
+			}
+
+			e = lpPzb->vtbl->setStream(lpPzb, false, piezoStreamEncoding_Raw);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to disable streaming (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+			}
+			if(r != 0) { break; }
+		} else if(strcmp(argv[i], "bench") == 0) {
+			unsigned long int readEncoding;
+			unsigned long int readCount;
+			unsigned long int dwSpeeds[2] = { PIEZOBOARD_BUS_SPEED_STANDARD, PIEZOBOARD_BUS_SPEED_FAST };
+			unsigned long int s;
+			unsigned long int j;
+			unsigned long int dwRead;
+			uint32_t dwOriginalSpeed;
+			struct piezoStreamBlock blocks[PIEZOBOARD_STREAM_READ_BLOCKS_MAX];
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 0, 2, "encoding", &readEncoding)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+2, 1, 1000000, "count", &readCount)) { printUsage(argc, argv); r = 1; break; }
+			i = i + 2;
+
+			ei2c = lpBus->vtbl->getSpeed(lpBus, &dwOriginalSpeed);
+			if(ei2c != i2cE_Ok) {
+				printf("%s:%u Failed to query the bus speed (%u)\n", __FILE__, __LINE__, ei2c);
+				r = 2;
+				break;
+			}
+
+			/* The encoding is done by the ADC interrupt, so it matters for the interrupt profile measured meanwhile */
+			e = lpPzb->vtbl->setStream(lpPzb, true, (enum piezoStreamEncoding)readEncoding);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to enable streaming (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			/*
+				Every bulk read transfers PIEZOBOARD_STREAM_READ_BLOCKS_MAX
+				blocks, empty filler blocks included - this measures the bus,
+				not the sample rate of the board
+			*/
+			for(s = 0; s < sizeof(dwSpeeds)/sizeof(dwSpeeds[0]); s=s+1) {
+				struct timespec tsStart;
+				struct timespec tsEnd;
+				unsigned long int dwBlocks = 0;
+				unsigned long int dwBytes;
+				double dSeconds;
+
+				ei2c = lpBus->vtbl->setSpeed(lpBus, (uint32_t)dwSpeeds[s]);
+				if(ei2c != i2cE_Ok) {
+					printf("%s:%u Failed to set the bus speed to %lu Hz (%u)\n", __FILE__, __LINE__, dwSpeeds[s], ei2c);
+					r = 2;
+					break;
+				}
+
+				clock_gettime(CLOCK_MONOTONIC, &tsStart);
+				for(j = 0; j < readCount; j=j+1) {
+					e = lpPzb->vtbl->readStream(lpPzb, blocks, PIEZOBOARD_STREAM_READ_BLOCKS_MAX, &dwRead);
+					if(e != piezoE_Ok) {
+						printf("%s:%u Failed to read stream (%u)\n", __FILE__, __LINE__, e);
+						r = 2;
+						break;
+					}
+					dwBlocks = dwBlocks + dwRead;
+				}
+				clock_gettime(CLOCK_MONOTONIC, &tsEnd);
+				if(r != 0) { break; }
+
+				dwBytes = readCount * PIEZOBOARD_STREAM_READ_BLOCKS_MAX * PIEZOBOARD_STREAM_BLOCK_BYTES;
+				dSeconds = ((double)(tsEnd.tv_sec - tsStart.tv_sec)) + ((double)(tsEnd.tv_nsec - tsStart.tv_nsec)) / 1000000000.0;
+				printf("%6lu Hz: %lu bytes in %.3f s, %.0f bytes/s (%lu blocks with samples)\n", dwSpeeds[s], dwBytes, dSeconds, (dSeconds > 0) ? ((double)dwBytes) / dSeconds : 0.0, dwBlocks);
+			}
 
-			usleep(100*1000);
+			if(lpBus->vtbl->setSpeed(lpBus, dwOriginalSpeed) != i2cE_Ok) {
+				printf("%s:%u Failed to restore the bus speed of %lu Hz\n", __FILE__, __LINE__, (unsigned long int)dwOriginalSpeed);
+				r = 2;
+			}
+			e = lpPzb->vtbl->setStream(lpPzb, false, piezoStreamEncoding_Raw);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to disable streaming (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+			}
+			if(r != 0) { break; }
+		} else if(strcmp(argv[i], "live") == 0) {
+			unsigned long int readCount;
+			unsigned long int j;
+			struct piezoLiveStatus live;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 1, 1000000, "count", &readCount)) { printUsage(argc, argv); r = 1; break; }
+			i = i + 1;
+
+			for(j = 0; j < readCount; j=j+1) {
+				e = lpPzb->vtbl->getLiveStatus(lpPzb, &live);
+				if(e != piezoE_Ok) {
+					printf("%s:%u Failed to read live registers (%u)\n", __FILE__, __LINE__, e);
+					r = 2;
+					break;
+				}
+
+				printf("%10lu ms seq %3u %s%s%s%s raw %4u %4u %4u %4u avg %4u %4u %4u %4u triggers %lu\n",
+					(unsigned long int)live.dwMillis,
+					live.bSequence,
+					((live.bFlags & PIEZOBOARD_LIVESTATUS__CALIBRATING) != 0) ? "C" : "-",
+					((live.bFlags & PIEZOBOARD_LIVESTATUS__OUTPUT) != 0) ? "T" : "-",
+					((live.bFlags & PIEZOBOARD_LIVESTATUS__STOREBUSY) != 0) ? "S" : "-",
+					((live.bFlags & PIEZOBOARD_LIVESTATUS__CAPTUREFROZEN) != 0) ? "F" : "-",
+					live.rawValues[0], live.rawValues[1], live.rawValues[2], live.rawValues[3],
+					live.averages[0], live.averages[1], live.averages[2], live.averages[3],
+					(unsigned long int)live.dwTriggers
+				);
+			}
+			if(r != 0) { break; }
+		} else if(strcmp(argv[i], "profile") == 0) {
+			static const char* lpSlotNames[PIEZOBOARD_PROFILE_SLOTS] = { "ADC interrupt", "TWI interrupt", "Main loop" };
+			struct piezoProfile profile;
+			unsigned long int iSlot;
+			unsigned long int iBin;
+
+			for(iSlot = 0; iSlot < PIEZOBOARD_PROFILE_SLOTS; iSlot=iSlot+1) {
+				e = lpPzb->vtbl->getProfile(lpPzb, (enum piezoProfileSlot)iSlot, &profile);
+				if(e != piezoE_Ok) {
+					printf("%s:%u Failed to query profile (%u, firmware built without PROFILER=1?)\n", __FILE__, __LINE__, e);
+					r = 2;
+					break;
+				}
+
+				printf("%s: %lu runs, min %u, mean %u, max %u cycles\n", lpSlotNames[iSlot], (unsigned long int)profile.dwCount, profile.minCycles, profile.meanCycles, profile.maxCycles);
+				for(iBin = 0; iBin < PIEZOBOARD_PROFILE_BINS; iBin=iBin+1) {
+					if(profile.histogram[iBin] == 0) { continue; }
+					if(iBin == 0) {
+						printf("\t      < %5u: %u\n", 1 << PIEZOBOARD_PROFILE_BIN_SHIFT, profile.histogram[iBin]);
+					} else if(iBin == PIEZOBOARD_PROFILE_BINS - 1) {
+						printf("\t     >= %5u: %u\n", 1 << (iBin + PIEZOBOARD_PROFILE_BIN_SHIFT - 1), profile.histogram[iBin]);
+					} else {
+						printf("\t%5u - %5u: %u\n", 1 << (iBin + PIEZOBOARD_PROFILE_BIN_SHIFT - 1), (1 << (iBin + PIEZOBOARD_PROFILE_BIN_SHIFT)) - 1, profile.histogram[iBin]);
+					}
+				}
+			}
+			if(r != 0) {
+				break;
+			}
+		} else if(strcmp(argv[i], "resetprofile") == 0) {
+			e = lpPzb->vtbl->resetProfile(lpPzb);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to reset profile (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+			printf("Profile cleared\n");
+		} else if(strcmp(argv[i], "filtersweep") == 0) {
+			unsigned long int readSeconds;
+			unsigned long int iWindow;
+			enum piezoFilterMode originalMode;
+			uint8_t originalWindow;
+			struct piezoTelemetry telemetryBefore;
+			struct piezoTelemetry telemetryAfter;
+			struct piezoProfile profile;
+			bool bProfiler = true;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 1, 3600, "seconds", &readSeconds)) { printUsage(argc, argv); r = 1; break; }
+			i = i + 1;
+
+			e = lpPzb->vtbl->getFilterMode(lpPzb, &originalMode, &originalWindow);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query current filter mode (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			/*
+				Window 1 stands for the moving average. Every filter sees a
+				different stretch of the live signal, so the detections only
+				compare well while the noise is stationary (machine running
+				but not probing) - piezofilter -bench compares on one trace
+			*/
+			printf("Filter          ADC mean  ADC max  Detections\n");
+			for(iWindow = 1; iWindow <= 15; iWindow = (iWindow == 1) ? 3 : (iWindow + 1)) {
+				unsigned long int dwDetections;
+
+				e = lpPzb->vtbl->setFilterMode(lpPzb, (iWindow == 1) ? piezoFilterMode_MovingAverage : piezoFilterMode_RunningMedian, (iWindow == 1) ? originalWindow : (uint8_t)iWindow);
+				if(e != piezoE_Ok) {
+					printf("%s:%u Failed to set filter mode (code %u)\n", __FILE__, __LINE__, e);
+					r = 2;
+					break;
+				}
+				usleep(100000); /* Let the new window fill */
+
+				if(bProfiler && (lpPzb->vtbl->resetProfile(lpPzb) != piezoE_Ok)) {
+					bProfiler = false; /* Firmware built without PROFILER=1 */
+				}
+				e = lpPzb->vtbl->getTelemetry(lpPzb, &telemetryBefore);
+				if(e != piezoE_Ok) {
+					printf("%s:%u Failed to query telemetry (%u)\n", __FILE__, __LINE__, e);
+					r = 2;
+					break;
+				}
+
+				sleep((unsigned int)readSeconds);
+
+				e = lpPzb->vtbl->getTelemetry(lpPzb, &telemetryAfter);
+				if(e != piezoE_Ok) {
+					printf("%s:%u Failed to query telemetry (%u)\n", __FILE__, __LINE__, e);
+					r = 2;
+					break;
+				}
+				dwDetections = (unsigned long int)(
+					(telemetryAfter.dwTriggers[0] + telemetryAfter.dwTriggers[1] + telemetryAfter.dwTriggers[2] + telemetryAfter.dwTriggers[3] + telemetryAfter.dwDebounceSuppressed)
+					- (telemetryBefore.dwTriggers[0] + telemetryBefore.dwTriggers[1] + telemetryBefore.dwTriggers[2] + telemetryBefore.dwTriggers[3] + telemetryBefore.dwDebounceSuppressed)
+				);
+
+				if(iWindow == 1) {
+					printf("Moving average  ");
+				} else {
+					printf("Median %2lu       ", iWindow);
+				}
+				if(bProfiler && (lpPzb->vtbl->getProfile(lpPzb, piezoProfileSlot_AdcInterrupt, &profile) == piezoE_Ok)) {
+					printf("%8u %8u", profile.meanCycles, profile.maxCycles);
+				} else {
+					printf("%8s %8s", "-", "-");
+				}
+				printf("  %10lu\n", dwDetections);
+			}
+
+			if(lpPzb->vtbl->setFilterMode(lpPzb, originalMode, originalWindow) != piezoE_Ok) {
+				printf("%s:%u Failed to restore the filter mode\n", __FILE__, __LINE__);
+				r = 2;
+			}
+			if(!bProfiler) {
+				printf("No cycle profile available (firmware built without PROFILER=1)\n");
+			}
+			if(r != 0) { break; }
 		} else if(strcmp(argv[i], "rst") == 0) {
 			e = lpPzb->vtbl->reset(lpPzb);
 			if(e != piezoE_Ok) {
@@ -309,8 +1329,6 @@ int main(int argc, char* argv[]) {
 				break;
 			}
 			printf("Performed reset\n");
-
-			usleep(100*1000);
 		} else if(strcmp(argv[i], "cal") == 0) {
 			e = lpPzb->vtbl->recalibrate(lpPzb);
 			if(e != piezoE_Ok) {
@@ -319,8 +1337,6 @@ int main(int argc, char* argv[]) {
 				break;
 			}
 			printf("Performed recalibration\n");
-
-			usleep(100*1000);
 		} else if(strcmp(argv[i], "st") == 0) {
 			e = lpPzb->vtbl->storeSettings(lpPzb);
 			if(e != piezoE_Ok) {
@@ -328,9 +1344,123 @@ int main(int argc, char* argv[]) {
 				r = 2;
 				break;
 			}
-			printf("Stored settings\n");
+			{
+				uint16_t generation;
+				uint16_t recordsUsed;
+				uint16_t recordCapacity;
+
+				e = lpPzb->vtbl->getStoreStatus(lpPzb, NULL, &generation, &recordsUsed, &recordCapacity);
+				if(e != piezoE_Ok) {
+					printf("Stored settings\n");
+				} else {
+					printf("Stored settings (journal generation %u, %u of %u records used)\n", generation, recordsUsed, recordCapacity);
+				}
+			}
+		} else if(strcmp(argv[i], "getsettings") == 0) {
+			struct piezoSettings settings;
+			unsigned long int j;
+
+			e = lpPzb->vtbl->getSettings(lpPzb, &settings);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query settings (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Trigger mode:\t\t%u\n", settings.triggerMode);
+			printf("Threshold:\t\t%u\n", settings.threshold);
+			printf("Alpha:\t\t\t%u.%03u\n", settings.alphaPermille / 1000, settings.alphaPermille % 1000);
+			printf("Calibration samples:\t%lu\n", (unsigned long int)settings.dwInitSamples);
+			printf("Debounce:\t\t%u ms\n", settings.debounceLength);
+			printf("Filter:\t\t\tmode %u, median window %u\n", settings.filterMode, settings.medianWindow);
+			printf("Detector:\t\tmode %u, slope distance %u, slope threshold %u\n", settings.detectorMode, settings.slopeDistance, settings.slopeThreshold);
+			printf("Sampling:\t\trate %u, prescaler %u, flags 0x%02x, channels 0x%02x\n", settings.sampleRate, settings.prescaler, settings.samplingFlags, settings.activeChannels);
+			printf("Threshold mode:\t\tmode %u, sigma factor %u.%u\n", settings.thresholdMode, settings.sigmaFactor / 10, settings.sigmaFactor % 10);
+			printf("Baseline tracking:\tshift %u, freeze margin %u%%\n", settings.trackShift, settings.freezeMargin);
+			printf("Capture:\t\t%u post trigger samples\n", settings.capturePostTrigger);
+			printf("Qualification:\t\trelease %u%%, samples %u, votes %u, window %u\n", settings.releasePercent, settings.minSamples, settings.minChannels, settings.coincidenceWindow);
+			printf("Biquad stages:\t\t%u\n", settings.biquadStages);
+			for(j = 0; j < PIEZOBOARD_BIQUAD_STAGES_MAX; j=j+1) {
+				printf("Biquad %lu:\t\t%d %d %d %d %d\n", j, settings.biquad[j].b0, settings.biquad[j].b1, settings.biquad[j].b2, settings.biquad[j].a1, settings.biquad[j].a2);
+			}
+		} else if((strcmp(argv[i], "setinit") == 0) || (strcmp(argv[i], "setdebounce") == 0)) {
+			struct piezoSettings settings;
+			unsigned long int readValue;
+			bool bInit = (strcmp(argv[i], "setinit") == 0) ? true : false;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 1, 65535, (bInit) ? "calibration samples" : "debounce length", &readValue)) { printUsage(argc, argv); r = 1; break; }
+
+			/* Neither has a dedicated opcode - modify the settings block */
+			e = lpPzb->vtbl->getSettings(lpPzb, &settings);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query settings (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+			if(bInit) {
+				settings.dwInitSamples = (uint32_t)readValue;
+			} else {
+				settings.debounceLength = (uint16_t)readValue;
+			}
+			e = lpPzb->vtbl->setSettings(lpPzb, &settings);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to set settings (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			if(bInit) {
+				printf("Set calibration length to %lu samples\n", readValue);
+			} else {
+				printf("Set debounce length to %lu ms\n", readValue);
+			}
+			i = i + 1;
+		} else if(strcmp(argv[i], "tunings") == 0) {
+			uint8_t slotCount;
+			uint8_t validMask;
+			uint8_t activeProfile;
+			unsigned long int j;
+
+			e = lpPzb->vtbl->getTuningProfiles(lpPzb, &slotCount, &validMask, &activeProfile);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to query tuning profiles (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			for(j = 0; j < slotCount; j=j+1) {
+				printf("Tuning profile %lu:\t%s%s\n", j, ((validMask & (1 << j)) != 0) ? "stored" : "empty", (activeProfile == j) ? " (active)" : "");
+			}
+		} else if(strcmp(argv[i], "savetuning") == 0) {
+			unsigned long int readSlot;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 0, PIEZOBOARD_TUNING_PROFILES_MAX-1, "tuning profile slot", &readSlot)) { printUsage(argc, argv); r = 1; break; }
+
+			e = lpPzb->vtbl->saveTuningProfile(lpPzb, (uint8_t)readSlot);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to save tuning profile (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
+
+			printf("Saved settings as tuning profile %lu\n", readSlot);
+			i = i + 1;
+		} else if(strcmp(argv[i], "usetuning") == 0) {
+			unsigned long int readSlot;
+			unsigned long int readPersist;
+
+			if(!parseUnsignedArgument(argc, argv, i+1, 0, PIEZOBOARD_TUNING_PROFILES_MAX-1, "tuning profile slot", &readSlot)) { printUsage(argc, argv); r = 1; break; }
+			if(!parseUnsignedArgument(argc, argv, i+2, 0, 1, "persist flag", &readPersist)) { printUsage(argc, argv); r = 1; break; }
+
+			e = lpPzb->vtbl->activateTuningProfile(lpPzb, (uint8_t)readSlot, (readPersist != 0) ? true : false);
+			if(e != piezoE_Ok) {
+				printf("%s:%u Failed to activate tuning profile (%u)\n", __FILE__, __LINE__, e);
+				r = 2;
+				break;
+			}
 
-			usleep(100*1000);
+			printf("Activated tuning profile %lu%s\n", readSlot, (readPersist != 0) ? " and stored it as power up settings" : "");
+			i = i + 2;
 		} else {
 			printf("Unknown command %s\n", argv[i]);
 			printUsage(argc, argv);
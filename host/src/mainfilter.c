@@ -0,0 +1,549 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../../src/biquad.h"
+#include "../../src/adc.h"
+#include "../../src/smoothing.h"
+
+#ifndef __cplusplus
+	#ifndef true
+		typedef uint8_t bool;
+		#define true 1
+		#define false 0
+	#endif
+#endif
+
+/*
+	Filter harness
+
+	Runs recorded ADC traces through exactly the same fixed point biquad
+	code the firmware uses (src/biquad.h) and reports how much of the
+	noise floor is removed. Traces are plain text files with one sample
+	per line, multiple columns (one per channel) may be separated by
+	whitespace or commas. Lines starting with # are ignored.
+
+	Stages can either be given as raw Q2.14 coefficients (as accepted by
+	"piezocli setbiquad") or designed from center frequency and quality
+	factor. Designed coefficients are printed so they can be uploaded.
+
+	With -compare the (filtered) trace is additionally run through the
+	Q10.5 / Q0.12 moving average of the ADC interrupt (src/smoothing.h)
+	and through the single precision float path the firmware used before,
+	both calibrated on the first samples of the trace, and the largest
+	difference as well as the number of differing trigger decisions are
+	reported.
+
+	With -bench the (filtered) trace is run through the moving average and
+	the running median with all windows from 3 to ADC_MEDIAN_WINDOW_MAX.
+	For every filter the host CPU time per sample and the number of
+	threshold crossings (rising edges of the deviation) are reported - on
+	a trace recorded without taps every crossing is a false trigger.
+*/
+
+#define FILTER_STAGES_MAX				8
+#define FILTER_LINE_LENGTH				1024
+#define FILTER_INITSAMPLES_DEFAULT		100			/* Firmware default calibration length */
+#define FILTER_BENCH_WINDOW_MIN			3
+#define FILTER_BENCH_MIN_CLOCKS			(CLOCKS_PER_SEC / 10)	/* Repeat each filter for at least 100 ms */
+
+#ifndef M_PI
+	#define M_PI 3.14159265358979323846
+#endif
+
+enum filterDesign {
+	filterDesign_Notch,
+	filterDesign_BandPass,
+};
+
+static void printUsage(int argc, char* argv[]) {
+	printf("Usage: %s [OPTIONS] [TRACEFILE]\n\n", argv[0]);
+
+	printf("Reads the trace from standard input if no file is given.\n\n");
+
+	printf("Supported options:\n");
+	printf("\t-rate SAMPLERATE\n");
+	printf("\t\tSamples per second and channel of the trace (required for -notch and -bandpass)\n");
+	printf("\t-notch FREQUENCY Q\n");
+	printf("\t\tAppends a notch stage at FREQUENCY Hz with quality factor Q\n");
+	printf("\t-bandpass FREQUENCY Q\n");
+	printf("\t\tAppends a band pass stage (0 dB peak gain) at FREQUENCY Hz with quality factor Q\n");
+	printf("\t-stage B0 B1 B2 A1 A2\n");
+	printf("\t\tAppends a stage with the given Q2.14 coefficients (16384 = 1.0)\n");
+	printf("\t-column N\n");
+	printf("\t\tUses column N (starting at 0) of the trace (default 0)\n");
+	printf("\t-dump\n");
+	printf("\t\tPrints input and filtered value for every sample\n");
+	printf("\t-compare ALPHA THRESHOLD\n");
+	printf("\t\tCompares the fixed point moving average (ALPHA 0 ... 1) and trigger decision (THRESHOLD in ADC counts)\n");
+	printf("\t\tof the firmware against the former float implementation\n");
+	printf("\t-bench ALPHA THRESHOLD\n");
+	printf("\t\tTimes the moving average (ALPHA) and the running median (windows %u to %u) and counts\n", FILTER_BENCH_WINDOW_MIN, ADC_MEDIAN_WINDOW_MAX);
+	printf("\t\tthe crossings of THRESHOLD (ADC counts) - use traces without taps to count false triggers\n");
+	printf("\t-init SAMPLES\n");
+	printf("\t\tSamples used for the centerline calibration in -compare and -bench mode (default %u)\n", FILTER_INITSAMPLES_DEFAULT);
+}
+
+static bool parseDouble(int argc, char* argv[], int idx, char* lpName, double* lpOut) {
+	if(argc <= idx) {
+		printf("Missing %s\n", lpName);
+		return false;
+	}
+	if(sscanf(argv[idx], "%lf", lpOut) != 1) {
+		printf("Invalid %s %s\n", lpName, argv[idx]);
+		return false;
+	}
+	return true;
+}
+
+static int16_t quantizeCoefficient(double dValue) {
+	double dScaled = floor(dValue * (double)BIQUAD_COEFF_ONE + 0.5);
+
+	if(dScaled > 32767.0) { return 32767; }
+	if(dScaled < -32768.0) { return -32768; }
+	return (int16_t)dScaled;
+}
+
+/*
+	Same conversion the firmware does in adcApplySettings
+*/
+static uint16_t quantizeAlpha(float alpha) {
+	if(alpha >= 1.0f) { return ADC_ALPHA_ONE; }
+	if(alpha <= 0.0f) { return 0; }
+	return (uint16_t)(alpha * (float)ADC_ALPHA_ONE + 0.5f);
+}
+
+/*
+	Stage design according to the well known "audio EQ cookbook"
+	(bilinear transform of the analog prototypes)
+*/
+static bool designStage(enum filterDesign design, double dRate, double dFrequency, double dQ, struct biquadCoefficients* lpOut) {
+	double w0, alpha, a0;
+	double b0, b1, b2, a1, a2;
+
+	if((dRate <= 0) || (dFrequency <= 0) || (dFrequency >= dRate / 2) || (dQ <= 0)) {
+		return false;
+	}
+
+	w0 = 2.0 * M_PI * dFrequency / dRate;
+	alpha = sin(w0) / (2.0 * dQ);
+	a0 = 1.0 + alpha;
+	a1 = -2.0 * cos(w0);
+	a2 = 1.0 - alpha;
+
+	switch(design) {
+		case filterDesign_Notch:
+			b0 = 1.0;
+			b1 = -2.0 * cos(w0);
+			b2 = 1.0;
+			break;
+		case filterDesign_BandPass:
+			b0 = alpha;
+			b1 = 0;
+			b2 = -alpha;
+			break;
+		default:
+			return false;
+	}
+
+	lpOut->b0 = quantizeCoefficient(b0 / a0);
+	lpOut->b1 = quantizeCoefficient(b1 / a0);
+	lpOut->b2 = quantizeCoefficient(b2 / a0);
+	lpOut->a1 = quantizeCoefficient(a1 / a0);
+	lpOut->a2 = quantizeCoefficient(a2 / a0);
+
+	return true;
+}
+
+/*
+	Same conversion the firmware does in adcApplySettings
+*/
+static int16_t stageDCGain(struct biquadCoefficients* lpCoeff) {
+	double dGain = ((double)lpCoeff->b0 + (double)lpCoeff->b1 + (double)lpCoeff->b2) / ((double)BIQUAD_COEFF_ONE + (double)lpCoeff->a1 + (double)lpCoeff->a2);
+
+	if(dGain >= (32767.0 / (double)BIQUAD_COEFF_ONE)) { return 32767; }
+	if(dGain <= (-32767.0 / (double)BIQUAD_COEFF_ONE)) { return -32767; }
+	return (int16_t)(dGain * (double)BIQUAD_COEFF_ONE + ((dGain < 0) ? -0.5 : 0.5));
+}
+
+/*
+	Calibrates on the first dwInitSamples inputs like adcFinishCalibration
+	and runs the remaining ones through the moving average (bWindow = 0) or
+	the running median. Returns the number of rising edges of the deviation
+	above thresholdQ, lpSink collects the filter output so the timed runs
+	cannot be optimized away.
+*/
+static unsigned long int benchFilter(
+	int16_t* lpInput,
+	unsigned long int dwSamples,
+	unsigned long int dwInitSamples,
+	uint8_t bWindow,
+	uint16_t alphaQ,
+	uint16_t thresholdQ,
+	int32_t* lpSink
+) {
+	int16_t history[ADC_MEDIAN_WINDOW_MAX];
+	int16_t sorted[ADC_MEDIAN_WINDOW_MAX];
+	uint8_t bFill = 0;
+	uint8_t bPos = 0;
+	int32_t avgAccu;
+	uint32_t dwSum = 0;
+	uint32_t q, r;
+	int16_t centerline;
+	bool bAbove = false;
+	unsigned long int dwEvents = 0;
+	unsigned long int i;
+
+	for(i = 0; i < dwInitSamples; i=i+1) {
+		dwSum = dwSum + (uint32_t)lpInput[i];
+	}
+	q = dwSum / dwInitSamples;
+	r = dwSum - q * dwInitSamples;
+	centerline = (int16_t)(q + ((r + (dwInitSamples >> 1)) / dwInitSamples));
+	avgAccu = smoothingAverageReset(centerline);
+
+	for(i = dwInitSamples; i < dwSamples; i=i+1) {
+		int16_t avg;
+		uint16_t dev;
+
+		if(bWindow == 0) {
+			avg = smoothingAverageUpdate(&avgAccu, alphaQ, lpInput[i]);
+		} else {
+			avg = smoothingMedianUpdate(history, sorted, &bFill, &bPos, bWindow, lpInput[i]);
+		}
+		dev = (avg > centerline) ? (uint16_t)(avg - centerline) : (uint16_t)(centerline - avg);
+
+		if(dev > thresholdQ) {
+			if(!bAbove) { dwEvents = dwEvents + 1; }
+			bAbove = true;
+		} else {
+			bAbove = false;
+		}
+		(*lpSink) = (*lpSink) + avg;
+	}
+
+	return dwEvents;
+}
+
+static void runBenchmark(
+	int16_t* lpInput,
+	unsigned long int dwSamples,
+	unsigned long int dwInitSamples,
+	double dAlpha,
+	uint16_t alphaQ,
+	uint16_t thresholdQ
+) {
+	uint8_t bWindow;
+	int32_t sink = 0;
+
+	printf("Benchmark: %lu samples after a calibration of %lu, threshold %u counts\n", dwSamples - dwInitSamples, dwInitSamples, (unsigned int)(thresholdQ >> ADC_Q_SHIFT));
+	printf("Filter            ns/sample   crossings\n");
+
+	for(bWindow = FILTER_BENCH_WINDOW_MIN - 1; bWindow <= ADC_MEDIAN_WINDOW_MAX; bWindow=bWindow+1) {
+		unsigned long int dwEvents = 0;
+		unsigned long int dwRuns = 0;
+		clock_t tStart = clock();
+		clock_t tElapsed;
+		uint8_t bFilterWindow = (bWindow < FILTER_BENCH_WINDOW_MIN) ? 0 : bWindow;
+
+		do {
+			dwEvents = benchFilter(lpInput, dwSamples, dwInitSamples, bFilterWindow, alphaQ, thresholdQ, &sink);
+			dwRuns = dwRuns + 1;
+			tElapsed = clock() - tStart;
+		} while(tElapsed < FILTER_BENCH_MIN_CLOCKS);
+
+		if(bFilterWindow == 0) {
+			printf("average %5.3f  ", dAlpha);
+		} else {
+			printf("median %2u       ", bFilterWindow);
+		}
+		printf("%10.2f  %10lu\n", ((double)tElapsed * 1e9 / (double)CLOCKS_PER_SEC) / ((double)dwRuns * (double)(dwSamples - dwInitSamples)), dwEvents);
+	}
+
+	/* Keeps the timed loops alive */
+	if(sink == 0x7FFFFFFF) { printf("\n"); }
+}
+
+static bool readSample(FILE* fTrace, unsigned long int dwColumn, uint16_t* lpSampleOut) {
+	char bLine[FILTER_LINE_LENGTH];
+
+	while(fgets(bLine, sizeof(bLine), fTrace) != NULL) {
+		char* lpToken;
+		unsigned long int dwCurrentColumn = 0;
+
+		if(bLine[0] == '#') { continue; }
+
+		for(lpToken = strtok(bLine, " \t,;\r\n"); lpToken != NULL; lpToken = strtok(NULL, " \t,;\r\n")) {
+			if(dwCurrentColumn == dwColumn) {
+				long int value = strtol(lpToken, NULL, 10);
+				if(value < 0) { value = 0; }
+				if(value > 1023) { value = 1023; }
+				(*lpSampleOut) = (uint16_t)value;
+				return true;
+			}
+			dwCurrentColumn = dwCurrentColumn + 1;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char* argv[]) {
+	struct biquadCoefficients coefficients[FILTER_STAGES_MAX];
+	int16_t dcGain[FILTER_STAGES_MAX];
+	struct biquadState state[FILTER_STAGES_MAX];
+	uint8_t bStages = 0;
+
+	double dRate = 0;
+	unsigned long int dwColumn = 0;
+	bool bDump = false;
+	char* lpFilename = NULL;
+	FILE* fTrace;
+
+	unsigned long int dwSamples = 0;
+	double dSumIn = 0, dSumSqIn = 0, dSumOut = 0, dSumSqOut = 0;
+	double dMinIn = 1e9, dMaxIn = -1e9, dMinOut = 1e9, dMaxOut = -1e9;
+	double dRmsIn, dRmsOut;
+	uint16_t sample;
+	int i;
+
+	/* -compare: fixed point (Q) against float (F) moving average and decision */
+	bool bCompare = false;
+	double dAlpha = 0, dThreshold = 0;
+	unsigned long int dwInitSamples = FILTER_INITSAMPLES_DEFAULT;
+	uint16_t alphaQ = 0;
+	uint16_t thresholdQ = 0;
+	uint32_t dwCalibSumQ = 0;
+	float fCalibSumF = 0;
+	int16_t centerlineQ = 0;
+	float fCenterlineF = 0;
+	int32_t avgAccuQ = 0;
+	float fAvgF = 0;
+	double dMaxAvgDiff = 0;
+	unsigned long int dwCompared = 0, dwAboveQ = 0, dwAboveF = 0, dwMismatches = 0;
+
+	/* -bench: detector input of the whole trace, timed after reading */
+	bool bBench = false;
+	int16_t* lpBenchInput = NULL;
+	unsigned long int dwBenchSize = 0;
+
+	for(i = 1; i < argc; i=i+1) {
+		if(strcmp(argv[i], "-rate") == 0) {
+			if(!parseDouble(argc, argv, i+1, "sample rate", &dRate)) { printUsage(argc, argv); return 1; }
+			i = i + 1;
+		} else if((strcmp(argv[i], "-notch") == 0) || (strcmp(argv[i], "-bandpass") == 0)) {
+			double dFrequency, dQ;
+
+			if(bStages >= FILTER_STAGES_MAX) { printf("Too many stages\n"); return 1; }
+			if(!parseDouble(argc, argv, i+1, "frequency", &dFrequency)) { printUsage(argc, argv); return 1; }
+			if(!parseDouble(argc, argv, i+2, "quality factor", &dQ)) { printUsage(argc, argv); return 1; }
+			if(!designStage((strcmp(argv[i], "-notch") == 0) ? filterDesign_Notch : filterDesign_BandPass, dRate, dFrequency, dQ, &(coefficients[bStages]))) {
+				printf("Cannot design stage at %f Hz, Q %f (sample rate %f, -rate has to precede the stage)\n", dFrequency, dQ, dRate);
+				return 1;
+			}
+			bStages = bStages + 1;
+			i = i + 2;
+		} else if(strcmp(argv[i], "-stage") == 0) {
+			long int values[5];
+			int j;
+
+			if(bStages >= FILTER_STAGES_MAX) { printf("Too many stages\n"); return 1; }
+			for(j = 0; j < 5; j=j+1) {
+				if((argc <= i+1+j) || (sscanf(argv[i+1+j], "%ld", &(values[j])) != 1) || (values[j] < -32768) || (values[j] > 32767)) {
+					printf("Invalid or missing coefficient\n");
+					printUsage(argc, argv);
+					return 1;
+				}
+			}
+			coefficients[bStages].b0 = (int16_t)values[0];
+			coefficients[bStages].b1 = (int16_t)values[1];
+			coefficients[bStages].b2 = (int16_t)values[2];
+			coefficients[bStages].a1 = (int16_t)values[3];
+			coefficients[bStages].a2 = (int16_t)values[4];
+			bStages = bStages + 1;
+			i = i + 5;
+		} else if(strcmp(argv[i], "-column") == 0) {
+			if((argc <= i+1) || (sscanf(argv[i+1], "%lu", &dwColumn) != 1)) { printUsage(argc, argv); return 1; }
+			i = i + 1;
+		} else if(strcmp(argv[i], "-dump") == 0) {
+			bDump = true;
+		} else if(strcmp(argv[i], "-compare") == 0) {
+			if(!parseDouble(argc, argv, i+1, "alpha", &dAlpha)) { printUsage(argc, argv); return 1; }
+			if(!parseDouble(argc, argv, i+2, "threshold", &dThreshold)) { printUsage(argc, argv); return 1; }
+			if((dAlpha < 0) || (dAlpha > 1) || (dThreshold < 0) || (dThreshold > 1023)) {
+				printf("Alpha has to be between 0 and 1, the threshold between 0 and 1023 counts\n");
+				return 1;
+			}
+			bCompare = true;
+			i = i + 2;
+		} else if(strcmp(argv[i], "-bench") == 0) {
+			if(!parseDouble(argc, argv, i+1, "alpha", &dAlpha)) { printUsage(argc, argv); return 1; }
+			if(!parseDouble(argc, argv, i+2, "threshold", &dThreshold)) { printUsage(argc, argv); return 1; }
+			if((dAlpha < 0) || (dAlpha > 1) || (dThreshold < 0) || (dThreshold > 1023)) {
+				printf("Alpha has to be between 0 and 1, the threshold between 0 and 1023 counts\n");
+				return 1;
+			}
+			bBench = true;
+			i = i + 2;
+		} else if(strcmp(argv[i], "-init") == 0) {
+			if((argc <= i+1) || (sscanf(argv[i+1], "%lu", &dwInitSamples) != 1) || (dwInitSamples < 1) || (dwInitSamples > ADC_INITSAMPLES_MAX)) { printUsage(argc, argv); return 1; }
+			i = i + 1;
+		} else if((argv[i][0] != '-') && (lpFilename == NULL)) {
+			lpFilename = argv[i];
+		} else {
+			printUsage(argc, argv);
+			return 1;
+		}
+	}
+
+	for(i = 0; i < bStages; i=i+1) {
+		if(!biquadStable(&(coefficients[i]))) {
+			printf("Stage %d is not stable and would be rejected by the firmware\n", i);
+			return 1;
+		}
+		if(!biquadBounded(&(coefficients[i]))) {
+			printf("Stage %d exceeds |b0|+|b1|+|b2| <= 4.0 and would be rejected by the firmware\n", i);
+			return 1;
+		}
+		dcGain[i] = stageDCGain(&(coefficients[i]));
+	}
+
+	/* The firmware keeps alpha as float setting and the threshold in whole counts */
+	alphaQ = quantizeAlpha((float)dAlpha);
+	thresholdQ = (uint16_t)(((uint16_t)dThreshold) << ADC_Q_SHIFT);
+
+	if(lpFilename != NULL) {
+		fTrace = fopen(lpFilename, "r");
+		if(fTrace == NULL) {
+			printf("Failed to open %s\n", lpFilename);
+			return 1;
+		}
+	} else {
+		fTrace = stdin;
+	}
+
+	while(readSample(fTrace, dwColumn, &sample)) {
+		double dIn = (double)sample;
+		double dOut;
+		int16_t inputQ;
+
+		if(bStages != 0) {
+			int16_t filtered = biquadCascade(coefficients, dcGain, state, bStages, (dwSamples == 0), sample);
+			dOut = (double)filtered / (double)(1 << BIQUAD_SIGNAL_SHIFT);
+			inputQ = (int16_t)(filtered << (ADC_Q_SHIFT - BIQUAD_SIGNAL_SHIFT));
+		} else {
+			dOut = dIn;
+			inputQ = (int16_t)(sample << ADC_Q_SHIFT);
+		}
+
+		if(bDump) {
+			printf("%u\t%.4f\n", sample, dOut);
+		}
+
+		if(bBench) {
+			if(dwSamples >= dwBenchSize) {
+				int16_t* lpNew = (int16_t*)realloc(lpBenchInput, sizeof(int16_t) * ((dwBenchSize == 0) ? 4096 : 2 * dwBenchSize));
+				if(lpNew == NULL) {
+					printf("Out of memory\n");
+					free(lpBenchInput);
+					return 1;
+				}
+				lpBenchInput = lpNew;
+				dwBenchSize = (dwBenchSize == 0) ? 4096 : 2 * dwBenchSize;
+			}
+			lpBenchInput[dwSamples] = inputQ;
+		}
+
+		if(bCompare && (dwSamples < dwInitSamples)) {
+			/* Calibration - the fixed point path rounds the Q10.5 sum once at the end like adcFinishCalibration */
+			dwCalibSumQ = dwCalibSumQ + (uint32_t)inputQ;
+			fCalibSumF = fCalibSumF + (float)inputQ / (float)ADC_Q_ONE;
+			if(dwSamples + 1 == dwInitSamples) {
+				uint32_t q = dwCalibSumQ / dwInitSamples;
+				uint32_t r = dwCalibSumQ - q * dwInitSamples;
+				centerlineQ = (int16_t)(q + ((r + (dwInitSamples >> 1)) / dwInitSamples));
+				fCenterlineF = fCalibSumF / (float)dwInitSamples;
+				avgAccuQ = smoothingAverageReset(centerlineQ);
+				fAvgF = fCenterlineF;
+			}
+		} else if(bCompare) {
+			int16_t avgQ = smoothingAverageUpdate(&avgAccuQ, alphaQ, inputQ);
+			uint16_t devQ = (avgQ > centerlineQ) ? (uint16_t)(avgQ - centerlineQ) : (uint16_t)(centerlineQ - avgQ);
+			float fDevF;
+			bool bAboveQ, bAboveF;
+
+			fAvgF = fAvgF * (1.0f - (float)dAlpha) + ((float)inputQ / (float)ADC_Q_ONE) * (float)dAlpha;
+			fDevF = (fAvgF > fCenterlineF) ? (fAvgF - fCenterlineF) : (fCenterlineF - fAvgF);
+
+			if(fabs((double)avgQ / (double)ADC_Q_ONE - (double)fAvgF) > dMaxAvgDiff) {
+				dMaxAvgDiff = fabs((double)avgQ / (double)ADC_Q_ONE - (double)fAvgF);
+			}
+
+			bAboveQ = (devQ > thresholdQ) ? true : false;
+			bAboveF = (fDevF > (float)((uint16_t)dThreshold)) ? true : false;
+			if(bAboveQ) { dwAboveQ = dwAboveQ + 1; }
+			if(bAboveF) { dwAboveF = dwAboveF + 1; }
+			if(bAboveQ != bAboveF) { dwMismatches = dwMismatches + 1; }
+			dwCompared = dwCompared + 1;
+		}
+
+		dSumIn = dSumIn + dIn;
+		dSumSqIn = dSumSqIn + dIn * dIn;
+		dSumOut = dSumOut + dOut;
+		dSumSqOut = dSumSqOut + dOut * dOut;
+		if(dIn < dMinIn) { dMinIn = dIn; }
+		if(dIn > dMaxIn) { dMaxIn = dIn; }
+		if(dOut < dMinOut) { dMinOut = dOut; }
+		if(dOut > dMaxOut) { dMaxOut = dOut; }
+
+		dwSamples = dwSamples + 1;
+	}
+
+	if(fTrace != stdin) {
+		fclose(fTrace);
+	}
+
+	if(dwSamples == 0) {
+		printf("No samples read\n");
+		return 1;
+	}
+
+	dRmsIn = sqrt(fabs(dSumSqIn / dwSamples - (dSumIn / dwSamples) * (dSumIn / dwSamples)));
+	dRmsOut = sqrt(fabs(dSumSqOut / dwSamples - (dSumOut / dwSamples) * (dSumOut / dwSamples)));
+
+	for(i = 0; i < bStages; i=i+1) {
+		printf("Stage %d: %d %d %d %d %d\n", i, coefficients[i].b0, coefficients[i].b1, coefficients[i].b2, coefficients[i].a1, coefficients[i].a2);
+	}
+	printf("Samples: %lu\n", dwSamples);
+	printf("Input:  mean %8.3f, noise %8.3f counts RMS, peak to peak %8.3f counts\n", dSumIn / dwSamples, dRmsIn, dMaxIn - dMinIn);
+	printf("Output: mean %8.3f, noise %8.3f counts RMS, peak to peak %8.3f counts\n", dSumOut / dwSamples, dRmsOut, dMaxOut - dMinOut);
+	if((dRmsIn > 0) && (dRmsOut > 0)) {
+		printf("Noise rejection: %.2f dB\n", 20.0 * log10(dRmsIn / dRmsOut));
+	}
+	printf("Cost: %u multiply accumulates per sample (%u stages)\n", 5 * bStages, bStages);
+
+	if(bCompare) {
+		if(dwCompared == 0) {
+			printf("Trace shorter than the calibration (%lu samples), nothing compared\n", dwInitSamples);
+			return 1;
+		}
+		printf("Fixed point vs. float: alpha %.4f (%u / %u), threshold %u counts, calibration %lu samples\n", dAlpha, alphaQ, ADC_ALPHA_ONE, (unsigned int)dThreshold, dwInitSamples);
+		printf("Centerline: fixed %8.4f, float %8.4f counts\n", (double)centerlineQ / (double)ADC_Q_ONE, (double)fCenterlineF);
+		printf("Moving average: max deviation %.4f counts over %lu samples\n", dMaxAvgDiff, dwCompared);
+		printf("Decisions above threshold: fixed %lu, float %lu, mismatches %lu\n", dwAboveQ, dwAboveF, dwMismatches);
+	}
+
+	if(bBench) {
+		if(dwSamples <= dwInitSamples) {
+			printf("Trace shorter than the calibration (%lu samples), nothing to benchmark\n", dwInitSamples);
+			free(lpBenchInput);
+			return 1;
+		}
+		runBenchmark(lpBenchInput, dwSamples, dwInitSamples, dAlpha, alphaQ, thresholdQ);
+		free(lpBenchInput);
+	}
+
+	return 0;
+}
@@ -0,0 +1,730 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <util/twi.h>
+
+#include "../../src/main.h"
+#include "../../src/i2c.h"
+#include "../../src/telemetry.h"
+#include "../../src/capture.h"
+#include "../../src/stream.h"
+#include "../../src/journal.h"
+
+#include "./selftestboard.h"
+
+/*
+	Firmware self test
+
+	Builds firmware modules on the host (with the stand in headers from
+	src/avrstub) and drives them the way the hardware would: bytes enter
+	through the TWI interrupt handler with the status codes a master
+	causes, the main loop is called in between. Every group prints the
+	checks that failed and a summary, the exit code is 0 only if all
+	checks passed.
+
+	Usage: piezoselftest [GROUP ...] - runs all groups if none is given
+*/
+
+volatile uint8_t SREG;
+volatile uint8_t TWAR;
+volatile uint8_t TWCR;
+volatile uint8_t TWDR;
+volatile uint8_t TWSR;
+volatile uint16_t TCNT1;
+
+struct eepromSettings currentSettings;
+
+extern void TWI_vect(void);
+
+/*
+	EEPROM model for the journal - addresses are the plain pointer values
+	the firmware passes, every byte counts how often it has been programmed
+*/
+static uint8_t eepromImage[E2END+1];
+static unsigned long int eepromWrites[E2END+1];
+
+static unsigned long int eepromAddress(const void* lpAddress) {
+	return ((unsigned long int)(uintptr_t)lpAddress) & E2END;
+}
+
+void eeprom_read_block(void* lpDst, const void* lpSrc, size_t dwLength) {
+	size_t i;
+	for(i = 0; i < dwLength; i=i+1) {
+		((uint8_t*)lpDst)[i] = eepromImage[(eepromAddress(lpSrc) + i) & E2END];
+	}
+}
+uint8_t eeprom_read_byte(const uint8_t* lpAddress) {
+	return eepromImage[eepromAddress(lpAddress)];
+}
+uint16_t eeprom_read_word(const uint16_t* lpAddress) {
+	/* Little endian like the AVR */
+	return (uint16_t)(eepromImage[eepromAddress(lpAddress)] | (eepromImage[(eepromAddress(lpAddress) + 1) & E2END] << 8));
+}
+void eeprom_write_byte(uint8_t* lpAddress, uint8_t bValue) {
+	eepromImage[eepromAddress(lpAddress)] = bValue;
+	eepromWrites[eepromAddress(lpAddress)] = eepromWrites[eepromAddress(lpAddress)] + 1;
+}
+void eeprom_update_byte(uint8_t* lpAddress, uint8_t bValue) {
+	if(eepromImage[eepromAddress(lpAddress)] != bValue) {
+		eeprom_write_byte(lpAddress, bValue);
+	}
+}
+int eeprom_is_ready(void) {
+	return 1;
+}
+
+static unsigned long int selftestPassed = 0;
+static unsigned long int selftestFailed = 0;
+
+static void selftestCheck(
+	bool bCondition,
+	const char* lpGroup,
+	const char* lpDescription
+) {
+	if(bCondition) {
+		selftestPassed = selftestPassed + 1;
+	} else {
+		selftestFailed = selftestFailed + 1;
+		printf("FAIL %s: %s\n", lpGroup, lpDescription);
+	}
+}
+
+/*
+	Command handler of the firmware - records what the main loop hands
+	over instead of executing it
+*/
+static unsigned long int handledFrames = 0;
+static uint8_t handledOpCode;
+static uint8_t handledPayload[I2C_BUFFER_SIZE_RX];
+static unsigned long int handledPayloadLength;
+
+void handleI2CMessage(
+	volatile uint8_t* lpRingbuffer,
+	unsigned long int dwBufferSize,
+	unsigned long int dwBase,
+	unsigned long int dwMessageSize
+) {
+	unsigned long int i;
+
+	handledFrames = handledFrames + 1;
+	handledOpCode = lpRingbuffer[dwBase];
+	handledPayloadLength = dwMessageSize - 2;
+	for(i = 0; (i < handledPayloadLength) && (i < sizeof(handledPayload)); i=i+1) {
+		handledPayload[i] = lpRingbuffer[(dwBase + 2 + i) % dwBufferSize];
+	}
+}
+
+/*
+	Bus model - one call of the interrupt handler per TWI event
+*/
+static void busEvent(uint8_t bStatus) {
+	TWSR = bStatus;
+	TWI_vect();
+}
+
+static void busWrite(
+	const uint8_t* lpData,
+	unsigned long int dwLength,
+	bool bStop
+) {
+	unsigned long int i;
+
+	busEvent(TW_SR_SLA_ACK);
+	for(i = 0; i < dwLength; i=i+1) {
+		TWDR = lpData[i];
+		busEvent(TW_SR_DATA_ACK);
+	}
+	if(bStop) {
+		busEvent(TW_SR_STOP);
+	}
+}
+
+/*
+	Read transaction - the master acknowledges every byte but the last
+*/
+static void busRead(
+	uint8_t* lpOut,
+	unsigned long int dwLength
+) {
+	unsigned long int i;
+
+	busEvent(TW_ST_SLA_ACK);
+	lpOut[0] = TWDR;
+	for(i = 1; i < dwLength; i=i+1) {
+		busEvent(TW_ST_DATA_ACK);
+		lpOut[i] = TWDR;
+	}
+	busEvent(TW_ST_DATA_NACK);
+}
+
+/*
+	Builds a frame as sent by the host library: sync pattern, opcode,
+	length, payload, xor checksum over opcode, length and payload
+*/
+static unsigned long int frameBuild(
+	uint8_t* lpOut,
+	uint8_t bOpCode,
+	const uint8_t* lpPayload,
+	uint8_t bLength
+) {
+	unsigned long int i;
+	uint8_t chkSum = bOpCode ^ bLength;
+
+	lpOut[0] = 0xAA;
+	lpOut[1] = 0x55;
+	lpOut[2] = 0xAA;
+	lpOut[3] = 0x55;
+	lpOut[4] = bOpCode;
+	lpOut[5] = bLength;
+	for(i = 0; i < bLength; i=i+1) {
+		lpOut[6+i] = lpPayload[i];
+		chkSum = chkSum ^ lpPayload[i];
+	}
+	lpOut[6+bLength] = chkSum;
+	return 7 + bLength;
+}
+
+/*
+	Hands every frame the interrupt completed to the command handler,
+	returns the number of frames handled
+*/
+static unsigned long int mainLoopDrain() {
+	unsigned long int dwBefore = handledFrames;
+	unsigned long int i;
+
+	for(i = 0; i < I2C_FRAME_SLOTS + 1; i=i+1) {
+		i2cMessageLoop();
+	}
+	return handledFrames - dwBefore;
+}
+
+static void selftestParser() {
+	static const char* lpGroup = "parser";
+	static const uint8_t payload[3] = { 0x10, 0x00, 0xAA };
+	uint8_t frame[16];
+	uint8_t buffer[64];
+	unsigned long int dwFrame;
+	unsigned long int dwLength;
+	uint32_t dwResyncs;
+
+	dwFrame = frameBuild(frame, 0x03, payload, sizeof(payload));
+
+	/* Plain frame */
+	busWrite(frame, dwFrame, true);
+	selftestCheck(mainLoopDrain() == 1, lpGroup, "plain frame is handled once");
+	selftestCheck((handledOpCode == 0x03) && (handledPayloadLength == 3) && (memcmp(handledPayload, payload, 3) == 0), lpGroup, "plain frame arrives unchanged");
+
+	/* Garbage in front of the sync pattern */
+	dwResyncs = telemetryCounters.dwResyncs;
+	buffer[0] = 0x12;
+	buffer[1] = 0x34;
+	buffer[2] = 0xAA;
+	memcpy(&(buffer[3]), frame, dwFrame);
+	busWrite(buffer, dwFrame + 3, true);
+	selftestCheck(mainLoopDrain() == 1, lpGroup, "frame after garbage is handled");
+	selftestCheck(telemetryCounters.dwResyncs == dwResyncs + 1, lpGroup, "garbage counts as one resynchronization");
+
+	/* Repeated sync pattern */
+	memcpy(buffer, frame, 4);
+	memcpy(&(buffer[4]), frame, dwFrame);
+	busWrite(buffer, dwFrame + 4, true);
+	selftestCheck(mainLoopDrain() == 1, lpGroup, "frame after a repeated sync pattern is handled");
+	selftestCheck((handledOpCode == 0x03) && (handledPayloadLength == 3), lpGroup, "repeated sync pattern is not taken as opcode");
+
+	/* Checksum error, the following frame has to survive */
+	memcpy(buffer, frame, dwFrame);
+	buffer[dwFrame-1] = buffer[dwFrame-1] ^ 0x01;
+	memcpy(&(buffer[dwFrame]), frame, dwFrame);
+	busWrite(buffer, 2 * dwFrame, true);
+	selftestCheck(mainLoopDrain() == 1, lpGroup, "frame with bad checksum is dropped, the next one is handled");
+	selftestCheck(telemetryCounters.dwChecksumErrors == 1, lpGroup, "checksum error is counted");
+
+	/* More frames than slots before the main loop runs */
+	busWrite(frame, dwFrame, true);
+	busWrite(frame, dwFrame, true);
+	busWrite(frame, dwFrame, true);
+	selftestCheck(mainLoopDrain() == I2C_FRAME_SLOTS, lpGroup, "all frame slots are handled");
+	selftestCheck(telemetryCounters.dwRxOverflows == 1, lpGroup, "frame without free slot counts as overflow");
+
+	/* Length that cannot fit a slot */
+	memcpy(buffer, frame, 4);
+	buffer[4] = 0x03;
+	buffer[5] = I2C_BUFFER_SIZE_RX;
+	memcpy(&(buffer[6]), frame, dwFrame);
+	busWrite(buffer, dwFrame + 6, true);
+	selftestCheck(mainLoopDrain() == 1, lpGroup, "oversized length resynchronizes to the next frame");
+
+	/* Truncated frames never swallow the start of the next transaction */
+	for(dwLength = 1; dwLength < dwFrame; dwLength=dwLength+1) {
+		busWrite(frame, dwLength, true);
+		busWrite(frame, dwFrame, true);
+		if(mainLoopDrain() != 1) { break; }
+	}
+	selftestCheck(dwLength == dwFrame, lpGroup, "frame truncated by a stop condition is discarded");
+
+	busWrite(frame, 7, false);
+	busWrite(frame, dwFrame, true);
+	selftestCheck(mainLoopDrain() == 1, lpGroup, "frame truncated by a repeated start is discarded");
+
+	busWrite(frame, 6, false);
+	busEvent(TW_BUS_ERROR);
+	busWrite(frame, dwFrame, true);
+	selftestCheck(mainLoopDrain() == 1, lpGroup, "frame interrupted by a bus error is discarded");
+	selftestCheck(telemetryCounters.dwBusErrors == 1, lpGroup, "bus error is counted");
+}
+
+static void selftestRegisters() {
+	static const char* lpGroup = "registers";
+	uint8_t snapshot[I2C_REGISTER_MAP_SIZE];
+	uint8_t bSelect;
+	uint8_t buffer[I2C_REGISTER_MAP_SIZE + 2];
+	unsigned long int i;
+	bool bSame;
+
+	for(i = 0; i < sizeof(snapshot); i=i+1) { snapshot[i] = (uint8_t)(0x40 + i); }
+	selftestCheck(i2cRegisterPublish(snapshot), lpGroup, "snapshot is published while nobody reads");
+
+	/* Select register 4, read with a repeated start */
+	bSelect = I2C_REGISTER_SELECT | 4;
+	busWrite(&bSelect, 1, false);
+	busRead(buffer, 4);
+	selftestCheck(memcmp(buffer, &(snapshot[4]), 4) == 0, lpGroup, "read starts at the selected register");
+
+	/* The selection stays for further reads, reads beyond the map return 0 */
+	bSelect = I2C_REGISTER_SELECT | (I2C_REGISTER_MAP_SIZE - 2);
+	busWrite(&bSelect, 1, true);
+	busRead(buffer, 4);
+	selftestCheck((buffer[0] == snapshot[I2C_REGISTER_MAP_SIZE-2]) && (buffer[1] == snapshot[I2C_REGISTER_MAP_SIZE-1]) && (buffer[2] == 0) && (buffer[3] == 0), lpGroup, "reads beyond the map return 0x00");
+
+	/* A snapshot published during a read does not tear it */
+	bSelect = I2C_REGISTER_SELECT | 0;
+	busWrite(&bSelect, 1, false);
+	busEvent(TW_ST_SLA_ACK);
+	buffer[0] = TWDR;
+	for(i = 0; i < sizeof(snapshot); i=i+1) { snapshot[i] = (uint8_t)(0x80 + i); }
+	selftestCheck(i2cRegisterPublish(snapshot), lpGroup, "snapshot is published into the buffer not being read");
+	selftestCheck(!i2cRegisterPublish(snapshot), lpGroup, "buffer latched by a running read is not overwritten");
+	for(i = 1; i < I2C_REGISTER_MAP_SIZE; i=i+1) {
+		busEvent(TW_ST_DATA_ACK);
+		buffer[i] = TWDR;
+	}
+	busEvent(TW_ST_DATA_NACK);
+	bSame = true;
+	for(i = 0; i < I2C_REGISTER_MAP_SIZE; i=i+1) {
+		if(buffer[i] != (uint8_t)(0x40 + i)) { bSame = false; }
+	}
+	selftestCheck(bSame, lpGroup, "running read returns the complete old snapshot");
+
+	busRead(buffer, I2C_REGISTER_MAP_SIZE);
+	selftestCheck(memcmp(buffer, snapshot, I2C_REGISTER_MAP_SIZE) == 0, lpGroup, "next read returns the new snapshot");
+
+	/* Any other write returns to packet mode */
+	busWrite(buffer, 0, true);
+	busRead(buffer, 1);
+	selftestCheck((buffer[0] == 0x00) && (telemetryCounters.dwTxUnderruns == 1), lpGroup, "read after a plain write is served from the transmit ring");
+}
+
+/*
+	Reads the two ready status bytes (flags and queued bytes)
+*/
+static void readyStatus(uint8_t* lpOut) {
+	uint8_t bSelect = I2C_READY_SELECT;
+
+	busWrite(&bSelect, 1, false);
+	busRead(lpOut, 2);
+}
+
+static void selftestReady() {
+	static const char* lpGroup = "ready";
+	static const uint8_t payload[3] = { 0x21, 0x42, 0x84 };
+	uint8_t frame[16];
+	uint8_t buffer[16];
+	unsigned long int dwLen;
+
+	readyStatus(buffer);
+	selftestCheck((buffer[0] == 0x00) && (buffer[1] == 0), lpGroup, "idle board reports no flags and no queued bytes");
+
+	dwLen = frameBuild(frame, 0x05, payload, sizeof(payload));
+	busWrite(frame, dwLen, true);
+	readyStatus(buffer);
+	selftestCheck(buffer[0] == I2C_READY__BUSY, lpGroup, "received frame reports busy until the main loop handled it");
+
+	selftestCheck(mainLoopDrain() == 1, lpGroup, "frame is handled after the ready poll");
+	readyStatus(buffer);
+	selftestCheck(buffer[0] == 0x00, lpGroup, "busy is cleared after the frame has been handled");
+
+	selftestCheck(i2cTransmitPacket((uint8_t*)payload, 0x05, sizeof(payload)), lpGroup, "response is queued");
+	readyStatus(buffer);
+	selftestCheck((buffer[0] == I2C_READY__RESPONSE) && (buffer[1] == 7 + sizeof(payload)), lpGroup, "queued response is reported with its length");
+	readyStatus(buffer);
+	selftestCheck(buffer[1] == 7 + sizeof(payload), lpGroup, "polling the ready status does not consume the response");
+
+	/* The select is only valid for one read - the next read gets the response */
+	busRead(buffer, 7 + sizeof(payload));
+	selftestCheck(
+		(buffer[0] == 0xAA) && (buffer[1] == 0x55) && (buffer[2] == 0xAA) && (buffer[3] == 0x55) &&
+		(buffer[4] == 0x05) && (buffer[5] == sizeof(payload) + 2) &&
+		(memcmp(&(buffer[6]), payload, sizeof(payload)) == 0) &&
+		(buffer[9] == (0x05 ^ (sizeof(payload) + 2) ^ 0x21 ^ 0x42 ^ 0x84)),
+		lpGroup, "read after the ready status returns the response frame"
+	);
+	readyStatus(buffer);
+	selftestCheck((buffer[0] == 0x00) && (buffer[1] == 0), lpGroup, "ring is empty after the response has been read");
+}
+
+/*
+	Checks a response frame as queued by i2cTransmitPacket
+*/
+static bool responseCheck(
+	const uint8_t* lpFrame,
+	uint8_t bOpCode,
+	const uint8_t* lpPayload,
+	unsigned long int dwPayloadLength
+) {
+	unsigned long int i;
+	uint8_t chkSum = bOpCode ^ (uint8_t)(dwPayloadLength + 2);
+
+	if((lpFrame[0] != 0xAA) || (lpFrame[1] != 0x55) || (lpFrame[2] != 0xAA) || (lpFrame[3] != 0x55)) { return false; }
+	if((lpFrame[4] != bOpCode) || (lpFrame[5] != (uint8_t)(dwPayloadLength + 2))) { return false; }
+	for(i = 0; i < dwPayloadLength; i=i+1) {
+		if(lpFrame[6+i] != lpPayload[i]) { return false; }
+		chkSum = chkSum ^ lpPayload[i];
+	}
+	return (lpFrame[6+dwPayloadLength] == chkSum) ? true : false;
+}
+
+static void selftestTransmitRing() {
+	static const char* lpGroup = "txring";
+	uint8_t payload[I2C_BUFFER_SIZE_TX];
+	uint8_t buffer[2*I2C_BUFFER_SIZE_TX];
+	uint8_t status[2];
+	unsigned long int dwFirst = (I2C_BUFFER_SIZE_TX - 1) - 7;
+	unsigned long int i;
+	uint32_t dwRejected = telemetryCounters.dwTxRejected;
+
+	for(i = 0; i < sizeof(payload); i=i+1) { payload[i] = (uint8_t)(3*i + 1); }
+
+	selftestCheck(!i2cTransmitPacket(payload, 0x11, dwFirst + 1), lpGroup, "frame larger than the ring is refused");
+	selftestCheck(telemetryCounters.dwTxRejected == dwRejected + 1, lpGroup, "refused frame is counted");
+	readyStatus(status);
+	selftestCheck((status[0] == I2C_READY__DROPPED) && (status[1] == 0), lpGroup, "refused frame is reported and nothing is queued");
+	readyStatus(status);
+	selftestCheck(status[0] == 0x00, lpGroup, "dropped flag is cleared by the read");
+
+	selftestCheck(i2cTransmitPacket(payload, 0x11, dwFirst), lpGroup, "frame filling the whole ring is queued");
+
+	/* Host has read the beginning only, the rest is still unread */
+	busRead(buffer, 10);
+	selftestCheck(!i2cTransmitPacket(payload, 0x12, 4), lpGroup, "frame larger than the space freed by a partial read is refused");
+	selftestCheck(!i2cTransmitBytes(payload, 11), lpGroup, "raw bytes larger than the free space are refused");
+	selftestCheck(telemetryCounters.dwTxRejected == dwRejected + 3, lpGroup, "every refused response is counted");
+	selftestCheck(i2cTransmitPacket(payload, 0x12, 3), lpGroup, "frame fitting the freed space wraps around the ring");
+
+	readyStatus(status);
+	selftestCheck((status[0] == (I2C_READY__RESPONSE | I2C_READY__DROPPED)) && (status[1] == I2C_BUFFER_SIZE_TX - 1), lpGroup, "ready status reports the drop and a full ring");
+	readyStatus(status);
+	selftestCheck(status[0] == I2C_READY__RESPONSE, lpGroup, "dropped flag is not reported twice");
+
+	/* Rest of the first frame and the whole second frame - a full ring again */
+	busRead(&(buffer[10]), I2C_BUFFER_SIZE_TX - 1);
+	selftestCheck(responseCheck(buffer, 0x11, payload, dwFirst), lpGroup, "first frame is intact");
+	selftestCheck(responseCheck(&(buffer[7 + dwFirst]), 0x12, payload, 3), lpGroup, "second frame follows the first one intact");
+}
+
+/*
+	Settings images are handled as raw bytes by the journal. The checksum
+	is set at the byte offsets the journal checks - the host layout of
+	struct eepromSettings may differ from the AVR one
+*/
+static void settingsFill(struct eepromSettings* lpSettings, uint8_t bSeed) {
+	unsigned long int i;
+	uint8_t* lpImage = (uint8_t*)lpSettings;
+	uint8_t chkSum = 0;
+
+	for(i = 0; i < sizeof(struct eepromSettings)-2; i=i+1) {
+		lpImage[i] = (uint8_t)(bSeed + 7*i);
+		chkSum = chkSum ^ lpImage[i];
+	}
+	lpImage[sizeof(struct eepromSettings)-2] = chkSum;
+	lpImage[sizeof(struct eepromSettings)-1] = chkSum ^ 0xFF;
+}
+
+static void settingsPatch(struct eepromSettings* lpSettings, unsigned long int dwOffset, uint8_t bValue) {
+	uint8_t* lpImage = (uint8_t*)lpSettings;
+
+	lpImage[sizeof(struct eepromSettings)-2] = lpImage[sizeof(struct eepromSettings)-2] ^ lpImage[dwOffset] ^ bValue;
+	lpImage[sizeof(struct eepromSettings)-1] = lpImage[sizeof(struct eepromSettings)-2] ^ 0xFF;
+	lpImage[dwOffset] = bValue;
+}
+
+/*
+	Runs the main loop journal task till the journal is idle, returns the
+	number of calls or 0 if it never got idle
+*/
+static unsigned long int journalDrain() {
+	unsigned long int i;
+	uint16_t generation;
+	uint16_t recordsUsed;
+
+	for(i = 1; i < 100000; i=i+1) {
+		journalTask();
+		if(journalStatus(&generation, &recordsUsed) == journalState_Idle) { return i; }
+	}
+	return 0;
+}
+
+static void selftestJournal() {
+	static const char* lpGroup = "journal";
+	struct eepromSettings stored;
+	struct eepromSettings loaded;
+	struct eepromSettings interrupted;
+	struct eepromSettings profile;
+	uint16_t generation;
+	uint16_t recordsUsed;
+	uint16_t recordsBefore;
+	unsigned long int i;
+	unsigned long int dwMaxWrites;
+	bool bCompacted;
+
+	memset(eepromImage, 0xFF, sizeof(eepromImage));
+	memset(eepromWrites, 0, sizeof(eepromWrites));
+
+	selftestCheck(!journalLoad(&loaded), lpGroup, "erased EEPROM holds no settings");
+
+	/* First store writes a base slot */
+	settingsFill(&stored, 0x31);
+	journalStore(&stored);
+	selftestCheck(journalDrain() != 0, lpGroup, "first store completes");
+	selftestCheck(journalLoad(&loaded) && (memcmp(&loaded, &stored, sizeof(stored)) == 0), lpGroup, "first store is loaded back");
+	journalStatus(&generation, &recordsUsed);
+	selftestCheck(recordsUsed == 0, lpGroup, "base slot holds the image without records");
+
+	/* Small change - records for the differing bytes and a commit */
+	settingsPatch(&stored, 3, 0x99);
+	journalStore(&stored);
+	selftestCheck(journalDrain() != 0, lpGroup, "incremental store completes");
+	journalStatus(&generation, &recordsUsed);
+	selftestCheck((recordsUsed >= 2) && (recordsUsed <= 4), lpGroup, "incremental store appends a record per changed byte and a commit");
+	selftestCheck(journalLoad(&loaded) && (memcmp(&loaded, &stored, sizeof(stored)) == 0), lpGroup, "records are replayed on load");
+
+	/* Storing identical settings writes nothing */
+	journalStatus(&generation, &recordsBefore);
+	journalStore(&stored);
+	journalDrain();
+	journalStatus(&generation, &recordsUsed);
+	selftestCheck(recordsUsed == recordsBefore, lpGroup, "unchanged settings append no records");
+
+	/* Session interrupted before its commit (power loss) */
+	interrupted = stored;
+	settingsPatch(&interrupted, 5, 0x5A);
+	journalStore(&interrupted);
+	for(i = 0; i < JOURNAL_RECORD_SIZE+1; i=i+1) { journalTask(); }
+	selftestCheck(journalLoad(&loaded) && (memcmp(&loaded, &stored, sizeof(stored)) == 0), lpGroup, "records without a commit are ignored on load");
+
+	/* The next session overwrites the uncommitted records */
+	settingsPatch(&stored, 6, 0xA5);
+	journalStore(&stored);
+	journalDrain();
+	selftestCheck(journalLoad(&loaded) && (memcmp(&loaded, &stored, sizeof(stored)) == 0), lpGroup, "store after an interrupted session is loaded back");
+
+	/* Run the journal full - compaction moves to the other base slot */
+	journalStatus(&generation, &recordsUsed);
+	bCompacted = false;
+	for(i = 0; i < 4*JOURNAL_RECORDS; i=i+1) {
+		uint16_t generationNow;
+
+		settingsPatch(&stored, 10 + (i % 8), (uint8_t)i);
+		journalStore(&stored);
+		journalDrain();
+		journalStatus(&generationNow, &recordsUsed);
+		if(generationNow != generation) { bCompacted = true; }
+	}
+	selftestCheck(bCompacted, lpGroup, "full journal is compacted into the other base slot");
+	selftestCheck(journalLoad(&loaded) && (memcmp(&loaded, &stored, sizeof(stored)) == 0), lpGroup, "settings survive compactions");
+
+	/* Wear spreads over the record area instead of hitting one slot */
+	dwMaxWrites = 0;
+	for(i = JOURNAL_RECORD_START; i < JOURNAL_PROFILE_START; i=i+1) {
+		if(eepromWrites[i] > dwMaxWrites) { dwMaxWrites = eepromWrites[i]; }
+	}
+	selftestCheck(dwMaxWrites < 4*JOURNAL_RECORDS / 8, lpGroup, "record bytes are written far less often than stores happened");
+
+	/* Profiles - served from RAM till written, then from EEPROM */
+	memset(&loaded, 0x00, sizeof(loaded));
+	selftestCheck(!journalProfileLoad(2, &loaded), lpGroup, "empty profile slot is not loaded");
+	settingsFill(&profile, 0x77);
+	selftestCheck(journalProfileSave(1, &profile), lpGroup, "profile save is queued");
+	selftestCheck(journalProfileLoad(1, &loaded) && (memcmp(&loaded, &profile, sizeof(profile)) == 0), lpGroup, "profile being written is loaded from RAM");
+	settingsFill(&loaded, 0x00);
+	selftestCheck(!journalProfileSave(2, &loaded), lpGroup, "profile for another slot is refused while one is written");
+	selftestCheck(journalProfilesValid() == 0x02, lpGroup, "valid profile mask includes the profile being written");
+
+	/* A store during the profile write follows it */
+	settingsPatch(&stored, 4, 0x44);
+	journalStore(&stored);
+	selftestCheck(journalDrain() != 0, lpGroup, "profile write and queued store complete");
+	memset(&loaded, 0x00, sizeof(loaded));
+	selftestCheck(journalProfileLoad(1, &loaded) && (memcmp(&loaded, &profile, sizeof(profile)) == 0), lpGroup, "written profile is loaded from EEPROM");
+	selftestCheck(journalLoad(&loaded) && (memcmp(&loaded, &stored, sizeof(stored)) == 0), lpGroup, "store queued behind the profile is persisted");
+	selftestCheck(journalProfilesValid() == 0x02, lpGroup, "valid profile mask after a reboot");
+
+	/* Damaged profile slot */
+	eepromImage[JOURNAL_PROFILE_START + sizeof(struct eepromSettings) + 1] = eepromImage[JOURNAL_PROFILE_START + sizeof(struct eepromSettings) + 1] ^ 0x01;
+	memset(&loaded, 0x00, sizeof(loaded));
+	selftestCheck(!journalProfileLoad(1, &loaded), lpGroup, "damaged profile is not loaded");
+	for(i = 0; (i < sizeof(loaded)) && (((uint8_t*)&loaded)[i] == 0); i=i+1) { }
+	selftestCheck(i == sizeof(loaded), lpGroup, "damaged profile leaves the settings untouched");
+}
+
+void selftestBusWriteRead(
+	const uint8_t* lpData,
+	unsigned long int dwDataLength,
+	uint8_t* lpOut,
+	unsigned long int dwOutLength
+) {
+	busWrite(lpData, dwDataLength, false);
+	busRead(lpOut, dwOutLength);
+}
+
+/*
+	Feeds dwRounds conversion rounds over the channels in bMask into the
+	stream. Steps between two samples of a channel cover the delta limits
+	(+-7 fits a nibble, +-8 does not) and large jumps
+*/
+static unsigned long int streamFeed(
+	uint8_t bMask,
+	unsigned long int dwFirstRound,
+	unsigned long int dwRounds,
+	uint8_t* lpChannels,
+	uint16_t* lpValues
+) {
+	static const int16_t offsets[9] = { 0, 7, 0, -8, 0, 8, 1, 200, 0 };
+	unsigned long int i;
+	unsigned long int n = 0;
+	uint8_t channel;
+	uint8_t next;
+
+	for(i = dwFirstRound; i < dwFirstRound + dwRounds; i=i+1) {
+		for(channel = 0; channel < 4; channel=channel+1) {
+			uint16_t value = (uint16_t)(500 + 100*channel + offsets[(i + channel) % 9]);
+
+			if((bMask & (1 << channel)) == 0) { continue; }
+			for(next = (channel + 1) & 0x03; (bMask & (1 << next)) == 0; next = (next + 1) & 0x03) { }
+
+			lpChannels[n] = channel;
+			lpValues[n] = value;
+			streamStore(channel, value, bMask, next);
+			n = n + 1;
+		}
+	}
+	return n;
+}
+
+static void selftestStream() {
+	static const char* lpGroup = "stream";
+	static const uint8_t encodings[3] = { STREAM_ENCODING_RAW, STREAM_ENCODING_PACKED10, STREAM_ENCODING_DELTA };
+	static const char* lpEncodingNames[3] = { "raw", "packed10", "delta" };
+	static uint8_t channels[(STREAM_BLOCKS+1) * STREAM_SAMPLES_MAX];
+	static uint16_t values[(STREAM_BLOCKS+1) * STREAM_SAMPLES_MAX];
+	static uint8_t decodedChannels[STREAM_BLOCKS * SELFTESTBOARD_STREAM_SAMPLES_MAX];
+	static uint16_t decodedValues[STREAM_BLOCKS * SELFTESTBOARD_STREAM_SAMPLES_MAX];
+	uint8_t sequences[STREAM_BLOCKS];
+	uint8_t overflows[STREAM_BLOCKS];
+	uint8_t blockSamples[STREAM_BLOCKS];
+	unsigned long int e;
+	unsigned long int i;
+	unsigned long int dwFed;
+	unsigned long int dwDecoded;
+	long int lRead;
+	char description[128];
+	bool bMatch;
+
+	for(e = 0; e < sizeof(encodings)/sizeof(encodings[0]); e=e+1) {
+		streamEnable(false, STREAM_ENCODING_RAW);
+		streamEnable(true, encodings[e]);
+		selftestBoardOpen();
+
+		/* Channels 0, 1 and 3 fitted - enough samples for more than one block */
+		dwFed = streamFeed(0x0B, 0, (STREAM_BLOCKS - 1) * STREAM_BLOCK_SAMPLES / 3, channels, values);
+
+		lRead = selftestBoardReadStream(STREAM_BLOCKS, sequences, overflows, blockSamples, decodedChannels, decodedValues);
+		bMatch = (lRead > 1) ? true : false;
+		dwDecoded = 0;
+		for(i = 0; bMatch && (i < (unsigned long int)lRead); i=i+1) {
+			if((sequences[i] != i) || (overflows[i] != 0)) { bMatch = false; }
+			dwDecoded = dwDecoded + blockSamples[i];
+		}
+		/* Only the samples of the block still open are missing */
+		if(bMatch && ((dwDecoded > dwFed) || (dwDecoded + streamBlockSamples(encodings[e]) <= dwFed))) { bMatch = false; }
+		if(bMatch && ((memcmp(decodedChannels, channels, dwDecoded) != 0) || (memcmp(decodedValues, values, dwDecoded * sizeof(uint16_t)) != 0))) { bMatch = false; }
+		sprintf(description, "%s blocks decode to the stored samples", lpEncodingNames[e]);
+		selftestCheck(bMatch, lpGroup, description);
+
+		/* Nothing complete anymore - the board answers with filler blocks */
+		lRead = selftestBoardReadStream(2, sequences, overflows, blockSamples, decodedChannels, decodedValues);
+		sprintf(description, "%s stream without complete blocks returns fillers only", lpEncodingNames[e]);
+		selftestCheck(lRead == 0, lpGroup, description);
+	}
+
+	/* Host does not keep up - samples are dropped and the next block is flagged */
+	streamEnable(false, STREAM_ENCODING_RAW);
+	streamEnable(true, STREAM_ENCODING_RAW);
+	selftestBoardOpen();
+	streamFeed(0x0F, 0, (STREAM_BLOCKS + 2) * STREAM_BLOCK_SAMPLES / 4, channels, values);
+	lRead = selftestBoardReadStream(STREAM_BLOCKS, sequences, overflows, blockSamples, decodedChannels, decodedValues);
+	selftestCheck((lRead == STREAM_BLOCKS) && (overflows[STREAM_BLOCKS-1] == 0), lpGroup, "full stream buffer is read completely");
+	streamFeed(0x0F, 0, STREAM_BLOCK_SAMPLES / 4, channels, values);
+	lRead = selftestBoardReadStream(1, sequences, overflows, blockSamples, decodedChannels, decodedValues);
+	selftestCheck((lRead == 1) && (overflows[0] != 0) && (sequences[0] == STREAM_BLOCKS), lpGroup, "block after dropped samples is flagged");
+
+	/* Sampling reconfigured in the middle of a block - the block is closed early */
+	streamEnable(false, STREAM_ENCODING_RAW);
+	streamEnable(true, STREAM_ENCODING_DELTA);
+	selftestBoardOpen();
+	dwFed = streamFeed(0x03, 0, 3, channels, values);
+	streamFeed(0x0C, 3, STREAM_SAMPLES_MAX / 2, &(channels[dwFed]), &(values[dwFed]));
+	lRead = selftestBoardReadStream(2, sequences, overflows, blockSamples, decodedChannels, decodedValues);
+	selftestCheck((lRead == 2) && (blockSamples[0] == 6) && (decodedChannels[6] == 2) && (decodedValues[6] == values[6]), lpGroup, "changed channel mask closes the block");
+
+	streamEnable(false, STREAM_ENCODING_RAW);
+	selftestBoardClose();
+}
+
+struct selftestGroup {
+	const char*							lpName;
+	void								(*lpfnRun)();
+};
+
+static const struct selftestGroup selftestGroups[] = {
+	{ "parser",			&selftestParser },
+	{ "registers",		&selftestRegisters },
+	{ "ready",			&selftestReady },
+	{ "txring",			&selftestTransmitRing },
+	{ "journal",		&selftestJournal },
+	{ "stream",			&selftestStream },
+};
+
+int main(int argc, char* argv[]) {
+	unsigned long int i;
+	int j;
+	bool bSelected;
+
+	for(i = 0; i < sizeof(selftestGroups)/sizeof(selftestGroups[0]); i=i+1) {
+		bSelected = (argc < 2) ? true : false;
+		for(j = 1; j < argc; j=j+1) {
+			if(strcmp(argv[j], selftestGroups[i].lpName) == 0) { bSelected = true; }
+		}
+		if(!bSelected) { continue; }
+
+		/* Every group starts with freshly reset firmware state where it matters */
+		telemetryReset();
+		selftestGroups[i].lpfnRun();
+		printf("%s done\n", selftestGroups[i].lpName);
+	}
+
+	printf("%lu checks passed, %lu failed\n", selftestPassed, selftestFailed);
+	return (selftestFailed == 0) ? 0 : 1;
+}
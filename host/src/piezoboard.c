@@ -26,6 +26,42 @@ enum piezoboardImpl_OpCode {
 	opCode_StoreSettings					= 0x0A,
 	opCode_GetAlpha							= 0x0B,
 	opCode_SetAlpha							= 0x0C,
+	opCode_GetFilterMode					= 0x0D,
+	opCode_SetFilterMode					= 0x0E,
+	opCode_GetDetectorMode					= 0x0F,
+	opCode_SetDetectorMode					= 0x10,
+	opCode_GetTriggerLatency				= 0x11,
+	opCode_GetSampling						= 0x12,
+	opCode_SetSampling						= 0x13,
+	opCode_GetActiveChannels				= 0x14,
+	opCode_SetActiveChannels				= 0x15,
+	opCode_GetBiquad						= 0x16,
+	opCode_SetBiquad						= 0x17,
+	opCode_GetThresholdMode					= 0x18,
+	opCode_SetThresholdMode					= 0x19,
+	opCode_GetNoiseStatistics				= 0x1A,
+	opCode_GetBaselineTracking				= 0x1B,
+	opCode_SetBaselineTracking				= 0x1C,
+	opCode_ReadEvent						= 0x1D,
+	opCode_ClearEvents						= 0x1E,
+	opCode_GetCaptureStatus					= 0x1F,
+	opCode_SetCaptureConfig					= 0x20,
+	opCode_ArmCapture						= 0x21,
+	opCode_ReadCapture						= 0x22,
+	opCode_GetTelemetry						= 0x23,
+	opCode_ResetTelemetry					= 0x24,
+	opCode_GetProfile						= 0x25,
+	opCode_ResetProfile						= 0x26,
+	opCode_GetQualifier						= 0x27,
+	opCode_SetQualifier						= 0x28,
+	opCode_GetStoreStatus					= 0x29,
+	opCode_GetTuningProfiles				= 0x2A,
+	opCode_SaveTuningProfile				= 0x2B,
+	opCode_ActivateTuningProfile			= 0x2C,
+	opCode_GetSettings						= 0x2D,
+	opCode_SetSettings						= 0x2E,
+	opCode_SetStream						= 0x2F,
+	opCode_GetStreamStatus					= 0x30,
 };
 
 struct piezoboardImpl {
@@ -34,10 +70,212 @@ struct piezoboardImpl {
 	struct i2cBus*							lpBus;
 	uint8_t									devAddress;
 	uint32_t								dwFlags;
+
+	bool									bStreamSynced;		/* bStreamSequence holds the last received block */
+	uint8_t									bStreamSequence;
 };
 
-static void responseDelay() {
-	usleep(1000 * 25);
+/*
+	Maximum size of a framed packet we ever exchange with the board. This
+	matches the receive and transmit ringbuffers of the firmware
+*/
+#define PIEZOBOARD_MAX_PACKET_SIZE			64
+
+/*
+	Instead of sleeping a fixed time after every request the ready status
+	of the board is polled (write PIEZOBOARD_READY_SELECT, repeated start,
+	read flags and the number of queued bytes). The delay between polls
+	starts short and doubles up to PIEZOBOARD_POLL_DELAY_MAX so quick
+	commands return within a fraction of a millisecond while slow ones do
+	not flood the bus
+*/
+#define PIEZOBOARD_READY_SELECT				0xC0
+#define PIEZOBOARD_READY__BUSY				0x01
+#define PIEZOBOARD_READY__RESPONSE			0x02
+#define PIEZOBOARD_READY__DROPPED			0x04		/* A response did not fit the transmit ring of the board */
+
+#define PIEZOBOARD_POLL_DELAY_MIN			100			/* Microseconds */
+#define PIEZOBOARD_POLL_DELAY_MAX			5000
+#define PIEZOBOARD_POLL_TIMEOUT				500000
+
+/*
+	Waits till the board has handled all received commands and at least
+	dwResponseLength bytes are queued for us. If the board had to discard
+	a response (bytes of an earlier one were still unread) the leftover
+	bytes are drained so the next request starts with an empty ring
+*/
+static enum piezoboardError piezoboardImpl__WaitReady(
+	struct piezoboardImpl* lpThis,
+	unsigned long int dwResponseLength
+) {
+	enum i2cError ei2c;
+	uint8_t bSelect[1] = { PIEZOBOARD_READY_SELECT };
+	uint8_t bStatus[2];
+	unsigned long int dwDelay = PIEZOBOARD_POLL_DELAY_MIN;
+	unsigned long int dwWaited = 0;
+
+	for(;;) {
+		ei2c = lpThis->lpBus->vtbl->writeRead(lpThis->lpBus, lpThis->devAddress, bSelect, sizeof(bSelect), bStatus, sizeof(bStatus));
+		if(ei2c != i2cE_Ok) {
+			#ifdef DEBUG
+				printf("%s:%u Ready status read failed (%u)\n", __FILE__, __LINE__, ei2c);
+			#endif
+			return piezoE_CommunicationError;
+		}
+
+		if((bStatus[0] & PIEZOBOARD_READY__DROPPED) != 0) {
+			uint8_t bDiscard[PIEZOBOARD_MAX_PACKET_SIZE];
+
+			#ifdef DEBUG
+				printf("%s:%u Response dropped by the board, discarding %u queued bytes\n", __FILE__, __LINE__, bStatus[1]);
+			#endif
+			if((bStatus[1] > 0) && (bStatus[1] <= sizeof(bDiscard))) {
+				lpThis->lpBus->vtbl->read(lpThis->lpBus, lpThis->devAddress, bDiscard, bStatus[1]);
+			}
+			return piezoE_Failed;
+		}
+
+		if(((bStatus[0] & PIEZOBOARD_READY__BUSY) == 0) && (bStatus[1] >= dwResponseLength)) {
+			return piezoE_Ok;
+		}
+
+		if(dwWaited >= PIEZOBOARD_POLL_TIMEOUT) {
+			#ifdef DEBUG
+				printf("%s:%u Board not ready in time (status 0x%02x, %u bytes queued)\n", __FILE__, __LINE__, bStatus[0], bStatus[1]);
+			#endif
+			return piezoE_Failed;
+		}
+
+		usleep(dwDelay);
+		dwWaited = dwWaited + dwDelay;
+		dwDelay = dwDelay * 2;
+		if(dwDelay > PIEZOBOARD_POLL_DELAY_MAX) { dwDelay = PIEZOBOARD_POLL_DELAY_MAX; }
+	}
+}
+
+/*
+	Generic helpers used by simple set/get style commands. SendCommand
+	frames and writes a request without response and returns once the
+	board has handled it, Query additionally waits for the response and
+	validates it. The response payload (without sync pattern, opcode,
+	length and checksum) is written into lpResponse
+*/
+static enum piezoboardError piezoboardImpl__WriteCommand(
+	struct piezoboardImpl* lpThis,
+	uint8_t bOpCode,
+	uint8_t* lpPayload,
+	unsigned long int dwPayloadLength
+) {
+	enum i2cError ei2c;
+	uint8_t bCommand[PIEZOBOARD_MAX_PACKET_SIZE];
+	unsigned long int i;
+
+	if(dwPayloadLength > (PIEZOBOARD_MAX_PACKET_SIZE - 7)) { return piezoE_InvalidParam; }
+	if((dwPayloadLength > 0) && (lpPayload == NULL)) { return piezoE_InvalidParam; }
+
+	bCommand[0] = 0xAA;
+	bCommand[1] = 0x55;
+	bCommand[2] = 0xAA;
+	bCommand[3] = 0x55;
+	bCommand[4] = bOpCode;
+	bCommand[5] = (uint8_t)dwPayloadLength;
+	for(i = 0; i < dwPayloadLength; i=i+1) {
+		bCommand[6+i] = lpPayload[i];
+	}
+
+	bCommand[6+dwPayloadLength] = 0x00;
+	for(i = 4; i < 6+dwPayloadLength; i=i+1) {
+		bCommand[6+dwPayloadLength] = bCommand[6+dwPayloadLength] ^ bCommand[i];
+	}
+
+	ei2c = lpThis->lpBus->vtbl->write(lpThis->lpBus, lpThis->devAddress, bCommand, 6+dwPayloadLength+1);
+	if(ei2c != i2cE_Ok) {
+		#ifdef DEBUG
+			printf("%s:%u Write failed (%u)\n", __FILE__, __LINE__, ei2c);
+		#endif
+		return piezoE_CommunicationError;
+	}
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__SendCommand(
+	struct piezoboardImpl* lpThis,
+	uint8_t bOpCode,
+	uint8_t* lpPayload,
+	unsigned long int dwPayloadLength
+) {
+	enum piezoboardError e;
+
+	e = piezoboardImpl__WriteCommand(lpThis, bOpCode, lpPayload, dwPayloadLength);
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	return piezoboardImpl__WaitReady(lpThis, 0);
+}
+static enum piezoboardError piezoboardImpl__Query(
+	struct piezoboardImpl* lpThis,
+	uint8_t bOpCode,
+	uint8_t* lpPayload,
+	unsigned long int dwPayloadLength,
+	uint8_t* lpResponse,
+	unsigned long int dwResponseLength
+) {
+	enum piezoboardError e;
+	enum i2cError ei2c;
+	uint8_t bResponse[PIEZOBOARD_MAX_PACKET_SIZE];
+	unsigned long int i;
+
+	if(dwResponseLength > (PIEZOBOARD_MAX_PACKET_SIZE - 7)) { return piezoE_InvalidParam; }
+	if((dwResponseLength > 0) && (lpResponse == NULL)) { return piezoE_InvalidParam; }
+
+	e = piezoboardImpl__WriteCommand(lpThis, bOpCode, lpPayload, dwPayloadLength);
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	/* Wait till the response has been queued */
+	e = piezoboardImpl__WaitReady(lpThis, 6+dwResponseLength+1);
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	/* Read response */
+	ei2c = lpThis->lpBus->vtbl->read(lpThis->lpBus, lpThis->devAddress, bResponse, 6+dwResponseLength+1);
+	if(ei2c != i2cE_Ok) {
+		#ifdef DEBUG
+			printf("%s:%u Read failed (%u)\n", __FILE__, __LINE__, ei2c);
+		#endif
+		return piezoE_Failed;
+	}
+
+	/* Validate response */
+	if((bResponse[0] != 0xAA) || (bResponse[1] != 0x55) || (bResponse[2] != 0xAA) || (bResponse[3] != 0x55) || (bResponse[4] != bOpCode) || (bResponse[5] != (dwResponseLength + 2))) {
+		#ifdef DEBUG
+			printf("%s:%u Packet format error\n", __FILE__, __LINE__);
+		#endif
+		return piezoE_CommunicationError;
+	}
+
+	/* Checksum verification */
+	{
+		uint8_t chkSum = 0x00;
+		for(i = 4; i < 6+dwResponseLength+1; i=i+1) {
+			chkSum = chkSum ^ bResponse[i];
+		}
+		if(chkSum != 0x00) {
+			#ifdef DEBUG
+				printf("%s:%u Checksum format error\n", __FILE__, __LINE__);
+			#endif
+			return piezoE_ChecksumError;
+		}
+	}
+
+	for(i = 0; i < dwResponseLength; i=i+1) {
+		lpResponse[i] = bResponse[6+i];
+	}
+
+	return piezoE_Ok;
 }
 
 static enum piezoboardError piezoboardImpl__Release(
@@ -65,6 +303,7 @@ static enum piezoboardError piezoboardImpl__Identify(
 	uint8_t* lpVersionOut
 ) {
 	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
 	enum i2cError ei2c;
 	uint8_t bResponse[16+1+4+2+1];
 
@@ -81,8 +320,11 @@ static enum piezoboardError piezoboardImpl__Identify(
 		return piezoE_Failed;
 	}
 
-	/* Delay */
-	responseDelay();
+	/* Wait till the response has been queued */
+	e = piezoboardImpl__WaitReady(lpThis, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
 
 	/* Read response */
 	ei2c = lpThis->lpBus->vtbl->read(lpThis->lpBus, lpThis->devAddress, bResponse, sizeof(bResponse));
@@ -158,7 +400,7 @@ static enum piezoboardError piezoboardImpl__SetThreshold(
 		return piezoE_CommunicationError;
 	}
 
-	return piezoE_Ok;
+	return piezoboardImpl__WaitReady(lpThis, 0);
 }
 static uint8_t piezoboardImpl__GetThreshold__Command[] = { 0xAA, 0x55, 0xAA, 0x55, opCode_GetThreshold, 0x00, 0x02 };
 static enum piezoboardError piezoboardImpl__GetThreshold(
@@ -166,6 +408,7 @@ static enum piezoboardError piezoboardImpl__GetThreshold(
 	uint8_t* lpThreshold
 ) {
 	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
 	enum i2cError ei2c;
 	uint8_t bResponse[4+2+1+1];
 
@@ -182,8 +425,11 @@ static enum piezoboardError piezoboardImpl__GetThreshold(
 		return piezoE_Failed;
 	}
 
-	/* Delay */
-	responseDelay();
+	/* Wait till the response has been queued */
+	e = piezoboardImpl__WaitReady(lpThis, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
 
 	/* Read response */
 	ei2c = lpThis->lpBus->vtbl->read(lpThis->lpBus, lpThis->devAddress, bResponse, sizeof(bResponse));
@@ -227,6 +473,7 @@ static enum piezoboardError piezoboardImpl__GetTriggerMode(
 	enum piezoTriggerMode* lpTriggerMode
 ) {
 	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
 	enum i2cError ei2c;
 	uint8_t bResponse[4+2+1+1];
 
@@ -243,7 +490,11 @@ static enum piezoboardError piezoboardImpl__GetTriggerMode(
 		return piezoE_Failed;
 	}
 
-	responseDelay();
+	/* Wait till the response has been queued */
+	e = piezoboardImpl__WaitReady(lpThis, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
 
 	/* Read response */
 	ei2c = lpThis->lpBus->vtbl->read(lpThis->lpBus, lpThis->devAddress, bResponse, sizeof(bResponse));
@@ -329,7 +580,7 @@ static enum piezoboardError piezoboardImpl__SetTriggerMode(
 		return piezoE_CommunicationError;
 	}
 
-	return piezoE_Ok;
+	return piezoboardImpl__WaitReady(lpThis, 0);
 }
 static uint8_t piezoboardImpl__Reset__Command[] = { 0xAA, 0x55, 0xAA, 0x55, opCode_Reset, 0x00, 0x08 };
 static enum piezoboardError piezoboardImpl__Reset(
@@ -351,7 +602,7 @@ static enum piezoboardError piezoboardImpl__Reset(
 		return piezoE_Failed;
 	}
 
-	return piezoE_Ok;
+	return piezoboardImpl__WaitReady(lpThis, 0);
 }
 static uint8_t piezoboardImpl__Recalibrate__Command[] = { 0xAA, 0x55, 0xAA, 0x55, opCode_Recalibrate, 0x00, 0x09 };
 static enum piezoboardError piezoboardImpl__Recalibrate(
@@ -373,8 +624,75 @@ static enum piezoboardError piezoboardImpl__Recalibrate(
 		return piezoE_Failed;
 	}
 
+	return piezoboardImpl__WaitReady(lpThis, 0);
+}
+/*
+	Upper bound of the time waited for a store. A full compaction of the
+	settings image takes about 300 ms on the board
+*/
+#define PIEZOBOARD_STORE_TIMEOUT			600000			/* Microseconds */
+
+static enum piezoboardError piezoboardImpl__GetStoreStatus(
+	struct piezoboard* lpSelf,
+	bool* lpBusy,
+	uint16_t* lpGeneration,
+	uint16_t* lpRecordsUsed,
+	uint16_t* lpRecordCapacity
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[7];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetStoreStatus, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	if(lpBusy != NULL) { (*lpBusy) = (bResponse[0] != 0x00) ? true : false; }
+	if(lpGeneration != NULL) { (*lpGeneration) = ((uint16_t)bResponse[1]) | (((uint16_t)bResponse[2]) << 8); }
+	if(lpRecordsUsed != NULL) { (*lpRecordsUsed) = ((uint16_t)bResponse[3]) | (((uint16_t)bResponse[4]) << 8); }
+	if(lpRecordCapacity != NULL) { (*lpRecordCapacity) = ((uint16_t)bResponse[5]) | (((uint16_t)bResponse[6]) << 8); }
+
 	return piezoE_Ok;
 }
+
+/*
+	The board writes the changed bytes in the background, poll till
+	the journal reports completion
+*/
+static enum piezoboardError piezoboardImpl__WaitStored(
+	struct piezoboard* lpSelf
+) {
+	enum piezoboardError e;
+	bool bBusy;
+	unsigned long int dwDelay = PIEZOBOARD_POLL_DELAY_MIN;
+	unsigned long int dwWaited = 0;
+
+	while(dwWaited < PIEZOBOARD_STORE_TIMEOUT) {
+		e = piezoboardImpl__GetStoreStatus(lpSelf, &bBusy, NULL, NULL, NULL);
+		if(e != piezoE_Ok) {
+			return e;
+		}
+		if(!bBusy) {
+			return piezoE_Ok;
+		}
+
+		usleep(dwDelay);
+		dwWaited = dwWaited + dwDelay;
+		dwDelay = dwDelay * 2;
+		if(dwDelay > PIEZOBOARD_POLL_DELAY_MAX) { dwDelay = PIEZOBOARD_POLL_DELAY_MAX; }
+	}
+
+	#ifdef DEBUG
+		printf("%s:%u Store did not finish in time\n", __FILE__, __LINE__);
+	#endif
+	return piezoE_Failed;
+}
+
 static uint8_t piezoboardImpl__StoreSettings__Command[] = { 0xAA, 0x55, 0xAA, 0x55, opCode_StoreSettings, 0x00, 0x0A };
 static enum piezoboardError piezoboardImpl__StoreSettings(
 	struct piezoboard* lpSelf
@@ -395,12 +713,239 @@ static enum piezoboardError piezoboardImpl__StoreSettings(
 		return piezoE_Failed;
 	}
 
-	/* Wait till EEPROM is written for sure ... */
-	usleep(500*1000);
+	return piezoboardImpl__WaitStored(lpSelf);
+}
+
+
+static enum piezoboardError piezoboardImpl__GetSettings(
+	struct piezoboard* lpSelf,
+	struct piezoSettings* lpSettingsOut
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[PIEZOBOARD_SETTINGS_BLOCK_SIZE];
+	unsigned long int i;
+	unsigned long int j;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(lpSettingsOut == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetSettings, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+	if((bResponse[0] != PIEZOBOARD_SETTINGS_LAYOUT) || (bResponse[1] != PIEZOBOARD_SETTINGS_VERSION)) {
+		return piezoE_CommunicationError; /* Unknown settings layout */
+	}
+
+	lpSettingsOut->triggerMode = (enum piezoTriggerMode)bResponse[2];
+	lpSettingsOut->threshold = ((uint16_t)bResponse[3]) | (((uint16_t)bResponse[4]) << 8);
+	lpSettingsOut->alphaPermille = ((uint16_t)bResponse[5]) | (((uint16_t)bResponse[6]) << 8);
+	lpSettingsOut->dwInitSamples = ((uint32_t)bResponse[7]) | (((uint32_t)bResponse[8]) << 8) | (((uint32_t)bResponse[9]) << 16) | (((uint32_t)bResponse[10]) << 24);
+	lpSettingsOut->debounceLength = ((uint16_t)bResponse[11]) | (((uint16_t)bResponse[12]) << 8);
+	lpSettingsOut->filterMode = (enum piezoFilterMode)bResponse[13];
+	lpSettingsOut->medianWindow = bResponse[14];
+	lpSettingsOut->detectorMode = (enum piezoDetectorMode)bResponse[15];
+	lpSettingsOut->slopeDistance = bResponse[16];
+	lpSettingsOut->slopeThreshold = ((uint16_t)bResponse[17]) | (((uint16_t)bResponse[18]) << 8);
+	lpSettingsOut->sampleRate = ((uint16_t)bResponse[19]) | (((uint16_t)bResponse[20]) << 8);
+	lpSettingsOut->prescaler = bResponse[21];
+	lpSettingsOut->samplingFlags = bResponse[22];
+	lpSettingsOut->activeChannels = bResponse[23];
+	lpSettingsOut->thresholdMode = (enum piezoThresholdMode)bResponse[24];
+	lpSettingsOut->sigmaFactor = bResponse[25];
+	lpSettingsOut->trackShift = bResponse[26];
+	lpSettingsOut->freezeMargin = bResponse[27];
+	lpSettingsOut->capturePostTrigger = ((uint16_t)bResponse[28]) | (((uint16_t)bResponse[29]) << 8);
+	lpSettingsOut->releasePercent = bResponse[30];
+	lpSettingsOut->minSamples = bResponse[31];
+	lpSettingsOut->minChannels = bResponse[32];
+	lpSettingsOut->coincidenceWindow = bResponse[33];
+	lpSettingsOut->biquadStages = bResponse[34];
+	for(i = 0; i < PIEZOBOARD_BIQUAD_STAGES_MAX; i=i+1) {
+		int16_t coeff[5];
+		for(j = 0; j < 5; j=j+1) {
+			coeff[j] = (int16_t)(((uint16_t)bResponse[35+10*i+2*j]) | (((uint16_t)bResponse[36+10*i+2*j]) << 8));
+		}
+		lpSettingsOut->biquad[i].b0 = coeff[0];
+		lpSettingsOut->biquad[i].b1 = coeff[1];
+		lpSettingsOut->biquad[i].b2 = coeff[2];
+		lpSettingsOut->biquad[i].a1 = coeff[3];
+		lpSettingsOut->biquad[i].a2 = coeff[4];
+	}
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__SetSettings(
+	struct piezoboard* lpSelf,
+	struct piezoSettings* lpSettings
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bPayload[PIEZOBOARD_SETTINGS_BLOCK_SIZE];
+	uint8_t bReadback[PIEZOBOARD_SETTINGS_BLOCK_SIZE];
+	unsigned long int i;
+	unsigned long int j;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(lpSettings == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	bPayload[0] = PIEZOBOARD_SETTINGS_LAYOUT;
+	bPayload[1] = PIEZOBOARD_SETTINGS_VERSION;
+	bPayload[2] = (uint8_t)lpSettings->triggerMode;
+	bPayload[3] = (uint8_t)(lpSettings->threshold & 0xFF);
+	bPayload[4] = (uint8_t)((lpSettings->threshold >> 8) & 0xFF);
+	bPayload[5] = (uint8_t)(lpSettings->alphaPermille & 0xFF);
+	bPayload[6] = (uint8_t)((lpSettings->alphaPermille >> 8) & 0xFF);
+	bPayload[7] = (uint8_t)(lpSettings->dwInitSamples & 0xFF);
+	bPayload[8] = (uint8_t)((lpSettings->dwInitSamples >> 8) & 0xFF);
+	bPayload[9] = (uint8_t)((lpSettings->dwInitSamples >> 16) & 0xFF);
+	bPayload[10] = (uint8_t)((lpSettings->dwInitSamples >> 24) & 0xFF);
+	bPayload[11] = (uint8_t)(lpSettings->debounceLength & 0xFF);
+	bPayload[12] = (uint8_t)((lpSettings->debounceLength >> 8) & 0xFF);
+	bPayload[13] = (uint8_t)lpSettings->filterMode;
+	bPayload[14] = lpSettings->medianWindow;
+	bPayload[15] = (uint8_t)lpSettings->detectorMode;
+	bPayload[16] = lpSettings->slopeDistance;
+	bPayload[17] = (uint8_t)(lpSettings->slopeThreshold & 0xFF);
+	bPayload[18] = (uint8_t)((lpSettings->slopeThreshold >> 8) & 0xFF);
+	bPayload[19] = (uint8_t)(lpSettings->sampleRate & 0xFF);
+	bPayload[20] = (uint8_t)((lpSettings->sampleRate >> 8) & 0xFF);
+	bPayload[21] = lpSettings->prescaler;
+	bPayload[22] = lpSettings->samplingFlags;
+	bPayload[23] = lpSettings->activeChannels;
+	bPayload[24] = (uint8_t)lpSettings->thresholdMode;
+	bPayload[25] = lpSettings->sigmaFactor;
+	bPayload[26] = lpSettings->trackShift;
+	bPayload[27] = lpSettings->freezeMargin;
+	bPayload[28] = (uint8_t)(lpSettings->capturePostTrigger & 0xFF);
+	bPayload[29] = (uint8_t)((lpSettings->capturePostTrigger >> 8) & 0xFF);
+	bPayload[30] = lpSettings->releasePercent;
+	bPayload[31] = lpSettings->minSamples;
+	bPayload[32] = lpSettings->minChannels;
+	bPayload[33] = lpSettings->coincidenceWindow;
+	bPayload[34] = lpSettings->biquadStages;
+	for(i = 0; i < PIEZOBOARD_BIQUAD_STAGES_MAX; i=i+1) {
+		int16_t coeff[5];
+		coeff[0] = lpSettings->biquad[i].b0;
+		coeff[1] = lpSettings->biquad[i].b1;
+		coeff[2] = lpSettings->biquad[i].b2;
+		coeff[3] = lpSettings->biquad[i].a1;
+		coeff[4] = lpSettings->biquad[i].a2;
+		for(j = 0; j < 5; j=j+1) {
+			bPayload[35+10*i+2*j] = (uint8_t)(((uint16_t)coeff[j]) & 0xFF);
+			bPayload[36+10*i+2*j] = (uint8_t)((((uint16_t)coeff[j]) >> 8) & 0xFF);
+		}
+	}
+
+	e = piezoboardImpl__SendCommand(lpThis, opCode_SetSettings, bPayload, sizeof(bPayload));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	/*
+		The board silently rejects the whole block if any field is out of
+		range - verify by reading it back
+	*/
+	e = piezoboardImpl__Query(lpThis, opCode_GetSettings, NULL, 0, bReadback, sizeof(bReadback));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+	for(i = 0; i < sizeof(bPayload); i=i+1) {
+		if(bPayload[i] != bReadback[i]) {
+			return piezoE_InvalidParam;
+		}
+	}
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__GetTuningProfiles(
+	struct piezoboard* lpSelf,
+	uint8_t* lpSlotCount,
+	uint8_t* lpValidMask,
+	uint8_t* lpActiveProfile
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[3];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetTuningProfiles, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+	if(bResponse[0] > PIEZOBOARD_TUNING_PROFILES_MAX) {
+		return piezoE_CommunicationError;
+	}
+
+	if(lpSlotCount != NULL) { (*lpSlotCount) = bResponse[0]; }
+	if(lpValidMask != NULL) { (*lpValidMask) = bResponse[1]; }
+	if(lpActiveProfile != NULL) { (*lpActiveProfile) = bResponse[2]; }
 
 	return piezoE_Ok;
 }
+static enum piezoboardError piezoboardImpl__SaveTuningProfile(
+	struct piezoboard* lpSelf,
+	uint8_t bProfile
+) {
+	enum piezoboardError e;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(bProfile >= PIEZOBOARD_TUNING_PROFILES_MAX) { return piezoE_InvalidParam; }
+
+	/* The board rejects a save while another profile slot is still being written */
+	e = piezoboardImpl__WaitStored(lpSelf);
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	e = piezoboardImpl__SendCommand((struct piezoboardImpl*)(lpSelf->lpReserved), opCode_SaveTuningProfile, &bProfile, 1);
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	return piezoboardImpl__WaitStored(lpSelf);
+}
+static enum piezoboardError piezoboardImpl__ActivateTuningProfile(
+	struct piezoboard* lpSelf,
+	uint8_t bProfile,
+	bool bPersist
+) {
+	enum piezoboardError e;
+	uint8_t bPayload[2];
+	uint8_t bActive;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(bProfile >= PIEZOBOARD_TUNING_PROFILES_MAX) { return piezoE_InvalidParam; }
+
+	bPayload[0] = bProfile;
+	bPayload[1] = (bPersist) ? 0x01 : 0x00;
+
+	e = piezoboardImpl__SendCommand((struct piezoboardImpl*)(lpSelf->lpReserved), opCode_ActivateTuningProfile, bPayload, sizeof(bPayload));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+	if(bPersist) {
+		e = piezoboardImpl__WaitStored(lpSelf);
+		if(e != piezoE_Ok) {
+			return e;
+		}
+	}
 
+	/* The board ignores empty slots */
+	e = piezoboardImpl__GetTuningProfiles(lpSelf, NULL, NULL, &bActive);
+	if(e != piezoE_Ok) {
+		return e;
+	}
+	return (bActive == bProfile) ? piezoE_Ok : piezoE_Failed;
+}
 
 static enum piezoboardError piezoboardImpl__SetAlpha(
 	struct piezoboard* lpSelf,
@@ -438,7 +983,7 @@ static enum piezoboardError piezoboardImpl__SetAlpha(
 		return piezoE_CommunicationError;
 	}
 
-	return piezoE_Ok;
+	return piezoboardImpl__WaitReady(lpThis, 0);
 }
 static uint8_t piezoboardImpl__GetAlpha__Command[] = { 0xAA, 0x55, 0xAA, 0x55, opCode_GetAlpha, 0x00, 0x0B };
 static enum piezoboardError piezoboardImpl__GetAlpha(
@@ -446,6 +991,7 @@ static enum piezoboardError piezoboardImpl__GetAlpha(
 	uint8_t* lpAlpha
 ) {
 	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
 	enum i2cError ei2c;
 	uint8_t bResponse[4+2+1+1];
 
@@ -462,9 +1008,11 @@ static enum piezoboardError piezoboardImpl__GetAlpha(
 		return piezoE_Failed;
 	}
 
-	/* Delay */
-	responseDelay();
-	responseDelay();
+	/* Wait till the response has been queued */
+	e = piezoboardImpl__WaitReady(lpThis, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
 
 	/* Read response */
 	ei2c = lpThis->lpBus->vtbl->read(lpThis->lpBus, lpThis->devAddress, bResponse, sizeof(bResponse));
@@ -503,33 +1051,965 @@ static enum piezoboardError piezoboardImpl__GetAlpha(
 	return piezoE_Ok;
 }
 
+static enum piezoboardError piezoboardImpl__GetFilterMode(
+	struct piezoboard* lpSelf,
+	enum piezoFilterMode* lpFilterMode,
+	uint8_t* lpMedianWindow
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[2];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetFilterMode, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	if(lpFilterMode != NULL) {
+		switch(bResponse[0]) {
+			case 0x00:	(*lpFilterMode) = piezoFilterMode_MovingAverage; break;
+			case 0x01:	(*lpFilterMode) = piezoFilterMode_RunningMedian; break;
+			default:	return piezoE_CommunicationError;
+		}
+	}
+	if(lpMedianWindow != NULL) { (*lpMedianWindow) = bResponse[1]; }
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__SetFilterMode(
+	struct piezoboard* lpSelf,
+	enum piezoFilterMode filterMode,
+	uint8_t medianWindow
+) {
+	struct piezoboardImpl* lpThis;
+	uint8_t bPayload[2];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if((medianWindow < 1) || (medianWindow > 15)) { return piezoE_InvalidParam; }
 
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
 
-static enum piezoboardError piezoboardImpl__DebugCurrentSensorReadings(
+	switch(filterMode) {
+		case piezoFilterMode_MovingAverage:		bPayload[0] = 0x00; break;
+		case piezoFilterMode_RunningMedian:		bPayload[0] = 0x01; break;
+		default: return piezoE_InvalidParam;
+	}
+	bPayload[1] = medianWindow;
+
+	return piezoboardImpl__SendCommand(lpThis, opCode_SetFilterMode, bPayload, sizeof(bPayload));
+}
+
+static enum piezoboardError piezoboardImpl__GetDetectorMode(
 	struct piezoboard* lpSelf,
-	uint16_t* lpOut[4]
+	enum piezoDetectorMode* lpDetectorMode,
+	uint8_t* lpSlopeDistance,
+	uint16_t* lpSlopeThreshold
 ) {
 	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[4];
 
 	if(lpSelf == NULL) { return piezoE_InvalidParam; }
 
 	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
 
-	return piezoE_ImplementationError;
+	e = piezoboardImpl__Query(lpThis, opCode_GetDetectorMode, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	if(lpDetectorMode != NULL) {
+		switch(bResponse[0]) {
+			case 0x00:	(*lpDetectorMode) = piezoDetectorMode_Deviation; break;
+			case 0x01:	(*lpDetectorMode) = piezoDetectorMode_Slope; break;
+			default:	return piezoE_CommunicationError;
+		}
+	}
+	if(lpSlopeDistance != NULL) { (*lpSlopeDistance) = bResponse[1]; }
+	if(lpSlopeThreshold != NULL) { (*lpSlopeThreshold) = ((uint16_t)bResponse[2]) | (((uint16_t)bResponse[3]) << 8); }
+
+	return piezoE_Ok;
 }
-static enum piezoboardError piezoboardImpl__DebugCurrentSensorAverages(
+static enum piezoboardError piezoboardImpl__SetDetectorMode(
 	struct piezoboard* lpSelf,
-	uint16_t* lpOut[4]
+	enum piezoDetectorMode detectorMode,
+	uint8_t slopeDistance,
+	uint16_t slopeThreshold
 ) {
 	struct piezoboardImpl* lpThis;
+	uint8_t bPayload[4];
 
 	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if((slopeDistance < 1) || (slopeDistance > 8)) { return piezoE_InvalidParam; }
 
 	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
 
-	return piezoE_ImplementationError;
+	switch(detectorMode) {
+		case piezoDetectorMode_Deviation:		bPayload[0] = 0x00; break;
+		case piezoDetectorMode_Slope:			bPayload[0] = 0x01; break;
+		default: return piezoE_InvalidParam;
+	}
+	bPayload[1] = slopeDistance;
+	bPayload[2] = (uint8_t)(slopeThreshold & 0xFF);
+	bPayload[3] = (uint8_t)((slopeThreshold >> 8) & 0xFF);
+
+	return piezoboardImpl__SendCommand(lpThis, opCode_SetDetectorMode, bPayload, sizeof(bPayload));
+}
+
+static enum piezoboardError piezoboardImpl__GetSampling(
+	struct piezoboard* lpSelf,
+	uint16_t* lpSampleRate,
+	uint8_t* lpPrescaler,
+	uint8_t* lpFlags
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[4];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetSampling, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	if(lpSampleRate != NULL) { (*lpSampleRate) = ((uint16_t)bResponse[0]) | (((uint16_t)bResponse[1]) << 8); }
+	if(lpPrescaler != NULL) { (*lpPrescaler) = bResponse[2]; }
+	if(lpFlags != NULL) { (*lpFlags) = bResponse[3]; }
+
+	return piezoE_Ok;
 }
+static enum piezoboardError piezoboardImpl__SetSampling(
+	struct piezoboard* lpSelf,
+	uint16_t sampleRate,
+	uint8_t prescaler,
+	uint8_t flags
+) {
+	struct piezoboardImpl* lpThis;
+	uint8_t bPayload[4];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if((prescaler < 1) || (prescaler > 7)) { return piezoE_InvalidParam; }
+	if((flags & (~PIEZOBOARD_SAMPLINGFLAG__FAST8BIT)) != 0) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	bPayload[0] = (uint8_t)(sampleRate & 0xFF);
+	bPayload[1] = (uint8_t)((sampleRate >> 8) & 0xFF);
+	bPayload[2] = prescaler;
+	bPayload[3] = flags;
 
+	return piezoboardImpl__SendCommand(lpThis, opCode_SetSampling, bPayload, sizeof(bPayload));
+}
+static enum piezoboardError piezoboardImpl__GetActiveChannels(
+	struct piezoboard* lpSelf,
+	uint8_t* lpChannelMask
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[1];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetActiveChannels, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	if(lpChannelMask != NULL) { (*lpChannelMask) = bResponse[0]; }
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__SetActiveChannels(
+	struct piezoboard* lpSelf,
+	uint8_t channelMask
+) {
+	struct piezoboardImpl* lpThis;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(((channelMask & 0x0F) == 0) || ((channelMask & 0xF0) != 0)) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	return piezoboardImpl__SendCommand(lpThis, opCode_SetActiveChannels, &channelMask, 1);
+}
+static enum piezoboardError piezoboardImpl__GetBiquad(
+	struct piezoboard* lpSelf,
+	uint8_t bStage,
+	uint8_t* lpStagesOut,
+	struct piezoBiquadCoefficients* lpCoefficientsOut
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[2+5*2];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(bStage >= PIEZOBOARD_BIQUAD_STAGES_MAX) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetBiquad, &bStage, 1, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+	if(bResponse[1] != bStage) {
+		return piezoE_CommunicationError;
+	}
+
+	if(lpStagesOut != NULL) { (*lpStagesOut) = bResponse[0]; }
+	if(lpCoefficientsOut != NULL) {
+		lpCoefficientsOut->b0 = (int16_t)(((uint16_t)bResponse[2]) | (((uint16_t)bResponse[3]) << 8));
+		lpCoefficientsOut->b1 = (int16_t)(((uint16_t)bResponse[4]) | (((uint16_t)bResponse[5]) << 8));
+		lpCoefficientsOut->b2 = (int16_t)(((uint16_t)bResponse[6]) | (((uint16_t)bResponse[7]) << 8));
+		lpCoefficientsOut->a1 = (int16_t)(((uint16_t)bResponse[8]) | (((uint16_t)bResponse[9]) << 8));
+		lpCoefficientsOut->a2 = (int16_t)(((uint16_t)bResponse[10]) | (((uint16_t)bResponse[11]) << 8));
+	}
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__SetBiquad(
+	struct piezoboard* lpSelf,
+	uint8_t bStages,
+	uint8_t bStage,
+	struct piezoBiquadCoefficients* lpCoefficients
+) {
+	struct piezoboardImpl* lpThis;
+	uint8_t bPayload[2+5*2];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(lpCoefficients == NULL) { return piezoE_InvalidParam; }
+	if((bStages > PIEZOBOARD_BIQUAD_STAGES_MAX) || (bStage >= PIEZOBOARD_BIQUAD_STAGES_MAX)) { return piezoE_InvalidParam; }
+
+	/* Same stability check as the firmware applies */
+	if((lpCoefficients->a2 >= PIEZOBOARD_BIQUAD_COEFF_ONE) || (lpCoefficients->a2 <= -PIEZOBOARD_BIQUAD_COEFF_ONE)) { return piezoE_InvalidParam; }
+	if((lpCoefficients->a1 >= PIEZOBOARD_BIQUAD_COEFF_ONE + lpCoefficients->a2) || (-lpCoefficients->a1 >= PIEZOBOARD_BIQUAD_COEFF_ONE + lpCoefficients->a2)) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	bPayload[0] = bStages;
+	bPayload[1] = bStage;
+	bPayload[2] = (uint8_t)(((uint16_t)lpCoefficients->b0) & 0xFF);
+	bPayload[3] = (uint8_t)((((uint16_t)lpCoefficients->b0) >> 8) & 0xFF);
+	bPayload[4] = (uint8_t)(((uint16_t)lpCoefficients->b1) & 0xFF);
+	bPayload[5] = (uint8_t)((((uint16_t)lpCoefficients->b1) >> 8) & 0xFF);
+	bPayload[6] = (uint8_t)(((uint16_t)lpCoefficients->b2) & 0xFF);
+	bPayload[7] = (uint8_t)((((uint16_t)lpCoefficients->b2) >> 8) & 0xFF);
+	bPayload[8] = (uint8_t)(((uint16_t)lpCoefficients->a1) & 0xFF);
+	bPayload[9] = (uint8_t)((((uint16_t)lpCoefficients->a1) >> 8) & 0xFF);
+	bPayload[10] = (uint8_t)(((uint16_t)lpCoefficients->a2) & 0xFF);
+	bPayload[11] = (uint8_t)((((uint16_t)lpCoefficients->a2) >> 8) & 0xFF);
+
+	return piezoboardImpl__SendCommand(lpThis, opCode_SetBiquad, bPayload, sizeof(bPayload));
+}
+static enum piezoboardError piezoboardImpl__GetThresholdMode(
+	struct piezoboard* lpSelf,
+	enum piezoThresholdMode* lpThresholdMode,
+	uint8_t* lpSigmaFactor
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[2];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetThresholdMode, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	if(lpThresholdMode != NULL) { (*lpThresholdMode) = (enum piezoThresholdMode)bResponse[0]; }
+	if(lpSigmaFactor != NULL) { (*lpSigmaFactor) = bResponse[1]; }
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__SetThresholdMode(
+	struct piezoboard* lpSelf,
+	enum piezoThresholdMode thresholdMode,
+	uint8_t sigmaFactor
+) {
+	struct piezoboardImpl* lpThis;
+	uint8_t bPayload[2];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if((thresholdMode != piezoThresholdMode_Absolute) && (thresholdMode != piezoThresholdMode_NoiseSigma)) { return piezoE_InvalidParam; }
+	if(sigmaFactor == 0) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	bPayload[0] = (uint8_t)thresholdMode;
+	bPayload[1] = sigmaFactor;
+
+	return piezoboardImpl__SendCommand(lpThis, opCode_SetThresholdMode, bPayload, sizeof(bPayload));
+}
+static enum piezoboardError piezoboardImpl__GetBaselineTracking(
+	struct piezoboard* lpSelf,
+	uint8_t* lpTrackShift,
+	uint8_t* lpFreezeMargin
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[2];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetBaselineTracking, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	if(lpTrackShift != NULL) { (*lpTrackShift) = bResponse[0]; }
+	if(lpFreezeMargin != NULL) { (*lpFreezeMargin) = bResponse[1]; }
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__SetBaselineTracking(
+	struct piezoboard* lpSelf,
+	uint8_t trackShift,
+	uint8_t freezeMargin
+) {
+	struct piezoboardImpl* lpThis;
+	uint8_t bPayload[2];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if((trackShift != 0) && ((trackShift < PIEZOBOARD_TRACKSHIFT_MIN) || (trackShift > PIEZOBOARD_TRACKSHIFT_MAX))) { return piezoE_InvalidParam; }
+	if((freezeMargin < 1) || (freezeMargin > 100)) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	bPayload[0] = trackShift;
+	bPayload[1] = freezeMargin;
+
+	return piezoboardImpl__SendCommand(lpThis, opCode_SetBaselineTracking, bPayload, sizeof(bPayload));
+}
+static enum piezoboardError piezoboardImpl__GetQualifier(
+	struct piezoboard* lpSelf,
+	uint8_t* lpReleasePercent,
+	uint8_t* lpMinSamples,
+	uint8_t* lpMinChannels,
+	uint8_t* lpCoincidenceWindow
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[4];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetQualifier, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	if(lpReleasePercent != NULL) { (*lpReleasePercent) = bResponse[0]; }
+	if(lpMinSamples != NULL) { (*lpMinSamples) = bResponse[1]; }
+	if(lpMinChannels != NULL) { (*lpMinChannels) = bResponse[2]; }
+	if(lpCoincidenceWindow != NULL) { (*lpCoincidenceWindow) = bResponse[3]; }
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__SetQualifier(
+	struct piezoboard* lpSelf,
+	uint8_t releasePercent,
+	uint8_t minSamples,
+	uint8_t minChannels,
+	uint8_t coincidenceWindow
+) {
+	struct piezoboardImpl* lpThis;
+	uint8_t bPayload[4];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if((releasePercent < 1) || (releasePercent > 100)) { return piezoE_InvalidParam; }
+	if(minSamples < 1) { return piezoE_InvalidParam; }
+	if((minChannels < 1) || (minChannels > 4)) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	bPayload[0] = releasePercent;
+	bPayload[1] = minSamples;
+	bPayload[2] = minChannels;
+	bPayload[3] = coincidenceWindow;
+
+	return piezoboardImpl__SendCommand(lpThis, opCode_SetQualifier, bPayload, sizeof(bPayload));
+}
+static enum piezoboardError piezoboardImpl__GetNoiseStatistics(
+	struct piezoboard* lpSelf,
+	bool* lpValid,
+	bool* lpRestored,
+	uint16_t lpSigma[4],
+	uint16_t lpThreshold[4]
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[1+4*2+4*2];
+	unsigned long int i;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetNoiseStatistics, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	if(lpValid != NULL) { (*lpValid) = ((bResponse[0] & 0x01) != 0) ? true : false; }
+	if(lpRestored != NULL) { (*lpRestored) = ((bResponse[0] & 0x02) != 0) ? true : false; }
+	for(i = 0; i < 4; i=i+1) {
+		if(lpSigma != NULL) { lpSigma[i] = ((uint16_t)bResponse[1+2*i]) | (((uint16_t)bResponse[2+2*i]) << 8); }
+		if(lpThreshold != NULL) { lpThreshold[i] = ((uint16_t)bResponse[9+2*i]) | (((uint16_t)bResponse[10+2*i]) << 8); }
+	}
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__ReadEvent(
+	struct piezoboard* lpSelf,
+	bool bPop,
+	struct piezoEvent* lpEventOut,
+	uint8_t* lpPendingOut,
+	uint8_t* lpLostOut
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bPayload[1];
+	uint8_t bResponse[2+12+4*2];
+	unsigned long int i;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	bPayload[0] = (bPop != false) ? 0x01 : 0x00;
+	e = piezoboardImpl__Query(lpThis, opCode_ReadEvent, bPayload, sizeof(bPayload), bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	if(lpPendingOut != NULL) { (*lpPendingOut) = bResponse[0]; }
+	if(lpLostOut != NULL) { (*lpLostOut) = bResponse[1]; }
+	if(lpEventOut != NULL) {
+		lpEventOut->dwTimestamp = ((uint32_t)bResponse[2]) | (((uint32_t)bResponse[3]) << 8) | (((uint32_t)bResponse[4]) << 16) | (((uint32_t)bResponse[5]) << 24);
+		lpEventOut->triggerMode = (enum piezoTriggerMode)bResponse[6];
+		lpEventOut->bFirstChannel = bResponse[7];
+		lpEventOut->bFlags = bResponse[8];
+		lpEventOut->bCrossedMask = bResponse[9];
+		for(i = 0; i < 4; i=i+1) {
+			lpEventOut->bCrossOffset[i] = bResponse[10+i];
+			lpEventOut->peakDeviation[i] = ((uint16_t)bResponse[14+2*i]) | (((uint16_t)bResponse[15+2*i]) << 8);
+		}
+	}
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__ClearEvents(
+	struct piezoboard* lpSelf
+) {
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	return piezoboardImpl__SendCommand((struct piezoboardImpl*)(lpSelf->lpReserved), opCode_ClearEvents, NULL, 0);
+}
+static enum piezoboardError piezoboardImpl__GetCaptureStatus(
+	struct piezoboard* lpSelf,
+	struct piezoCaptureStatus* lpStatusOut
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[11];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(lpStatusOut == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetCaptureStatus, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	lpStatusOut->state = (enum piezoCaptureState)bResponse[0];
+	lpStatusOut->slots = ((uint16_t)bResponse[1]) | (((uint16_t)bResponse[2]) << 8);
+	lpStatusOut->bytes = ((uint16_t)bResponse[3]) | (((uint16_t)bResponse[4]) << 8);
+	lpStatusOut->postTrigger = ((uint16_t)bResponse[5]) | (((uint16_t)bResponse[6]) << 8);
+	lpStatusOut->validSamples = ((uint16_t)bResponse[7]) | (((uint16_t)bResponse[8]) << 8);
+	lpStatusOut->triggerIndex = ((uint16_t)bResponse[9]) | (((uint16_t)bResponse[10]) << 8);
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__SetCapturePostTrigger(
+	struct piezoboard* lpSelf,
+	uint16_t postTrigger
+) {
+	uint8_t bPayload[2];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	bPayload[0] = (uint8_t)(postTrigger & 0xFF);
+	bPayload[1] = (uint8_t)((postTrigger >> 8) & 0xFF);
+
+	return piezoboardImpl__SendCommand((struct piezoboardImpl*)(lpSelf->lpReserved), opCode_SetCaptureConfig, bPayload, sizeof(bPayload));
+}
+static enum piezoboardError piezoboardImpl__ArmCapture(
+	struct piezoboard* lpSelf,
+	bool bForceTrigger
+) {
+	uint8_t bPayload[1];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	bPayload[0] = (bForceTrigger != false) ? 0x01 : 0x00;
+
+	return piezoboardImpl__SendCommand((struct piezoboardImpl*)(lpSelf->lpReserved), opCode_ArmCapture, bPayload, sizeof(bPayload));
+}
+static enum piezoboardError piezoboardImpl__ReadCapture(
+	struct piezoboard* lpSelf,
+	uint16_t offset,
+	uint8_t bCount,
+	uint16_t* lpValuesOut,
+	uint8_t* lpChannelsOut,
+	uint8_t* lpCountOut
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bPayload[3];
+	uint8_t bResponse[3+PIEZOBOARD_CAPTURE_CHUNK_MAX*2];
+	unsigned long int i;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if((bCount == 0) || (bCount > PIEZOBOARD_CAPTURE_CHUNK_MAX)) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	bPayload[0] = (uint8_t)(offset & 0xFF);
+	bPayload[1] = (uint8_t)((offset >> 8) & 0xFF);
+	bPayload[2] = bCount;
+
+	e = piezoboardImpl__Query(lpThis, opCode_ReadCapture, bPayload, sizeof(bPayload), bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+	if((bResponse[0] != bPayload[0]) || (bResponse[1] != bPayload[1]) || (bResponse[2] > bCount)) {
+		return piezoE_CommunicationError;
+	}
+
+	for(i = 0; i < bResponse[2]; i=i+1) {
+		uint16_t slot = ((uint16_t)bResponse[3+2*i]) | (((uint16_t)bResponse[4+2*i]) << 8);
+		if(lpValuesOut != NULL) { lpValuesOut[i] = slot & 0x03FF; }
+		if(lpChannelsOut != NULL) { lpChannelsOut[i] = (uint8_t)((slot >> 12) & 0x03); }
+	}
+	if(lpCountOut != NULL) { (*lpCountOut) = bResponse[2]; }
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__GetTelemetry(
+	struct piezoboard* lpSelf,
+	struct piezoTelemetry* lpTelemetryOut
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[1+PIEZOBOARD_TELEMETRY_COUNTERS*4];
+	uint32_t dwCounters[PIEZOBOARD_TELEMETRY_COUNTERS];
+	unsigned long int i;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(lpTelemetryOut == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetTelemetry, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+	if(bResponse[0] != PIEZOBOARD_TELEMETRY_COUNTERS) {
+		return piezoE_CommunicationError; /* Unknown counter layout */
+	}
+
+	for(i = 0; i < PIEZOBOARD_TELEMETRY_COUNTERS; i=i+1) {
+		dwCounters[i] = ((uint32_t)bResponse[1+4*i])
+			| (((uint32_t)bResponse[2+4*i]) << 8)
+			| (((uint32_t)bResponse[3+4*i]) << 16)
+			| (((uint32_t)bResponse[4+4*i]) << 24);
+	}
+
+	lpTelemetryOut->dwTriggers[0] = dwCounters[0];
+	lpTelemetryOut->dwTriggers[1] = dwCounters[1];
+	lpTelemetryOut->dwTriggers[2] = dwCounters[2];
+	lpTelemetryOut->dwTriggers[3] = dwCounters[3];
+	lpTelemetryOut->dwDebounceSuppressed = dwCounters[4];
+	lpTelemetryOut->dwRxOverflows = dwCounters[5];
+	lpTelemetryOut->dwChecksumErrors = dwCounters[6];
+	lpTelemetryOut->dwResyncs = dwCounters[7];
+	lpTelemetryOut->dwTxUnderruns = dwCounters[8];
+	lpTelemetryOut->dwBusErrors = dwCounters[9];
+	lpTelemetryOut->dwCalibrations = dwCounters[10];
+	lpTelemetryOut->dwAdcOverruns = dwCounters[11];
+	lpTelemetryOut->dwTxRejected = dwCounters[12];
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__ResetTelemetry(
+	struct piezoboard* lpSelf
+) {
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	return piezoboardImpl__SendCommand((struct piezoboardImpl*)(lpSelf->lpReserved), opCode_ResetTelemetry, NULL, 0);
+}
+static enum piezoboardError piezoboardImpl__GetProfile(
+	struct piezoboard* lpSelf,
+	enum piezoProfileSlot slot,
+	struct piezoProfile* lpProfileOut
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bPayload[1];
+	uint8_t bResponse[11+PIEZOBOARD_PROFILE_BINS*2];
+	unsigned long int i;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(lpProfileOut == NULL) { return piezoE_InvalidParam; }
+	if(((int)slot < 0) || ((int)slot >= PIEZOBOARD_PROFILE_SLOTS)) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	bPayload[0] = (uint8_t)slot;
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetProfile, bPayload, sizeof(bPayload), bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+	if(bResponse[0] != bPayload[0]) {
+		return piezoE_CommunicationError;
+	}
+
+	lpProfileOut->dwCount = ((uint32_t)bResponse[1]) | (((uint32_t)bResponse[2]) << 8) | (((uint32_t)bResponse[3]) << 16) | (((uint32_t)bResponse[4]) << 24);
+	lpProfileOut->minCycles = ((uint16_t)bResponse[5]) | (((uint16_t)bResponse[6]) << 8);
+	lpProfileOut->meanCycles = ((uint16_t)bResponse[7]) | (((uint16_t)bResponse[8]) << 8);
+	lpProfileOut->maxCycles = ((uint16_t)bResponse[9]) | (((uint16_t)bResponse[10]) << 8);
+	for(i = 0; i < PIEZOBOARD_PROFILE_BINS; i=i+1) {
+		lpProfileOut->histogram[i] = ((uint16_t)bResponse[11+2*i]) | (((uint16_t)bResponse[12+2*i]) << 8);
+	}
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__ResetProfile(
+	struct piezoboard* lpSelf
+) {
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	return piezoboardImpl__SendCommand((struct piezoboardImpl*)(lpSelf->lpReserved), opCode_ResetProfile, NULL, 0);
+}
+static enum piezoboardError piezoboardImpl__GetTriggerLatency(
+	struct piezoboard* lpSelf,
+	uint16_t* lpLatencyLast,
+	uint16_t* lpLatencyMax
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[4];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetTriggerLatency, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+
+	if(lpLatencyLast != NULL) { (*lpLatencyLast) = ((uint16_t)bResponse[0]) | (((uint16_t)bResponse[1]) << 8); }
+	if(lpLatencyMax != NULL) { (*lpLatencyMax) = ((uint16_t)bResponse[2]) | (((uint16_t)bResponse[3]) << 8); }
+
+	return piezoE_Ok;
+}
+
+
+static enum piezoboardError piezoboardImpl__DebugCurrentSensorReadings(
+	struct piezoboard* lpSelf,
+	uint16_t* lpOut[4]
+) {
+	struct piezoboardImpl* lpThis;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	return piezoE_ImplementationError;
+}
+static enum piezoboardError piezoboardImpl__DebugCurrentSensorAverages(
+	struct piezoboard* lpSelf,
+	uint16_t* lpOut[4]
+) {
+	struct piezoboardImpl* lpThis;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	return piezoE_ImplementationError;
+}
+
+
+/*
+	Register mode - a single write of the register index followed by a
+	read after a repeated start. No framing and no response delay
+*/
+static enum piezoboardError piezoboardImpl__ReadRegisters(
+	struct piezoboard* lpSelf,
+	uint8_t bRegister,
+	uint8_t* lpOut,
+	unsigned long int dwLength
+) {
+	struct piezoboardImpl* lpThis;
+	enum i2cError ei2c;
+	uint8_t bSelect[1];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(lpOut == NULL) { return piezoE_InvalidParam; }
+	if((dwLength == 0) || (((unsigned long int)bRegister) + dwLength > PIEZOBOARD_REGISTER_MAP_SIZE)) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	bSelect[0] = PIEZOBOARD_REGISTER_SELECT | bRegister;
+	ei2c = lpThis->lpBus->vtbl->writeRead(lpThis->lpBus, lpThis->devAddress, bSelect, sizeof(bSelect), lpOut, dwLength);
+	if(ei2c != i2cE_Ok) {
+		#ifdef DEBUG
+			printf("%s:%u Register read failed (%u)\n", __FILE__, __LINE__, ei2c);
+		#endif
+		return piezoE_CommunicationError;
+	}
+
+	return piezoE_Ok;
+}
+static enum piezoboardError piezoboardImpl__GetLiveStatus(
+	struct piezoboard* lpSelf,
+	struct piezoLiveStatus* lpStatusOut
+) {
+	enum piezoboardError e;
+	uint8_t bMap[PIEZOBOARD_REGISTER_MAP_SIZE];
+	unsigned long int i;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(lpStatusOut == NULL) { return piezoE_InvalidParam; }
+
+	e = piezoboardImpl__ReadRegisters(lpSelf, 0x00, bMap, sizeof(bMap));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+	if(bMap[1] > piezoTriggerMode_PiezoOrCapacitive) {
+		return piezoE_CommunicationError; /* Board does not support register mode */
+	}
+
+	lpStatusOut->bFlags = bMap[0];
+	lpStatusOut->trigMode = (enum piezoTriggerMode)bMap[1];
+	lpStatusOut->bSequence = bMap[2];
+	lpStatusOut->bActiveChannels = bMap[3];
+	for(i = 0; i < 4; i=i+1) {
+		lpStatusOut->rawValues[i] = ((uint16_t)bMap[4+2*i]) | (((uint16_t)bMap[5+2*i]) << 8);
+		lpStatusOut->averages[i] = ((uint16_t)bMap[12+2*i]) | (((uint16_t)bMap[13+2*i]) << 8);
+	}
+	lpStatusOut->dwTriggers = ((uint32_t)bMap[20]) | (((uint32_t)bMap[21]) << 8) | (((uint32_t)bMap[22]) << 16) | (((uint32_t)bMap[23]) << 24);
+	lpStatusOut->dwMillis = ((uint32_t)bMap[24]) | (((uint32_t)bMap[25]) << 8) | (((uint32_t)bMap[26]) << 16) | (((uint32_t)bMap[27]) << 24);
+	lpStatusOut->checksumErrors = ((uint16_t)bMap[28]) | (((uint16_t)bMap[29]) << 8);
+	lpStatusOut->rxOverflows = ((uint16_t)bMap[30]) | (((uint16_t)bMap[31]) << 8);
+
+	return piezoE_Ok;
+}
+
+static enum piezoboardError piezoboardImpl__SetStream(
+	struct piezoboard* lpSelf,
+	bool bEnable,
+	enum piezoStreamEncoding encoding
+) {
+	struct piezoboardImpl* lpThis;
+	uint8_t bPayload[2];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if((encoding != piezoStreamEncoding_Raw) && (encoding != piezoStreamEncoding_Packed10) && (encoding != piezoStreamEncoding_Delta)) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+	lpThis->bStreamSynced = false;
+
+	bPayload[0] = bEnable ? 0x01 : 0x00;
+	bPayload[1] = (uint8_t)encoding;
+	return piezoboardImpl__SendCommand(lpThis, opCode_SetStream, bPayload, sizeof(bPayload));
+}
+static enum piezoboardError piezoboardImpl__GetStreamStatus(
+	struct piezoboard* lpSelf,
+	struct piezoStreamStatus* lpStatusOut
+) {
+	struct piezoboardImpl* lpThis;
+	enum piezoboardError e;
+	uint8_t bResponse[9];
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(lpStatusOut == NULL) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+
+	e = piezoboardImpl__Query(lpThis, opCode_GetStreamStatus, NULL, 0, bResponse, sizeof(bResponse));
+	if(e != piezoE_Ok) {
+		return e;
+	}
+	if(bResponse[1] != PIEZOBOARD_STREAM_BLOCK_BYTES) {
+		return piezoE_CommunicationError; /* Unknown block layout */
+	}
+
+	lpStatusOut->bEnabled = ((bResponse[0] & 0x01) != 0) ? true : false;
+	lpStatusOut->encoding = (enum piezoStreamEncoding)bResponse[8];
+	lpStatusOut->bBlockBytes = bResponse[1];
+	lpStatusOut->bBlockSamples = bResponse[2];
+	lpStatusOut->bBlocks = bResponse[3];
+	lpStatusOut->dwDroppedSamples = ((uint32_t)bResponse[4]) | (((uint32_t)bResponse[5]) << 8) | (((uint32_t)bResponse[6]) << 16) | (((uint32_t)bResponse[7]) << 24);
+
+	return piezoE_Ok;
+}
+/*
+	Decodes the samples of a packed or delta block. The channel of every
+	sample after the first is the next active channel from the mask in
+	the header. Returns false if the block is inconsistent
+*/
+static bool piezoboardImpl__DecodeStreamBlock(
+	uint8_t* lpBlock,
+	struct piezoStreamBlock* lpOut
+) {
+	uint8_t* lpPayload = &(lpBlock[4]);
+	uint8_t bMask = (lpBlock[3] >> 4) & 0x0F;
+	uint8_t bChannel = lpBlock[3] & 0x03;
+	uint16_t previous[4] = { 0, 0, 0, 0 };
+	unsigned long int dwNibble = 0;
+	unsigned long int j;
+
+	if((bMask & (1 << bChannel)) == 0) { return false; }
+	if((lpBlock[0] & 0x03) == piezoStreamEncoding_Packed10) {
+		if(lpBlock[2] > (PIEZOBOARD_STREAM_BLOCK_BYTES - 4) / 5 * 4) { return false; }
+	} else if((lpBlock[0] & 0x03) == piezoStreamEncoding_Delta) {
+		if(lpBlock[2] > PIEZOBOARD_STREAM_SAMPLES_MAX) { return false; }
+	} else {
+		return false; /* Unknown encoding */
+	}
+
+	lpOut->bSamples = lpBlock[2];
+	for(j = 0; j < lpOut->bSamples; j=j+1) {
+		uint16_t value;
+
+		if((lpBlock[0] & 0x03) == piezoStreamEncoding_Packed10) {
+			uint8_t* lpGroup = &(lpPayload[(j / 4) * 5]);
+			value = ((uint16_t)lpGroup[j % 4]) | ((((uint16_t)lpGroup[4] >> (2 * (j % 4))) & 0x03) << 8);
+		} else {
+			uint8_t bNibble;
+
+			if(dwNibble >= 2 * (PIEZOBOARD_STREAM_BLOCK_BYTES - 4)) { return false; }
+			bNibble = (lpPayload[dwNibble / 2] >> (4 * (dwNibble % 2))) & 0x0F;
+			dwNibble = dwNibble + 1;
+
+			if(bNibble == 0x08) {
+				unsigned long int k;
+
+				if(dwNibble + 3 > 2 * (PIEZOBOARD_STREAM_BLOCK_BYTES - 4)) { return false; }
+				value = 0;
+				for(k = 0; k < 3; k=k+1) {
+					value = value | (((uint16_t)((lpPayload[dwNibble / 2] >> (4 * (dwNibble % 2))) & 0x0F)) << (4 * k));
+					dwNibble = dwNibble + 1;
+				}
+			} else {
+				int delta = ((bNibble & 0x08) != 0) ? ((int)bNibble) - 16 : (int)bNibble;
+				value = (uint16_t)(((int)previous[bChannel] + delta) & 0x03FF);
+			}
+			previous[bChannel] = value;
+		}
+
+		lpOut->channels[j] = bChannel;
+		lpOut->values[j] = value & 0x03FF;
+
+		/* Next active channel */
+		do {
+			bChannel = (bChannel + 1) & 0x03;
+		} while((bMask & (1 << bChannel)) == 0);
+	}
+
+	return true;
+}
+/*
+	Drains up to dwMaxBlocks complete blocks with a single bulk read.
+	Empty filler blocks (the board had nothing more) are skipped, so
+	lpBlocksRead may be anything from 0 to dwMaxBlocks. A gap in the
+	sequence numbers (e.g. a block lost due to a bus error) is reported
+	like an overflow on the board
+*/
+static enum piezoboardError piezoboardImpl__ReadStream(
+	struct piezoboard* lpSelf,
+	struct piezoStreamBlock* lpBlocksOut,
+	unsigned long int dwMaxBlocks,
+	unsigned long int* lpBlocksRead
+) {
+	struct piezoboardImpl* lpThis;
+	enum i2cError ei2c;
+	uint8_t bSelect[1] = { PIEZOBOARD_STREAM_SELECT };
+	uint8_t bData[PIEZOBOARD_STREAM_READ_BLOCKS_MAX * PIEZOBOARD_STREAM_BLOCK_BYTES];
+	unsigned long int i;
+	unsigned long int j;
+	unsigned long int dwBlocks = 0;
+
+	if(lpSelf == NULL) { return piezoE_InvalidParam; }
+	if(lpBlocksOut == NULL) { return piezoE_InvalidParam; }
+	if(lpBlocksRead == NULL) { return piezoE_InvalidParam; }
+	if((dwMaxBlocks == 0) || (dwMaxBlocks > PIEZOBOARD_STREAM_READ_BLOCKS_MAX)) { return piezoE_InvalidParam; }
+
+	lpThis = (struct piezoboardImpl*)(lpSelf->lpReserved);
+	(*lpBlocksRead) = 0;
+
+	ei2c = lpThis->lpBus->vtbl->writeRead(lpThis->lpBus, lpThis->devAddress, bSelect, sizeof(bSelect), bData, dwMaxBlocks * PIEZOBOARD_STREAM_BLOCK_BYTES);
+	if(ei2c != i2cE_Ok) {
+		#ifdef DEBUG
+			printf("%s:%u Stream read failed (%u)\n", __FILE__, __LINE__, ei2c);
+		#endif
+		return piezoE_CommunicationError;
+	}
+
+	for(i = 0; i < dwMaxBlocks; i=i+1) {
+		uint8_t* lpBlock = &(bData[i * PIEZOBOARD_STREAM_BLOCK_BYTES]);
+		struct piezoStreamBlock* lpOut = &(lpBlocksOut[dwBlocks]);
+
+		if((lpBlock[0] & 0x80) == 0) {
+			continue; /* Filler */
+		}
+
+		lpOut->bSequence = lpBlock[1];
+		lpOut->bOverflow = ((lpBlock[0] & 0x40) != 0) ? true : false;
+		if(lpThis->bStreamSynced && (lpOut->bSequence != (uint8_t)(lpThis->bStreamSequence + 1))) {
+			lpOut->bOverflow = true;
+		}
+		lpThis->bStreamSequence = lpOut->bSequence;
+		lpThis->bStreamSynced = true;
+
+		if((lpBlock[0] & 0x03) == piezoStreamEncoding_Raw) {
+			lpOut->bSamples = PIEZOBOARD_STREAM_BLOCK_SAMPLES;
+			for(j = 0; j < PIEZOBOARD_STREAM_BLOCK_SAMPLES; j=j+1) {
+				uint16_t sample = ((uint16_t)lpBlock[2+2*j]) | (((uint16_t)lpBlock[3+2*j]) << 8);
+				lpOut->channels[j] = (uint8_t)(sample >> 12);
+				lpOut->values[j] = sample & 0x03FF;
+			}
+		} else if(!piezoboardImpl__DecodeStreamBlock(lpBlock, lpOut)) {
+			return piezoE_CommunicationError;
+		}
+
+		dwBlocks = dwBlocks + 1;
+	}
+
+	(*lpBlocksRead) = dwBlocks;
+	return piezoE_Ok;
+}
 
 static struct piezoboardVtbl piezoboardImpl_DefaultVTBL = {
 	&piezoboardImpl__Release,
@@ -542,10 +2022,50 @@ static struct piezoboardVtbl piezoboardImpl_DefaultVTBL = {
 	&piezoboardImpl__SetTriggerMode,
 	&piezoboardImpl__GetAlpha,
 	&piezoboardImpl__SetAlpha,
+	&piezoboardImpl__GetFilterMode,
+	&piezoboardImpl__SetFilterMode,
+	&piezoboardImpl__GetDetectorMode,
+	&piezoboardImpl__SetDetectorMode,
+	&piezoboardImpl__GetThresholdMode,
+	&piezoboardImpl__SetThresholdMode,
+	&piezoboardImpl__GetBaselineTracking,
+	&piezoboardImpl__SetBaselineTracking,
+	&piezoboardImpl__GetQualifier,
+	&piezoboardImpl__SetQualifier,
 
 	&piezoboardImpl__Reset,
 	&piezoboardImpl__Recalibrate,
 	&piezoboardImpl__StoreSettings,
+	&piezoboardImpl__GetStoreStatus,
+	&piezoboardImpl__GetSettings,
+	&piezoboardImpl__SetSettings,
+	&piezoboardImpl__GetTuningProfiles,
+	&piezoboardImpl__SaveTuningProfile,
+	&piezoboardImpl__ActivateTuningProfile,
+
+	&piezoboardImpl__GetSampling,
+	&piezoboardImpl__SetSampling,
+	&piezoboardImpl__GetActiveChannels,
+	&piezoboardImpl__SetActiveChannels,
+	&piezoboardImpl__GetBiquad,
+	&piezoboardImpl__SetBiquad,
+	&piezoboardImpl__GetTriggerLatency,
+	&piezoboardImpl__GetNoiseStatistics,
+	&piezoboardImpl__ReadEvent,
+	&piezoboardImpl__ClearEvents,
+	&piezoboardImpl__GetCaptureStatus,
+	&piezoboardImpl__SetCapturePostTrigger,
+	&piezoboardImpl__ArmCapture,
+	&piezoboardImpl__ReadCapture,
+	&piezoboardImpl__GetTelemetry,
+	&piezoboardImpl__ResetTelemetry,
+	&piezoboardImpl__GetProfile,
+	&piezoboardImpl__ResetProfile,
+	&piezoboardImpl__ReadRegisters,
+	&piezoboardImpl__GetLiveStatus,
+	&piezoboardImpl__SetStream,
+	&piezoboardImpl__GetStreamStatus,
+	&piezoboardImpl__ReadStream,
 
 	&piezoboardImpl__DebugCurrentSensorReadings,
 	&piezoboardImpl__DebugCurrentSensorAverages
@@ -574,6 +2094,8 @@ enum piezoboardError piezoboardConnect(
 	lpNew->devAddress = boardAddress;
 	lpNew->dwFlags = dwFlags;
 	lpNew->lpBus = lpBus;
+	lpNew->bStreamSynced = false;
+	lpNew->bStreamSequence = 0;
 
 	(*lpBoardOut) = &(lpNew->objBoard);
 	return piezoE_Ok;
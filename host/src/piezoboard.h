@@ -19,6 +19,9 @@
 
 #define PIEZOBOARD_FLAG__VALIDFLAGS											(PIEZOBOARD_FLAG__BUS_CLOSE_ON_RELEASE)
 
+#define PIEZOBOARD_BUS_SPEED_STANDARD							100000		/* Standard mode I2C in Hz */
+#define PIEZOBOARD_BUS_SPEED_FAST								400000		/* Fast mode I2C, the highest speed supported by the board */
+
 enum piezoboardError {
 	piezoE_Ok					= 0,
 
@@ -38,6 +41,202 @@ enum piezoTriggerMode {
 	piezoTriggerMode_PiezoOrCapacitive	= 0x03,		/* Trigger if any of the sensors triggers */
 };
 
+enum piezoFilterMode {
+	piezoFilterMode_MovingAverage		= 0x00,		/* Exponentially weighted moving average (see alpha) */
+	piezoFilterMode_RunningMedian		= 0x01,		/* Running median over a configurable number of samples */
+};
+
+enum piezoDetectorMode {
+	piezoDetectorMode_Deviation			= 0x00,		/* Trigger on deviation of the filtered value from the calibrated centerline */
+	piezoDetectorMode_Slope				= 0x01,		/* Trigger on the change of the filtered value over a number of samples */
+};
+
+enum piezoThresholdMode {
+	piezoThresholdMode_Absolute			= 0x00,		/* Fixed threshold in ADC counts (see setThreshold) */
+	piezoThresholdMode_NoiseSigma		= 0x01,		/* k/10 standard deviations of the noise measured during calibration */
+};
+
+#define PIEZOBOARD_SAMPLINGFLAG__FAST8BIT						0x01
+
+#define PIEZOBOARD_TRACKSHIFT_MIN								4			/* Baseline tracker time constant 2^4 ... */
+#define PIEZOBOARD_TRACKSHIFT_MAX								24			/* ... 2^24 samples */
+#define PIEZOBOARD_FIXEDPOINT_ONE								32			/* Noise statistics are reported in 1/32 ADC counts */
+
+#define PIEZOBOARD_BIQUAD_STAGES_MAX							2
+#define PIEZOBOARD_BIQUAD_COEFF_ONE								16384		/* Biquad coefficients are Q2.14 */
+
+struct piezoBiquadCoefficients {
+	int16_t								b0;
+	int16_t								b1;
+	int16_t								b2;
+	int16_t								a1;			/* Feedback coefficients (a0 = 1) */
+	int16_t								a2;
+};
+
+#define PIEZOBOARD_SETTINGS_LAYOUT								0x01		/* Layout id of the settings block understood by this library */
+#define PIEZOBOARD_SETTINGS_VERSION								0x01
+#define PIEZOBOARD_SETTINGS_BLOCK_SIZE							55
+
+/*
+	Complete set of active settings as exchanged by getSettings and
+	setSettings (calibration is not included)
+*/
+struct piezoSettings {
+	enum piezoTriggerMode				triggerMode;
+	uint16_t							threshold;				/* ADC counts (0-1023) */
+	uint16_t							alphaPermille;			/* Moving average coefficient * 1000 (0-1000) */
+	uint32_t							dwInitSamples;			/* Calibration length in samples per channel (1-65535) */
+	uint16_t							debounceLength;			/* Output hold time in milliseconds (at least 1) */
+	enum piezoFilterMode				filterMode;
+	uint8_t								medianWindow;			/* 1-15 */
+	enum piezoDetectorMode				detectorMode;
+	uint8_t								slopeDistance;			/* 1-8 */
+	uint16_t							slopeThreshold;
+	uint16_t							sampleRate;				/* Samples per second and channel, 0: free running */
+	uint8_t								prescaler;				/* 1-7 */
+	uint8_t								samplingFlags;			/* PIEZOBOARD_SAMPLINGFLAG__ values */
+	uint8_t								activeChannels;			/* 1-15 */
+	enum piezoThresholdMode				thresholdMode;
+	uint8_t								sigmaFactor;			/* Tenths of a standard deviation (1-255) */
+	uint8_t								trackShift;				/* 0 or PIEZOBOARD_TRACKSHIFT_MIN to PIEZOBOARD_TRACKSHIFT_MAX */
+	uint8_t								freezeMargin;			/* 1-100 */
+	uint16_t							capturePostTrigger;
+	uint8_t								releasePercent;			/* 1-100 */
+	uint8_t								minSamples;				/* 1-255 */
+	uint8_t								minChannels;			/* 1-4 */
+	uint8_t								coincidenceWindow;
+	uint8_t								biquadStages;			/* 0 to PIEZOBOARD_BIQUAD_STAGES_MAX */
+	struct piezoBiquadCoefficients		biquad[PIEZOBOARD_BIQUAD_STAGES_MAX];
+};
+
+#define PIEZOBOARD_EVENTFLAG__FIRED							0x01		/* Output has been asserted during the event */
+#define PIEZOBOARD_EVENT_OFFSET_NONE							0xFF		/* Channel did not cross during the event */
+
+struct piezoEvent {
+	uint32_t							dwTimestamp;			/* Board time of the first crossing in microseconds */
+	enum piezoTriggerMode				triggerMode;			/* Trigger mode active at that time */
+	uint8_t								bFirstChannel;
+	uint8_t								bFlags;					/* PIEZOBOARD_EVENTFLAG__ values */
+	uint8_t								bCrossedMask;			/* Channels that crossed their threshold during the event */
+	uint8_t								bCrossOffset[4];		/* ADC conversions after the first crossing, PIEZOBOARD_EVENT_OFFSET_NONE if not crossed */
+	uint16_t							peakDeviation[4];		/* Peak deviation from centerline in 1/32 ADC counts */
+};
+
+enum piezoCaptureState {
+	piezoCaptureState_Armed				= 0x00,		/* Recording, waiting for a trigger */
+	piezoCaptureState_Triggered			= 0x01,		/* Recording post trigger samples */
+	piezoCaptureState_Frozen			= 0x02,		/* Window complete, can be read */
+	piezoCaptureState_Disabled			= 0x03,		/* Buffer in use by the sample stream */
+};
+
+#define PIEZOBOARD_CAPTURE_CHUNK_MAX							24			/* Samples per readCapture call */
+
+struct piezoCaptureStatus {
+	enum piezoCaptureState				state;
+	uint16_t							slots;					/* Capture buffer size in samples (all channels) */
+	uint16_t							bytes;					/* RAM used by the capture buffer */
+	uint16_t							postTrigger;			/* Configured number of samples after the trigger */
+	uint16_t							validSamples;			/* Samples in the current window */
+	uint16_t							triggerIndex;			/* Index of the trigger sample in the frozen window */
+};
+
+#define PIEZOBOARD_TELEMETRY_COUNTERS							13			/* 32 bit counters in the telemetry packet */
+
+struct piezoTelemetry {
+	uint32_t							dwTriggers[4];			/* Output assertions per trigger mode (indexed by enum piezoTriggerMode value) */
+	uint32_t							dwDebounceSuppressed;	/* Piezo detections ignored while the output was asserted */
+	uint32_t							dwRxOverflows;			/* Frames dropped because the board was still busy */
+	uint32_t							dwChecksumErrors;		/* Packets dropped by the board due to checksum errors */
+	uint32_t							dwResyncs;				/* Garbage skipped by the board while searching for the sync pattern */
+	uint32_t							dwTxUnderruns;			/* Bytes read by us while the board had nothing queued */
+	uint32_t							dwBusErrors;			/* TWI bus errors seen by the board */
+	uint32_t							dwCalibrations;			/* Completed centerline calibrations */
+	uint32_t							dwAdcOverruns;			/* ADC interrupts that took longer than one conversion */
+	uint32_t							dwTxRejected;			/* Responses the board discarded because its transmit ring was full */
+};
+
+enum piezoProfileSlot {
+	piezoProfileSlot_AdcInterrupt		= 0x00,
+	piezoProfileSlot_TwiInterrupt		= 0x01,
+	piezoProfileSlot_MainLoop			= 0x02,
+};
+
+#define PIEZOBOARD_PROFILE_SLOTS								3
+#define PIEZOBOARD_PROFILE_BINS									10
+#define PIEZOBOARD_PROFILE_BIN_SHIFT							6			/* Bin 0: below 2^6 cycles, bin n: 2^(n+5) to 2^(n+6)-1, last bin: everything above */
+
+struct piezoProfile {
+	uint32_t							dwCount;				/* Number of measured runs (halved together with the sum on overflow) */
+	uint16_t							minCycles;
+	uint16_t							meanCycles;
+	uint16_t							maxCycles;
+	uint16_t							histogram[PIEZOBOARD_PROFILE_BINS];
+};
+
+/*
+	Register map read directly (write register index, repeated start, read)
+	without a framed request. Refreshed by the board once per millisecond
+*/
+#define PIEZOBOARD_REGISTER_SELECT								0x80
+#define PIEZOBOARD_REGISTER_MAP_SIZE							32
+
+#define PIEZOBOARD_LIVESTATUS__CALIBRATING						0x01		/* Centerline calibration running */
+#define PIEZOBOARD_LIVESTATUS__OUTPUT							0x02		/* Trigger output asserted */
+#define PIEZOBOARD_LIVESTATUS__STOREBUSY						0x04		/* Settings are being written to EEPROM */
+#define PIEZOBOARD_LIVESTATUS__CAPTUREFROZEN					0x08		/* Capture window complete */
+
+struct piezoLiveStatus {
+	uint8_t								bFlags;					/* PIEZOBOARD_LIVESTATUS__ flags */
+	enum piezoTriggerMode				trigMode;
+	uint8_t								bSequence;				/* Incremented with every snapshot taken by the board */
+	uint8_t								bActiveChannels;
+	uint16_t							rawValues[4];			/* Last conversion per channel (0 for inactive channels) */
+	uint16_t							averages[4];			/* Filtered value per channel in ADC counts */
+	uint32_t							dwTriggers;				/* Output assertions of all trigger modes */
+	uint32_t							dwMillis;				/* Board uptime when the snapshot has been taken */
+	uint16_t							checksumErrors;			/* Lower 16 bits of the telemetry counters */
+	uint16_t							rxOverflows;
+};
+
+/*
+	Sample stream - fixed size blocks of raw samples (all active channels
+	in conversion order) drained with bulk reads. Streaming uses the
+	capture buffer of the board, the capture is disabled meanwhile.
+	The compact encodings fit more samples into a block, readStream
+	always returns decoded samples
+*/
+enum piezoStreamEncoding {
+	piezoStreamEncoding_Raw				= 0x00,		/* 16 samples tagged with their channel */
+	piezoStreamEncoding_Packed10		= 0x01,		/* 24 samples, 10 bit each */
+	piezoStreamEncoding_Delta			= 0x02,		/* Up to 60 samples as 4 bit deltas, absolute values on larger steps */
+};
+
+#define PIEZOBOARD_STREAM_SELECT								0xC1
+#define PIEZOBOARD_STREAM_BLOCK_SAMPLES							16			/* Samples of a raw block */
+#define PIEZOBOARD_STREAM_BLOCK_BYTES							(2+2*PIEZOBOARD_STREAM_BLOCK_SAMPLES)
+#define PIEZOBOARD_STREAM_SAMPLES_MAX							60			/* Samples of a block in any encoding */
+#define PIEZOBOARD_STREAM_READ_BLOCKS_MAX						16			/* Blocks per bulk read */
+
+struct piezoStreamStatus {
+	bool								bEnabled;
+	enum piezoStreamEncoding			encoding;
+	uint8_t								bBlockBytes;			/* Size of one block on the wire */
+	uint8_t								bBlockSamples;			/* Maximum samples per block with this encoding */
+	uint8_t								bBlocks;				/* Blocks buffered by the board */
+	uint32_t							dwDroppedSamples;		/* Samples dropped by the board since streaming has been enabled */
+};
+
+struct piezoStreamBlock {
+	uint8_t								bSequence;
+	bool								bOverflow;				/* Samples have been lost in front of this block */
+	uint8_t								bSamples;				/* Valid entries in channels and values */
+	uint8_t								channels[PIEZOBOARD_STREAM_SAMPLES_MAX];
+	uint16_t							values[PIEZOBOARD_STREAM_SAMPLES_MAX];
+};
+
+#define PIEZOBOARD_TUNING_PROFILES_MAX							8			/* Slots are reported as a bitmask */
+#define PIEZOBOARD_TUNING_PROFILE_NONE							0xFF		/* No profile saved or activated since power up */
+
 struct piezoboard;
 struct piezoboardVtbl;
 
@@ -74,6 +273,75 @@ typedef enum piezoboardError (*lpfnPiezoboard_Recalibrate)(
 typedef enum piezoboardError (*lpfnPiezoboard_StoreSettings)(
 	struct piezoboard* lpSelf
 );
+typedef enum piezoboardError (*lpfnPiezoboard_GetStoreStatus)(
+	struct piezoboard* lpSelf,
+	bool* lpBusy,
+	uint16_t* lpGeneration,
+	uint16_t* lpRecordsUsed,
+	uint16_t* lpRecordCapacity
+);
+
+typedef enum piezoboardError (*lpfnPiezoboard_GetSettings)(
+	struct piezoboard* lpSelf,
+	struct piezoSettings* lpSettingsOut
+);
+typedef enum piezoboardError (*lpfnPiezoboard_SetSettings)(
+	struct piezoboard* lpSelf,
+	struct piezoSettings* lpSettings
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetTuningProfiles)(
+	struct piezoboard* lpSelf,
+	uint8_t* lpSlotCount,
+	uint8_t* lpValidMask,
+	uint8_t* lpActiveProfile
+);
+typedef enum piezoboardError (*lpfnPiezoboard_SaveTuningProfile)(
+	struct piezoboard* lpSelf,
+	uint8_t bProfile
+);
+typedef enum piezoboardError (*lpfnPiezoboard_ActivateTuningProfile)(
+	struct piezoboard* lpSelf,
+	uint8_t bProfile,
+	bool bPersist
+);
+
+typedef enum piezoboardError (*lpfnPiezoboard_GetSampling)(
+	struct piezoboard* lpSelf,
+	uint16_t* lpSampleRate,
+	uint8_t* lpPrescaler,
+	uint8_t* lpFlags
+);
+typedef enum piezoboardError (*lpfnPiezoboard_SetSampling)(
+	struct piezoboard* lpSelf,
+	uint16_t sampleRate,
+	uint8_t prescaler,
+	uint8_t flags
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetBiquad)(
+	struct piezoboard* lpSelf,
+	uint8_t bStage,
+	uint8_t* lpStagesOut,
+	struct piezoBiquadCoefficients* lpCoefficientsOut
+);
+typedef enum piezoboardError (*lpfnPiezoboard_SetBiquad)(
+	struct piezoboard* lpSelf,
+	uint8_t bStages,
+	uint8_t bStage,
+	struct piezoBiquadCoefficients* lpCoefficients
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetActiveChannels)(
+	struct piezoboard* lpSelf,
+	uint8_t* lpChannelMask
+);
+typedef enum piezoboardError (*lpfnPiezoboard_SetActiveChannels)(
+	struct piezoboard* lpSelf,
+	uint8_t channelMask
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetTriggerLatency)(
+	struct piezoboard* lpSelf,
+	uint16_t* lpLatencyLast,
+	uint16_t* lpLatencyMax
+);
 
 typedef enum piezoboardError (*lpfnPiezoboard_DebugCurrentSensorReadings)(
 	struct piezoboard* lpSelf,
@@ -92,6 +360,139 @@ typedef enum piezoboardError (*lpfnPiezoboard_SetAlpha)(
 	struct piezoboard* lpSelf,
 	uint8_t alpha
 );
+typedef enum piezoboardError (*lpfnPiezoboard_GetFilterMode)(
+	struct piezoboard* lpSelf,
+	enum piezoFilterMode* lpFilterMode,
+	uint8_t* lpMedianWindow
+);
+typedef enum piezoboardError (*lpfnPiezoboard_SetFilterMode)(
+	struct piezoboard* lpSelf,
+	enum piezoFilterMode filterMode,
+	uint8_t medianWindow
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetDetectorMode)(
+	struct piezoboard* lpSelf,
+	enum piezoDetectorMode* lpDetectorMode,
+	uint8_t* lpSlopeDistance,
+	uint16_t* lpSlopeThreshold
+);
+typedef enum piezoboardError (*lpfnPiezoboard_SetDetectorMode)(
+	struct piezoboard* lpSelf,
+	enum piezoDetectorMode detectorMode,
+	uint8_t slopeDistance,
+	uint16_t slopeThreshold
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetThresholdMode)(
+	struct piezoboard* lpSelf,
+	enum piezoThresholdMode* lpThresholdMode,
+	uint8_t* lpSigmaFactor
+);
+typedef enum piezoboardError (*lpfnPiezoboard_SetThresholdMode)(
+	struct piezoboard* lpSelf,
+	enum piezoThresholdMode thresholdMode,
+	uint8_t sigmaFactor
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetBaselineTracking)(
+	struct piezoboard* lpSelf,
+	uint8_t* lpTrackShift,
+	uint8_t* lpFreezeMargin
+);
+typedef enum piezoboardError (*lpfnPiezoboard_SetBaselineTracking)(
+	struct piezoboard* lpSelf,
+	uint8_t trackShift,
+	uint8_t freezeMargin
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetQualifier)(
+	struct piezoboard* lpSelf,
+	uint8_t* lpReleasePercent,
+	uint8_t* lpMinSamples,
+	uint8_t* lpMinChannels,
+	uint8_t* lpCoincidenceWindow
+);
+typedef enum piezoboardError (*lpfnPiezoboard_SetQualifier)(
+	struct piezoboard* lpSelf,
+	uint8_t releasePercent,
+	uint8_t minSamples,
+	uint8_t minChannels,
+	uint8_t coincidenceWindow
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetNoiseStatistics)(
+	struct piezoboard* lpSelf,
+	bool* lpValid,
+	bool* lpRestored,
+	uint16_t lpSigma[4],
+	uint16_t lpThreshold[4]
+);
+typedef enum piezoboardError (*lpfnPiezoboard_ReadEvent)(
+	struct piezoboard* lpSelf,
+	bool bPop,
+	struct piezoEvent* lpEventOut,
+	uint8_t* lpPendingOut,
+	uint8_t* lpLostOut
+);
+typedef enum piezoboardError (*lpfnPiezoboard_ClearEvents)(
+	struct piezoboard* lpSelf
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetCaptureStatus)(
+	struct piezoboard* lpSelf,
+	struct piezoCaptureStatus* lpStatusOut
+);
+typedef enum piezoboardError (*lpfnPiezoboard_SetCapturePostTrigger)(
+	struct piezoboard* lpSelf,
+	uint16_t postTrigger
+);
+typedef enum piezoboardError (*lpfnPiezoboard_ArmCapture)(
+	struct piezoboard* lpSelf,
+	bool bForceTrigger
+);
+typedef enum piezoboardError (*lpfnPiezoboard_ReadCapture)(
+	struct piezoboard* lpSelf,
+	uint16_t offset,
+	uint8_t bCount,
+	uint16_t* lpValuesOut,
+	uint8_t* lpChannelsOut,
+	uint8_t* lpCountOut
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetTelemetry)(
+	struct piezoboard* lpSelf,
+	struct piezoTelemetry* lpTelemetryOut
+);
+typedef enum piezoboardError (*lpfnPiezoboard_ResetTelemetry)(
+	struct piezoboard* lpSelf
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetProfile)(
+	struct piezoboard* lpSelf,
+	enum piezoProfileSlot slot,
+	struct piezoProfile* lpProfileOut
+);
+typedef enum piezoboardError (*lpfnPiezoboard_ResetProfile)(
+	struct piezoboard* lpSelf
+);
+typedef enum piezoboardError (*lpfnPiezoboard_ReadRegisters)(
+	struct piezoboard* lpSelf,
+	uint8_t bRegister,
+	uint8_t* lpOut,
+	unsigned long int dwLength
+);
+typedef enum piezoboardError (*lpfnPiezoboard_SetStream)(
+	struct piezoboard* lpSelf,
+	bool bEnable,
+	enum piezoStreamEncoding encoding
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetStreamStatus)(
+	struct piezoboard* lpSelf,
+	struct piezoStreamStatus* lpStatusOut
+);
+typedef enum piezoboardError (*lpfnPiezoboard_ReadStream)(
+	struct piezoboard* lpSelf,
+	struct piezoStreamBlock* lpBlocksOut,
+	unsigned long int dwMaxBlocks,
+	unsigned long int* lpBlocksRead
+);
+typedef enum piezoboardError (*lpfnPiezoboard_GetLiveStatus)(
+	struct piezoboard* lpSelf,
+	struct piezoLiveStatus* lpStatusOut
+);
 
 
 struct piezoboardVtbl {
@@ -105,10 +506,50 @@ struct piezoboardVtbl {
 	lpfnPiezoboard_SetTriggerMode							setTriggerMode;
 	lpfnPiezoboard_GetAlpha									getAlpha;
 	lpfnPiezoboard_SetAlpha									setAlpha;
+	lpfnPiezoboard_GetFilterMode							getFilterMode;
+	lpfnPiezoboard_SetFilterMode							setFilterMode;
+	lpfnPiezoboard_GetDetectorMode							getDetectorMode;
+	lpfnPiezoboard_SetDetectorMode							setDetectorMode;
+	lpfnPiezoboard_GetThresholdMode							getThresholdMode;
+	lpfnPiezoboard_SetThresholdMode							setThresholdMode;
+	lpfnPiezoboard_GetBaselineTracking						getBaselineTracking;
+	lpfnPiezoboard_SetBaselineTracking						setBaselineTracking;
+	lpfnPiezoboard_GetQualifier								getQualifier;
+	lpfnPiezoboard_SetQualifier								setQualifier;
 
 	lpfnPiezoboard_Reset									reset;
 	lpfnPiezoboard_Recalibrate								recalibrate;
 	lpfnPiezoboard_StoreSettings							storeSettings;
+	lpfnPiezoboard_GetStoreStatus							getStoreStatus;
+	lpfnPiezoboard_GetSettings								getSettings;
+	lpfnPiezoboard_SetSettings								setSettings;
+	lpfnPiezoboard_GetTuningProfiles						getTuningProfiles;
+	lpfnPiezoboard_SaveTuningProfile						saveTuningProfile;
+	lpfnPiezoboard_ActivateTuningProfile					activateTuningProfile;
+
+	lpfnPiezoboard_GetSampling								getSampling;
+	lpfnPiezoboard_SetSampling								setSampling;
+	lpfnPiezoboard_GetActiveChannels						getActiveChannels;
+	lpfnPiezoboard_SetActiveChannels						setActiveChannels;
+	lpfnPiezoboard_GetBiquad								getBiquad;
+	lpfnPiezoboard_SetBiquad								setBiquad;
+	lpfnPiezoboard_GetTriggerLatency						getTriggerLatency;
+	lpfnPiezoboard_GetNoiseStatistics						getNoiseStatistics;
+	lpfnPiezoboard_ReadEvent								readEvent;
+	lpfnPiezoboard_ClearEvents								clearEvents;
+	lpfnPiezoboard_GetCaptureStatus							getCaptureStatus;
+	lpfnPiezoboard_SetCapturePostTrigger					setCapturePostTrigger;
+	lpfnPiezoboard_ArmCapture								armCapture;
+	lpfnPiezoboard_ReadCapture								readCapture;
+	lpfnPiezoboard_GetTelemetry								getTelemetry;
+	lpfnPiezoboard_ResetTelemetry							resetTelemetry;
+	lpfnPiezoboard_GetProfile								getProfile;
+	lpfnPiezoboard_ResetProfile								resetProfile;
+	lpfnPiezoboard_ReadRegisters							readRegisters;
+	lpfnPiezoboard_GetLiveStatus							getLiveStatus;
+	lpfnPiezoboard_SetStream								setStream;
+	lpfnPiezoboard_GetStreamStatus							getStreamStatus;
+	lpfnPiezoboard_ReadStream								readStream;
 
 	lpfnPiezoboard_DebugCurrentSensorReadings	getSensorReadings;
 	lpfnPiezoboard_DebugCurrentSensorAverages	getSensorAverages;
@@ -0,0 +1,86 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "./i2c.h"
+#include "./piezoboard.h"
+#include "./selftestboard.h"
+
+#if SELFTESTBOARD_STREAM_SAMPLES_MAX != PIEZOBOARD_STREAM_SAMPLES_MAX
+	#error SELFTESTBOARD_STREAM_SAMPLES_MAX has to match PIEZOBOARD_STREAM_SAMPLES_MAX
+#endif
+
+/*
+	Bus handed to the host library - every transfer is played through the
+	firmware's TWI interrupt handler by the self test
+*/
+static enum i2cError selftestBoard__WriteRead(
+	struct i2cBus* lpBus,
+	uint32_t devAddr,
+	uint8_t* lpData,
+	unsigned long int dwDataLength,
+	uint8_t* lpOut,
+	unsigned long int dwOutLength
+) {
+	selftestBusWriteRead(lpData, dwDataLength, lpOut, dwOutLength);
+	return i2cE_Ok;
+}
+
+static struct i2cBusVTBL selftestBoard_BusVTBL = {
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	&selftestBoard__WriteRead,
+	NULL,
+	NULL
+};
+static struct i2cBus selftestBoard_Bus = { &selftestBoard_BusVTBL, NULL };
+
+static struct piezoboard* lpSelftestBoard = NULL;
+
+int selftestBoardOpen() {
+	selftestBoardClose();
+	/* The bus model does not evaluate the address */
+	return (piezoboardConnect(&lpSelftestBoard, &selftestBoard_Bus, 0x11, 0) == piezoE_Ok) ? 0 : -1;
+}
+
+void selftestBoardClose() {
+	if(lpSelftestBoard != NULL) {
+		lpSelftestBoard->vtbl->release(lpSelftestBoard);
+		lpSelftestBoard = NULL;
+	}
+}
+
+long int selftestBoardReadStream(
+	unsigned long int dwMaxBlocks,
+	uint8_t* lpSequences,
+	uint8_t* lpOverflows,
+	uint8_t* lpBlockSamples,
+	uint8_t* lpChannels,
+	uint16_t* lpValues
+) {
+	struct piezoStreamBlock blocks[PIEZOBOARD_STREAM_READ_BLOCKS_MAX];
+	unsigned long int dwRead;
+	unsigned long int dwSamples = 0;
+	unsigned long int i;
+	unsigned long int j;
+
+	if(lpSelftestBoard == NULL) { return -1; }
+	if(dwMaxBlocks > PIEZOBOARD_STREAM_READ_BLOCKS_MAX) { return -1; }
+
+	if(lpSelftestBoard->vtbl->readStream(lpSelftestBoard, blocks, dwMaxBlocks, &dwRead) != piezoE_Ok) {
+		return -1;
+	}
+
+	for(i = 0; i < dwRead; i=i+1) {
+		lpSequences[i] = blocks[i].bSequence;
+		lpOverflows[i] = blocks[i].bOverflow ? 1 : 0;
+		lpBlockSamples[i] = blocks[i].bSamples;
+		for(j = 0; j < blocks[i].bSamples; j=j+1) {
+			lpChannels[dwSamples] = blocks[i].channels[j];
+			lpValues[dwSamples] = blocks[i].values[j];
+			dwSamples = dwSamples + 1;
+		}
+	}
+	return (long int)dwRead;
+}
@@ -0,0 +1,58 @@
+#ifndef __is_included__7c31e2a4_cd5e_11f1_9a0c_02fc00000001
+#define __is_included__7c31e2a4_cd5e_11f1_9a0c_02fc00000001 1
+
+/*
+	Host library side of piezoselftest
+
+	The firmware headers define bool as int, the host library as uint8_t,
+	so library structures cannot be used in the same translation unit as
+	the firmware. This interface only passes fixed width types.
+*/
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*
+	Implemented by the self test - writes dwDataLength bytes and reads
+	dwOutLength bytes after a repeated start through the TWI interrupt
+*/
+void selftestBusWriteRead(
+	const uint8_t* lpData,
+	unsigned long int dwDataLength,
+	uint8_t* lpOut,
+	unsigned long int dwOutLength
+);
+
+/*
+	Attaches a fresh host library instance (no stream sequence seen yet).
+	Returns 0 on success
+*/
+int selftestBoardOpen();
+void selftestBoardClose();
+
+/*
+	Reads up to dwMaxBlocks stream blocks with the host library. Per block
+	lpSequences, lpOverflows (0 or 1) and lpBlockSamples are filled, the
+	decoded samples of all blocks are appended to lpChannels and lpValues
+	(room for dwMaxBlocks * SELFTESTBOARD_STREAM_SAMPLES_MAX entries).
+	Returns the number of blocks read or -1 on error
+*/
+#define SELFTESTBOARD_STREAM_SAMPLES_MAX					60
+
+long int selftestBoardReadStream(
+	unsigned long int dwMaxBlocks,
+	uint8_t* lpSequences,
+	uint8_t* lpOverflows,
+	uint8_t* lpBlockSamples,
+	uint8_t* lpChannels,
+	uint16_t* lpValues
+);
+
+#ifdef __cplusplus
+	} /* extern "C" { */
+#endif
+
+#endif
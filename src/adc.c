@@ -4,7 +4,16 @@
 #include <stdint.h>
 
 #include "main.h"
+#include "biquad.h"
+#include "sysclk.h"
 #include "adc.h"
+#include "smoothing.h"
+#include "telemetry.h"
+#include "trigger.h"
+#include "eventlog.h"
+#include "capture.h"
+#include "stream.h"
+#include "profiler.h"
 
 /*
 	Analog digital module.
@@ -15,58 +24,426 @@
 
 extern struct eepromSettings currentSettings;
 
-float refCenterline[4];
+int16_t refCenterline[4];
 uint16_t currentADCValues[4];
-float currentMovingAverage[4];
-float currentMovingDeviation[4];
+int16_t currentMovingAverage[4];
+uint16_t currentMovingDeviation[4];
 unsigned long int adcMovingAverageCapCenterline;
 
-bool adcTriggered; /* This is reset from the main loop but set from our interrupt handler ... */
+bool adcTriggered; /* Pending piezo event - set by the detector, consumed when the output is asserted (see trigger.h) */
+
+/*
+	Fixed point state and coefficients used by the interrupt handler.
+
+	The coefficients are derived from currentSettings by adcApplySettings
+	whenever a setting changes so the ISR never touches floating point
+	values. The moving average itself is accumulated with 16 fractional
+	bits so small alpha values do not stall on rounding (see smoothing.h).
+*/
+static int32_t adcMovingAverageAccu[4];
+static uint32_t adcCenterlineAccu[4];
+static uint16_t adcAlphaQ;
+static uint16_t adcThresholdQ;
+static uint8_t adcFilterMode;
+
+/*
+	Noise statistics gathered during calibration. Instead of the textbook
+	Welford update (one division per sample) the squared deviations from
+	a shift value (the first calibration sample of the channel) are
+	summed - together with the plain sum of the centerline this yields
+	the variance with a single division at the end and stays numerically
+	well behaved since the shift is close to the mean. Squares are summed
+	as Q10.5 with saturation so an extremely noisy channel ends up with a
+	large (safe) threshold instead of wrapping around.
+*/
+static int16_t adcCalibShift[4];
+static uint32_t adcCalibSumSq[4];
+static uint8_t adcCalibShiftValid;
+static uint16_t adcNoiseSigma[4];
+static bool adcNoiseValid;
+static uint8_t adcThresholdMode;
+static uint8_t adcSigmaFactor;
+static uint16_t adcChannelThresholdQ[4];
+static uint32_t adcCalibSamples;			/* Samples per channel of the running calibration */
+
+/*
+	The divisions and square roots at the end of a calibration take far
+	longer than one conversion. The interrupt only flags the finished
+	accumulation, adcTask evaluates it from the main loop so the TWI
+	interrupt is not blocked meanwhile. Samples are ignored (the
+	calibration counter stays at 1) until the result has been applied.
+*/
+static volatile bool adcCalibPending;
+
+/*
+	Warm start. A calibration restored from EEPROM is only accepted after
+	a short verification run (ADC_WARMSTART_SAMPLES per channel, using the
+	normal calibration path) agrees with it - every active channel has to
+	be within half of its trigger threshold. Otherwise a full calibration
+	is started right away.
+*/
+static bool adcWarmStart;
+static bool adcCalibRestored;
+static int16_t adcWarmCenterline[4];
+static uint16_t adcWarmSigma[4];
+
+/*
+	Background baseline tracker. While a channel is quiet (deviation below
+	adcFreezeQ and the output not asserted) the centerline follows the
+	filtered value with a time constant of 2^adcTrackShift samples. The
+	tracker runs on its own accumulator with 16 additional fractional
+	bits so even very slow rates do not stall on rounding.
+*/
+static int32_t adcTrackAccu[4];
+static uint8_t adcTrackValid;
+static uint8_t adcTrackShift;
+static uint8_t adcFreezeMargin;
+static uint16_t adcFreezeQ[4];
+
+/*
+	Trigger qualification. A channel counts as above threshold once the
+	detector value exceeds its assert threshold and stays there until the
+	value drops to the release threshold (adcReleasePercent of the assert
+	threshold). adcAboveCount holds the number of consecutive samples
+	above, a channel is qualified after adcMinSamples of them. The piezo
+	event is raised once when adcMinChannels channels are qualified at the
+	same time and can only be raised again after channels have released,
+	so the output does not chatter while a signal hovers around the
+	threshold.
+
+	With a coincidence window a qualified channel keeps its vote for
+	adcCoincidenceConversions conversions (the window in samples per
+	channel times the number of active channels) even if it released in
+	between, so channels that are hit shortly after each other are
+	counted together. Votes expire when their channel is sampled again.
+*/
+static uint8_t adcAboveMask;
+static uint8_t adcAboveCount[4];
+static uint8_t adcQualifiedMask;
+static uint8_t adcReleasePercent;
+static uint8_t adcMinSamples;
+static uint8_t adcMinChannels;
+static uint16_t adcReleaseQ[4];
+static uint16_t adcSlopeReleaseQ;
+static uint8_t adcVoteMask;
+static uint16_t adcVoteStamp[4];
+static uint16_t adcConversions;
+static uint16_t adcCoincidenceConversions;
+
+static const uint8_t adcBitCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+/*
+	Currently applied sampling configuration. A sample rate of 0 means
+	free running conversions, otherwise conversions are started by the
+	Timer1 compare B event.
+*/
+static uint16_t adcSampleRate;
+static uint8_t adcPrescaler;
+static uint8_t adcSamplingFlags;
+static bool adcRunning;
+
+/*
+	Channel sequencer. adcNextChannel maps every channel to the next
+	active one so the ISR only visits fitted inputs. adcChannelPipeline
+	tracks which channel the conversion we read now (index 0) and - in
+	free running mode - the conversion already in progress (index 1)
+	belong to, since ADMUX is latched at the start of a conversion.
+*/
+static uint8_t adcActiveMask;
+static uint8_t adcNextChannel[4];
+static uint8_t adcFirstChannel;
+static uint8_t adcLastChannel;
+static uint8_t adcChannelPipeline[2];
+static uint8_t adcDetectorMode;
+
+/*
+	Slope detector state - the last bSlopeDistance filtered values of
+	every channel. The value leaving the ring is the one we compare
+	against
+*/
+static int16_t adcSlopeHistory[4][ADC_SLOPE_DISTANCE_MAX];
+static uint8_t adcSlopeFill[4];
+static uint8_t adcSlopePos[4];
+static uint8_t adcSlopeDistance;
+static uint16_t adcSlopeThresholdQ;
+
+/*
+	Biquad stage in front of the filter. Coefficients are shared by all
+	channels, every channel keeps its own history. adcBiquadPrimed has
+	one bit per channel that is cleared whenever the histories have to
+	be restarted - the next sample then primes them (see biquadPrime)
+*/
+static struct biquadCoefficients adcBiquadCoeff[BIQUAD_STAGES_MAX];
+static int16_t adcBiquadDCGain[BIQUAD_STAGES_MAX];
+static struct biquadState adcBiquadState[4][BIQUAD_STAGES_MAX];
+static uint8_t adcBiquadStages;
+static uint8_t adcBiquadPrimed;
+
+/*
+	Running median state (see smoothing.h), one window per channel
+*/
+static int16_t adcMedianHistory[4][ADC_MEDIAN_WINDOW_MAX];
+static int16_t adcMedianSorted[4][ADC_MEDIAN_WINDOW_MAX];
+static uint8_t adcMedianFill[4];
+static uint8_t adcMedianPos[4];
+static uint8_t adcMedianWindow;
+
+static inline int16_t adcMedianUpdate(uint8_t channel, int16_t value) {
+	return smoothingMedianUpdate(adcMedianHistory[channel], adcMedianSorted[channel], &(adcMedianFill[channel]), &(adcMedianPos[channel]), adcMedianWindow, value);
+}
+
+/*@
+	assigns \nothing;
+	ensures \result * \result <= value;
+*/
+static uint16_t adcSqrt32(uint32_t value) {
+	uint32_t root = 0;
+	uint32_t bit = 1UL << 30;
+
+	while(bit > value) { bit = bit >> 2; }
+	while(bit != 0) {
+		if(value >= root + bit) {
+			value = value - (root + bit);
+			root = (root >> 1) + bit;
+		} else {
+			root = root >> 1;
+		}
+		bit = bit >> 2;
+	}
+	return (uint16_t)root;
+}
+
+/*
+	Derives the per channel trigger thresholds of the deviation detector.
+	In sigma mode the threshold is k times the measured noise standard
+	deviation (but at least one ADC count), without valid noise statistics
+	the absolute threshold is used. Has to be called with interrupts
+	disabled or from interrupt context.
+*/
+/*@
+	assigns adcChannelThresholdQ[0..3];
+	assigns adcFreezeQ[0..3];
+	assigns adcReleaseQ[0..3];
+	assigns adcSlopeReleaseQ;
+*/
+static void adcUpdateThresholds() {
+	uint8_t i;
+
+	/*@
+		loop assigns adcChannelThresholdQ[0..3];
+		loop assigns adcFreezeQ[0..3];
+		loop assigns adcReleaseQ[0..3];
+		loop invariant 0 <= i <= 4;
+	*/
+	for(i = 0; i < 4; i=i+1) {
+		if((adcThresholdMode == thresholdMode_NoiseSigma) && adcNoiseValid) {
+			uint32_t threshold = (((uint32_t)adcNoiseSigma[i]) * adcSigmaFactor) / 10;
+			if(threshold < ADC_Q_ONE) { threshold = ADC_Q_ONE; }
+			if(threshold > 0xFFFF) { threshold = 0xFFFF; }
+			adcChannelThresholdQ[i] = (uint16_t)threshold;
+		} else {
+			adcChannelThresholdQ[i] = adcThresholdQ;
+		}
+
+		/* The baseline tracker freezes above this fraction of the threshold */
+		adcFreezeQ[i] = (uint16_t)((((uint32_t)adcChannelThresholdQ[i]) * adcFreezeMargin) / 100);
+
+		/* Hysteresis - an active channel releases at this level */
+		adcReleaseQ[i] = (uint16_t)((((uint32_t)adcChannelThresholdQ[i]) * adcReleasePercent) / 100);
+	}
+	adcSlopeReleaseQ = (uint16_t)((((uint32_t)adcSlopeThresholdQ) * adcReleasePercent) / 100);
+}
 
 ISR(ADC_vect) {
+	uint16_t tsSample = cycleCounterRead();
 	uint8_t oldMux = ADMUX;
-	uint8_t sampledValue = ((oldMux & 0x03) + 5) & 0x03;
+	uint8_t sampledValue;
+	uint16_t sample;
+	int16_t input;
+
+	sampledValue = adcChannelPipeline[0];
+	if(adcSampleRate == 0) {
+		/* Free running - the next conversion has already been started, select the one after */
+		adcChannelPipeline[0] = adcChannelPipeline[1];
+		adcChannelPipeline[1] = adcNextChannel[adcChannelPipeline[1]];
+		ADMUX = (oldMux & 0xE0) | adcChannelPipeline[1];
+	} else {
+		/* Timer triggered - the next conversion starts on the next compare match */
+		adcChannelPipeline[0] = adcNextChannel[sampledValue];
+		ADMUX = (oldMux & 0xE0) | adcChannelPipeline[0];
+		TIFR1 = 0x04; /* Clear OCF1B so the next compare match is a rising edge again */
+	}
+
+	if((adcSamplingFlags & SAMPLINGFLAG__FAST8BIT) != 0) {
+		sample = ((uint16_t)ADCH) << 2; /* Keep the 10 bit scale */
+	} else {
+		sample = ADC;
+	}
+
+	captureStore(sampledValue, sample);
+	streamStore(sampledValue, sample, adcActiveMask, adcNextChannel[sampledValue]);
+
+	/* Detector input in Q10.5 - optionally band limited by the biquad stages */
+	if(adcBiquadStages != 0) {
+		input = (int16_t)(biquadCascade(adcBiquadCoeff, adcBiquadDCGain, adcBiquadState[sampledValue], adcBiquadStages, (adcBiquadPrimed & (1 << sampledValue)) == 0, sample) << (ADC_Q_SHIFT - BIQUAD_SIGNAL_SHIFT));
+		adcBiquadPrimed = adcBiquadPrimed | (1 << sampledValue);
+	} else {
+		input = (int16_t)(sample << ADC_Q_SHIFT);
+	}
 
 	if(adcMovingAverageCapCenterline == 0) {
-		currentADCValues[sampledValue] = ADC;
+		int16_t avg;
+		uint16_t dev;
+		uint16_t level = 0;
+		uint16_t assertQ;
+		uint16_t releaseQ;
+		uint8_t channelBit = (1 << sampledValue);
+		bool bCrossed = false;
+		bool bDetected = false;
 
-		/* Update moving average */
-		currentMovingAverage[sampledValue] = ((float)(currentMovingAverage[sampledValue]) * (1.0f - currentSettings.movingAverage.dMovingAverageAlpha) + (float)(currentADCValues[sampledValue]) * currentSettings.movingAverage.dMovingAverageAlpha);
-		currentMovingDeviation[sampledValue] = (currentMovingAverage[sampledValue] > refCenterline[sampledValue]) ? currentMovingAverage[sampledValue] - refCenterline[sampledValue] : refCenterline[sampledValue] - currentMovingAverage[sampledValue];
-		if(currentMovingDeviation[sampledValue] > currentSettings.movingAverage.thresholdFactor) {
-			adcTriggered = true;
+		currentADCValues[sampledValue] = sample;
+
+		if(adcFilterMode == filterMode_RunningMedian) {
+			avg = adcMedianUpdate(sampledValue, input);
+		} else {
+			/* Update moving average - see smoothing.h */
+			avg = smoothingAverageUpdate(&(adcMovingAverageAccu[sampledValue]), adcAlphaQ, input);
 		}
-	} else {
-		refCenterline[sampledValue] = refCenterline[sampledValue] + (float)ADC;
-		if(sampledValue == 3) {
-			if((adcMovingAverageCapCenterline = adcMovingAverageCapCenterline - 1) == 0) {
-				refCenterline[0] = ((float)refCenterline[0]) / (float)(currentSettings.movingAverage.dwInitSamples);
-				refCenterline[1] = ((float)refCenterline[1]) / (float)(currentSettings.movingAverage.dwInitSamples);
-				refCenterline[2] = ((float)refCenterline[2]) / (float)(currentSettings.movingAverage.dwInitSamples);
-				refCenterline[3] = ((float)refCenterline[3]) / (float)(currentSettings.movingAverage.dwInitSamples);
-				#if 0
-					/*
-						This code is used for debug purposes - it pulls the output
-						high until the initialization has finished
-					*/
-					PORTB = PORTB & (~0x02);
-				#endif
+		dev = (avg > refCenterline[sampledValue]) ? (uint16_t)(avg - refCenterline[sampledValue]) : (uint16_t)(refCenterline[sampledValue] - avg);
+
+		currentMovingAverage[sampledValue] = avg;
+		currentMovingDeviation[sampledValue] = dev;
+
+		if(adcDetectorMode == detectorMode_Slope) {
+			/*
+				Differential detector: compare against the filtered value
+				adcSlopeDistance samples ago so slow baseline drift does not
+				matter, only the edge of a tap
+			*/
+			uint8_t pos = adcSlopePos[sampledValue];
+			int16_t oldAvg = adcSlopeHistory[sampledValue][pos];
+
+			adcSlopeHistory[sampledValue][pos] = avg;
+			pos = pos + 1;
+			if(pos >= adcSlopeDistance) { pos = 0; }
+			adcSlopePos[sampledValue] = pos;
+
+			if(adcSlopeFill[sampledValue] < adcSlopeDistance) {
+				adcSlopeFill[sampledValue] = adcSlopeFill[sampledValue] + 1;
+			} else {
+				level = (avg > oldAvg) ? (uint16_t)(avg - oldAvg) : (uint16_t)(oldAvg - avg);
 			}
+			assertQ = adcSlopeThresholdQ;
+			releaseQ = adcSlopeReleaseQ;
+		} else {
+			level = dev;
+			assertQ = adcChannelThresholdQ[sampledValue];
+			releaseQ = adcReleaseQ[sampledValue];
+		}
+
+		/* Hysteresis, qualification and voting - see adcAboveMask */
+		adcConversions = adcConversions + 1;
+		if(((adcVoteMask & channelBit) != 0) && ((uint16_t)(adcConversions - adcVoteStamp[sampledValue]) > adcCoincidenceConversions)) {
+			adcVoteMask = adcVoteMask & (~channelBit);
 		}
+		if((level > assertQ) || (((adcAboveMask & channelBit) != 0) && (level > releaseQ))) {
+			bCrossed = true;
+			adcAboveMask = adcAboveMask | channelBit;
+			if(adcAboveCount[sampledValue] < 0xFF) {
+				adcAboveCount[sampledValue] = adcAboveCount[sampledValue] + 1;
+			}
+			if(((adcQualifiedMask & channelBit) == 0) && (adcAboveCount[sampledValue] >= adcMinSamples)) {
+				adcQualifiedMask = adcQualifiedMask | channelBit;
+				if(adcCoincidenceConversions != 0) {
+					adcVoteStamp[sampledValue] = adcConversions;
+					adcVoteMask = adcVoteMask | channelBit;
+				}
+				if(adcBitCount[adcQualifiedMask | adcVoteMask] == adcMinChannels) {
+					adcTriggered = true;
+					bDetected = true;
+				}
+			}
+		} else {
+			adcAboveMask = adcAboveMask & (~channelBit);
+			adcQualifiedMask = adcQualifiedMask & (~channelBit);
+			adcAboveCount[sampledValue] = 0;
+		}
+
+		/* Decide and drive the output right here - see trigger.h */
+		if(adcTriggered != false) {
+			triggerEvaluate(tsSample, true, bDetected);
+		}
+
+		eventlogSample(sampledValue, dev, bCrossed);
+		if(bDetected) {
+			captureTrigger();
+		}
+
+		/* Follow slow drift of the baseline while the channel is quiet */
+		if((adcTrackShift != 0) && (triggerDebounceRemaining == 0) && (dev < adcFreezeQ[sampledValue])) {
+			if((adcTrackValid & (1 << sampledValue)) == 0) {
+				adcTrackAccu[sampledValue] = ((int32_t)refCenterline[sampledValue]) << 16;
+				adcTrackValid = adcTrackValid | (1 << sampledValue);
+			}
+			adcTrackAccu[sampledValue] = adcTrackAccu[sampledValue] + (((((int32_t)avg) << 16) - adcTrackAccu[sampledValue]) >> adcTrackShift);
+			refCenterline[sampledValue] = (int16_t)((adcTrackAccu[sampledValue] + (1L << 15)) >> 16);
+		}
+	} else if(!adcCalibPending) {
+		int16_t shifted;
+		uint32_t sq;
+
+		if((adcCalibShiftValid & (1 << sampledValue)) == 0) {
+			adcCalibShift[sampledValue] = input;
+			adcCalibShiftValid = adcCalibShiftValid | (1 << sampledValue);
+		}
+		shifted = input - adcCalibShift[sampledValue];
+		sq = ((uint32_t)((int32_t)shifted * (int32_t)shifted)) >> ADC_Q_SHIFT;
+		if(adcCalibSumSq[sampledValue] > 0xFFFFFFFFUL - sq) {
+			adcCalibSumSq[sampledValue] = 0xFFFFFFFFUL;
+		} else {
+			adcCalibSumSq[sampledValue] = adcCalibSumSq[sampledValue] + sq;
+		}
+
+		adcCenterlineAccu[sampledValue] = adcCenterlineAccu[sampledValue] + (uint16_t)input;
+		if(sampledValue == adcLastChannel) {
+			if(adcMovingAverageCapCenterline == 1) {
+				adcCalibPending = true; /* Evaluated by adcTask */
+			} else {
+				adcMovingAverageCapCenterline = adcMovingAverageCapCenterline - 1;
+			}
+		}
+	}
+
+	/*
+		If the next conversion has already completed while we were busy the
+		interrupt took longer than one conversion period - the channel
+		pipeline is one sample late from now on
+	*/
+	if((ADCSRA & 0x10) != 0) {
+		telemetryCounters.dwAdcOverruns = telemetryCounters.dwAdcOverruns + 1;
 	}
 
-	/* Select next MUX value for after the next iteration */
-	ADMUX = (oldMux & 0xE0) | (((oldMux & 0x1F) + 1) & 0x03);
+	#if PIEZO_PROFILER
+		profilerRecord(profilerSlot_AdcInterrupt, cycleCounterElapsed(tsSample));
+	#endif
 }
 
 /*@
 	assigns refCenterline[0..3];
-	assigns adcMovingAverageCapCenterline;
+	assigns adcCenterlineAccu[0..3];
+	assigns adcMedianFill[0..3], adcMedianPos[0..3];
+	assigns adcSlopeFill[0..3], adcSlopePos[0..3];
+	assigns adcCalibSumSq[0..3], adcCalibShiftValid;
+	assigns adcAboveCount[0..3], adcAboveMask, adcQualifiedMask, adcVoteMask;
+	assigns adcTrackValid;
+	assigns adcBiquadPrimed;
+	assigns adcCalibSamples, adcMovingAverageCapCenterline;
 
 	ensures refCenterline[0..3] == 0;
-	ensures adcMovingAverageCapCenterline == currentSettings.movingAverage.dwInitSamples;
+	ensures adcCenterlineAccu[0..3] == 0;
+	ensures adcMovingAverageCapCenterline == adcCalibSamples;
 */
-void adcStartCalibration() {
+static void adcStartCalibrationRun(uint32_t dwSamples) {
 	uint8_t i;
 	uint8_t sregOld = SREG;
 	#ifndef FRAMAC_SKIP
@@ -75,15 +452,611 @@ void adcStartCalibration() {
 
 	/*@
 		loop assigns refCenterline[0..3];
+		loop assigns adcCenterlineAccu[0..3];
+		loop assigns adcMedianFill[0..3], adcMedianPos[0..3];
+		loop assigns adcSlopeFill[0..3], adcSlopePos[0..3];
+		loop assigns adcCalibSumSq[0..3];
+		loop assigns adcAboveCount[0..3];
 
 		loop invariant 0 <= i < 4;
 	*/
-	for(i = 0; i < sizeof(refCenterline)/sizeof(float); i=i+1) {
+	for(i = 0; i < sizeof(refCenterline)/sizeof(refCenterline[0]); i=i+1) {
 		refCenterline[i] = 0;
+		adcCenterlineAccu[i] = 0;
+		adcMedianFill[i] = 0;
+		adcMedianPos[i] = 0;
+		adcSlopeFill[i] = 0;
+		adcSlopePos[i] = 0;
+		adcCalibSumSq[i] = 0;
+		adcAboveCount[i] = 0;
+	}
+	adcAboveMask = 0;
+	adcQualifiedMask = 0;
+	adcVoteMask = 0;
+	adcCalibShiftValid = 0;
+	adcTrackValid = 0;
+	adcBiquadPrimed = 0;
+	adcCalibSamples = (dwSamples != 0) ? dwSamples : 1;
+	adcMovingAverageCapCenterline = adcCalibSamples;
+	adcCalibPending = false;
+
+	SREG = sregOld;
+}
+
+/*@
+	assigns refCenterline[0..3];
+	assigns adcCenterlineAccu[0..3];
+	assigns adcMedianFill[0..3], adcMedianPos[0..3];
+	assigns adcSlopeFill[0..3], adcSlopePos[0..3];
+	assigns adcCalibSumSq[0..3], adcCalibShiftValid;
+	assigns adcAboveCount[0..3], adcAboveMask, adcQualifiedMask, adcVoteMask;
+	assigns adcTrackValid;
+	assigns adcBiquadPrimed;
+	assigns adcCalibSamples, adcMovingAverageCapCenterline;
+	assigns adcWarmStart;
+*/
+void adcStartCalibration() {
+	adcWarmStart = false;
+	adcStartCalibrationRun(currentSettings.movingAverage.dwInitSamples);
+}
+
+/*
+	Evaluates a finished calibration run (see adcCalibPending). Called
+	from the main loop, the interrupt keeps skipping samples until the
+	result has been applied
+*/
+static void adcFinishCalibration() {
+	uint8_t i;
+	uint32_t n = adcCalibSamples;
+	bool bAccept = true;
+
+	/*
+		One time division at the end of calibration. The accumulator
+		already holds Q10.5 values (so the biquad output is averaged
+		with full resolution), only the rounding is split off so
+		n/2 cannot overflow
+	*/
+	for(i = 0; i < 4; i=i+1) {
+		uint32_t q = adcCenterlineAccu[i] / n;
+		uint32_t r = adcCenterlineAccu[i] - q * n;
+		refCenterline[i] = (int16_t)(q + ((r + (n >> 1)) / n));
+
+		/*
+			Variance (Q10.5 counts^2) is the mean square of the shifted
+			samples minus the square of their mean offset
+		*/
+		{
+			int32_t meanOffset = ((int32_t)adcCenterlineAccu[i] - ((int32_t)n * adcCalibShift[i])) / (int32_t)n;
+			uint32_t meanOffsetSq = ((uint32_t)(meanOffset * meanOffset)) >> ADC_Q_SHIFT;
+			uint32_t variance = adcCalibSumSq[i] / n;
+
+			variance = (variance > meanOffsetSq) ? (variance - meanOffsetSq) : 0;
+			if(variance > (0xFFFFFFFFUL >> (ADC_Q_SHIFT + 1))) { variance = (0xFFFFFFFFUL >> (ADC_Q_SHIFT + 1)); }
+			adcNoiseSigma[i] = adcSqrt32(variance << ADC_Q_SHIFT);
+		}
+	}
+
+	if(adcWarmStart) {
+		/* Verification run - keep the restored calibration if the live signal agrees */
+		int16_t measured[4];
+
+		for(i = 0; i < 4; i=i+1) {
+			measured[i] = refCenterline[i];
+			refCenterline[i] = adcWarmCenterline[i];
+			adcNoiseSigma[i] = adcWarmSigma[i];
+		}
+		adcWarmStart = false;
+		adcNoiseValid = true;
+		adcUpdateThresholds();
+
+		for(i = 0; i < 4; i=i+1) {
+			uint16_t diff = (measured[i] > refCenterline[i]) ? (uint16_t)(measured[i] - refCenterline[i]) : (uint16_t)(refCenterline[i] - measured[i]);
+			if(((adcActiveMask & (1 << i)) != 0) && (diff > (adcChannelThresholdQ[i] >> 1))) {
+				bAccept = false;
+			}
+		}
+
+		if(bAccept) {
+			adcCalibRestored = true;
+		} else {
+			adcNoiseValid = false;
+			adcStartCalibration();
+		}
+	} else {
+		adcCalibRestored = false;
+		adcNoiseValid = true;
+		adcUpdateThresholds();
+		telemetryCounters.dwCalibrations = telemetryCounters.dwCalibrations + 1;
+	}
+
+	if(bAccept) {
+		/* Start the filter at the centerline instead of zero */
+		for(i = 0; i < 4; i=i+1) {
+			adcMovingAverageAccu[i] = smoothingAverageReset(refCenterline[i]);
+		}
+	}
+	#if 0
+		/*
+			This code is used for debug purposes - it pulls the output
+			high until the initialization has finished
+		*/
+		PORTB = PORTB & (~0x02);
+	#endif
+
+	if(bAccept) {
+		uint8_t sregOld = SREG;
+		#ifndef FRAMAC_SKIP
+			cli();
+		#endif
+
+		adcMovingAverageCapCenterline = 0;
+		adcCalibPending = false;
+
+		SREG = sregOld;
+	}
+}
+
+void adcTask() {
+	if(adcCalibPending) {
+		adcFinishCalibration();
+	}
+}
+
+/*
+	Starts a short verification run with the calibration held in
+	currentSettings if it has been taken with the current channels (see
+	adcInit). Returns false and leaves the running calibration untouched
+	otherwise
+*/
+/*@
+	assigns adcWarmCenterline[0..3], adcWarmSigma[0..3], adcWarmStart;
+*/
+bool adcRestoreCalibration() {
+	uint8_t i;
+	uint8_t sregOld;
+
+	if((currentSettings.calibration.bValid != SETTINGS_CALIBRATION_VALID) || (currentSettings.calibration.bActiveChannels != adcActiveMask) || (currentSettings.movingAverage.dwInitSamples <= ADC_WARMSTART_SAMPLES)) {
+		return false;
+	}
+
+	sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	for(i = 0; i < 4; i=i+1) {
+		adcWarmCenterline[i] = currentSettings.calibration.centerline[i];
+		adcWarmSigma[i] = currentSettings.calibration.noiseSigma[i];
+	}
+	adcStartCalibrationRun(ADC_WARMSTART_SAMPLES);
+	adcWarmStart = true;
+
+	SREG = sregOld;
+	return true;
+}
+
+/*
+	Copies the current calibration for storage in EEPROM. Fails while a
+	calibration or verification is running
+*/
+/*@
+	requires \valid(lpCenterline + (0..3));
+	requires \valid(lpSigma + (0..3));
+	requires \valid(lpActiveChannels);
+	assigns lpCenterline[0..3], lpSigma[0..3], *lpActiveChannels;
+*/
+bool adcCalibrationRead(int16_t* lpCenterline, uint16_t* lpSigma, uint8_t* lpActiveChannels) {
+	uint8_t i;
+	bool bValid;
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	bValid = adcNoiseValid && (adcMovingAverageCapCenterline == 0);
+	for(i = 0; i < 4; i=i+1) {
+		lpCenterline[i] = refCenterline[i];
+		lpSigma[i] = adcNoiseSigma[i];
+	}
+	(*lpActiveChannels) = adcActiveMask;
+
+	SREG = sregOld;
+	return bValid;
+}
+
+bool adcCalibrationRestored() {
+	return adcCalibRestored;
+}
+
+/*@
+	assigns \nothing;
+	ensures 0 <= \result <= 4;
+*/
+static uint8_t adcChannelCount(uint8_t bActiveChannels) {
+	uint8_t i;
+	uint8_t channelCount = 0;
+
+	for(i = 0; i < 4; i=i+1) {
+		if((bActiveChannels & (1 << i)) != 0) {
+			channelCount = channelCount + 1;
+		}
+	}
+	return channelCount;
+}
+
+uint8_t adcActiveChannels() {
+	return adcActiveMask;
+}
+
+/*@
+	requires \valid(lpSigmaOut + (0..3));
+	requires \valid(lpThresholdOut + (0..3));
+	assigns lpSigmaOut[0..3], lpThresholdOut[0..3];
+*/
+bool adcNoiseStatistics(uint16_t* lpSigmaOut, uint16_t* lpThresholdOut) {
+	uint8_t i;
+	bool bValid;
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	for(i = 0; i < 4; i=i+1) {
+		lpSigmaOut[i] = adcNoiseValid ? adcNoiseSigma[i] : 0;
+		lpThresholdOut[i] = adcChannelThresholdQ[i];
 	}
-	adcMovingAverageCapCenterline = currentSettings.movingAverage.dwInitSamples;
+	bValid = adcNoiseValid;
 
 	SREG = sregOld;
+	return bValid;
+}
+
+/*@
+	assigns \nothing;
+*/
+bool adcSamplingValid(uint16_t sampleRate, uint8_t bPrescaler, uint8_t bFlags, uint8_t bActiveChannels) {
+	uint8_t channelCount;
+
+	if((bPrescaler < 1) || (bPrescaler > 7)) {
+		return false;
+	}
+	if(((bActiveChannels & 0x0F) == 0) || ((bActiveChannels & 0xF0) != 0)) {
+		return false;
+	}
+	if((bFlags & (~SAMPLINGFLAG__VALIDFLAGS)) != 0) {
+		return false;
+	}
+	if(sampleRate == 0) {
+		return true;
+	}
+
+	channelCount = adcChannelCount(bActiveChannels);
+
+	/* The conversion has to fit into one timer period */
+	if((F_CPU / (((uint32_t)sampleRate) * channelCount)) < (((uint32_t)ADC_CONVERSION_CYCLES) << bPrescaler)) {
+		return false;
+	}
+	/* Timer1 runs without prescaler - the period has to fit its 16 bit TOP (0xFFFF selects normal mode) */
+	if((F_CPU / (((uint32_t)sampleRate) * channelCount)) > 0xFFFFUL) {
+		return false;
+	}
+
+	return true;
+}
+
+/*
+	(Re)configure ADC and Timer1 according to the currently applied
+	sampling settings. Aborts the conversion in progress and restarts
+	the sequence at channel 0.
+*/
+/*@
+	assigns ADMUX, ADCSRA, ADCSRB, TIFR1;
+	assigns TCCR1A, TCCR1B, OCR1A, OCR1B, TCNT1;
+*/
+static void adcConfigureSampling() {
+	uint16_t timerTop = 0xFFFF;
+	uint8_t i;
+
+	if(adcSampleRate != 0) {
+		uint32_t period = F_CPU / (((uint32_t)adcSampleRate) * adcChannelCount(adcActiveMask));
+		timerTop = (uint16_t)(period - 1); /* adcSamplingValid guarantees period <= 0xFFFF */
+	}
+
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+	{
+		ADCSRA = 0x10; /* Disable ADC, clear pending interrupt flag */
+		TIFR1 = 0x04;
+
+		/*
+			Build the channel sequence. The ADC interrupt of the previous
+			configuration must not see a half updated table, so this happens
+			with interrupts disabled and the ADC stopped
+		*/
+		adcFirstChannel = 0xFF;
+		for(i = 0; i < 4; i=i+1) {
+			if((adcActiveMask & (1 << i)) != 0) {
+				if(adcFirstChannel == 0xFF) { adcFirstChannel = i; }
+				adcLastChannel = i;
+			}
+		}
+		for(i = 0; i < 4; i=i+1) {
+			uint8_t next = (i + 1) & 0x03;
+			while((adcActiveMask & (1 << next)) == 0) {
+				next = (next + 1) & 0x03;
+			}
+			adcNextChannel[i] = next;
+		}
+		cycleCounterSetPeriod(timerTop);
+
+		PRR = PRR & ~(0x01);
+		ADMUX = 0x40 | (((adcSamplingFlags & SAMPLINGFLAG__FAST8BIT) != 0) ? 0x20 : 0x00) | adcFirstChannel; /* AVCC reference voltage, first channel, right or left aligned */
+		adcChannelPipeline[0] = adcFirstChannel;
+		adcChannelPipeline[1] = adcFirstChannel;
+
+		if(adcSampleRate == 0) {
+			ADCSRB = 0x00; /* Free running trigger mode, no comparator multiplexed */
+			ADCSRA = 0xB8 | adcPrescaler; /* Prescaler, interrupts enabled, autotriggering, enable; do not start */
+
+			/*
+				Now start conversion. The first two conversions both sample
+				the first channel, the ISR then advances the MUX value
+			*/
+			ADCSRA = ADCSRA | 0x40;
+		} else {
+			ADCSRB = 0x05; /* Timer/Counter1 compare match B starts conversions */
+			ADCSRA = 0xB8 | adcPrescaler; /* Prescaler, interrupts enabled, autotriggering, enable */
+		}
+	}
+	SREG = sregOld;
+}
+
+/*@
+	assigns adcAlphaQ;
+	assigns adcThresholdQ;
+	assigns adcThresholdMode, adcSigmaFactor, adcChannelThresholdQ[0..3];
+	assigns adcFreezeMargin, adcFreezeQ[0..3];
+	assigns adcTrackShift, adcTrackValid;
+	assigns adcReleasePercent, adcReleaseQ[0..3], adcSlopeReleaseQ;
+	assigns adcMinSamples, adcMinChannels, adcAboveMask, adcQualifiedMask, adcAboveCount[0..3];
+	assigns adcCoincidenceConversions, adcVoteMask;
+	assigns adcFilterMode;
+	assigns adcMedianWindow;
+	assigns adcMedianFill[0..3];
+	assigns adcMedianPos[0..3];
+	assigns adcDetectorMode;
+	assigns adcSlopeDistance;
+	assigns adcSlopeThresholdQ;
+	assigns adcSlopeFill[0..3];
+	assigns adcSlopePos[0..3];
+	assigns adcBiquadCoeff[0..BIQUAD_STAGES_MAX-1];
+	assigns adcBiquadDCGain[0..BIQUAD_STAGES_MAX-1];
+	assigns adcBiquadStages;
+	assigns adcBiquadPrimed;
+
+	ensures adcAlphaQ <= ADC_ALPHA_ONE;
+	ensures adcBiquadStages <= BIQUAD_STAGES_MAX;
+	ensures (adcTrackShift == 0) || (ADC_TRACK_SHIFT_MIN <= adcTrackShift <= ADC_TRACK_SHIFT_MAX);
+	ensures adcFreezeMargin <= 100;
+	ensures 1 <= adcMedianWindow <= ADC_MEDIAN_WINDOW_MAX;
+	ensures 1 <= adcSlopeDistance <= ADC_SLOPE_DISTANCE_MAX;
+*/
+void adcApplySettings() {
+	uint16_t alphaQ;
+	uint16_t thresholdQ;
+	uint16_t slopeThresholdQ;
+	uint8_t medianWindow;
+	uint8_t slopeDistance;
+	uint8_t biquadStages;
+	struct biquadCoefficients biquadCoeff[BIQUAD_STAGES_MAX];
+	int16_t biquadDCGain[BIQUAD_STAGES_MAX];
+	bool bBiquadChanged;
+	uint8_t trackShift;
+	uint8_t freezeMargin;
+	uint8_t releasePercent;
+	uint8_t minSamples;
+	uint8_t i;
+
+	/*
+		Convert the user facing settings into the fixed point coefficients
+		used inside the ISR. This is the only place where the float alpha
+		value is touched.
+	*/
+	if(currentSettings.movingAverage.dMovingAverageAlpha >= 1.0f) {
+		alphaQ = ADC_ALPHA_ONE;
+	} else if(currentSettings.movingAverage.dMovingAverageAlpha <= 0.0f) {
+		alphaQ = 0;
+	} else {
+		alphaQ = (uint16_t)(currentSettings.movingAverage.dMovingAverageAlpha * (float)ADC_ALPHA_ONE + 0.5f);
+	}
+
+	if(currentSettings.movingAverage.thresholdFactor >= (0xFFFFUL >> ADC_Q_SHIFT)) {
+		thresholdQ = 0xFFFF;
+	} else {
+		thresholdQ = (uint16_t)(currentSettings.movingAverage.thresholdFactor << ADC_Q_SHIFT);
+	}
+
+	if(currentSettings.detector.slopeThreshold >= (0xFFFFUL >> ADC_Q_SHIFT)) {
+		slopeThresholdQ = 0xFFFF;
+	} else {
+		slopeThresholdQ = (uint16_t)(currentSettings.detector.slopeThreshold << ADC_Q_SHIFT);
+	}
+
+	slopeDistance = currentSettings.detector.bSlopeDistance;
+	if(slopeDistance < 1) { slopeDistance = 1; }
+	if(slopeDistance > ADC_SLOPE_DISTANCE_MAX) { slopeDistance = ADC_SLOPE_DISTANCE_MAX; }
+
+	/*
+		Biquad coefficients are only used if every active stage is valid
+		(EEPROM contents written by older firmware are not trusted), the
+		DC gain used for priming is derived here in floating point
+	*/
+	biquadStages = currentSettings.biquad.bStages;
+	if(biquadStages > BIQUAD_STAGES_MAX) { biquadStages = 0; }
+	for(i = 0; i < biquadStages; i=i+1) {
+		float dcGain;
+
+		biquadCoeff[i].b0 = currentSettings.biquad.coefficients[i][0];
+		biquadCoeff[i].b1 = currentSettings.biquad.coefficients[i][1];
+		biquadCoeff[i].b2 = currentSettings.biquad.coefficients[i][2];
+		biquadCoeff[i].a1 = currentSettings.biquad.coefficients[i][3];
+		biquadCoeff[i].a2 = currentSettings.biquad.coefficients[i][4];
+		if(!biquadValid(&(biquadCoeff[i]))) {
+			biquadStages = 0;
+			break;
+		}
+
+		dcGain = ((float)biquadCoeff[i].b0 + (float)biquadCoeff[i].b1 + (float)biquadCoeff[i].b2) / ((float)BIQUAD_COEFF_ONE + (float)biquadCoeff[i].a1 + (float)biquadCoeff[i].a2);
+		if(dcGain >= (32767.0f / (float)BIQUAD_COEFF_ONE)) {
+			biquadDCGain[i] = 32767;
+		} else if(dcGain <= (-32767.0f / (float)BIQUAD_COEFF_ONE)) {
+			biquadDCGain[i] = -32767;
+		} else {
+			biquadDCGain[i] = (int16_t)(dcGain * (float)BIQUAD_COEFF_ONE + ((dcGain < 0) ? -0.5f : 0.5f));
+		}
+	}
+
+	trackShift = currentSettings.baseline.bTrackShift;
+	if((trackShift != 0) && ((trackShift < ADC_TRACK_SHIFT_MIN) || (trackShift > ADC_TRACK_SHIFT_MAX))) { trackShift = 0; }
+
+	freezeMargin = currentSettings.baseline.bFreezeMargin;
+	if(freezeMargin > 100) { freezeMargin = 100; }
+
+	releasePercent = currentSettings.qualifier.bReleasePercent;
+	if((releasePercent < 1) || (releasePercent > 100)) { releasePercent = 100; }
+
+	minSamples = currentSettings.qualifier.bMinSamples;
+	if(minSamples < 1) { minSamples = 1; }
+
+	medianWindow = currentSettings.filter.bMedianWindow;
+	if(medianWindow < 1) { medianWindow = 1; }
+	if(medianWindow > ADC_MEDIAN_WINDOW_MAX) { medianWindow = ADC_MEDIAN_WINDOW_MAX; }
+
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+	adcAlphaQ = alphaQ;
+	adcThresholdQ = thresholdQ;
+	adcThresholdMode = currentSettings.threshold.bThresholdMode;
+	adcSigmaFactor = currentSettings.threshold.bSigmaFactor;
+	adcFreezeMargin = freezeMargin;
+	adcReleasePercent = releasePercent;
+	adcSlopeThresholdQ = slopeThresholdQ;
+	adcUpdateThresholds();
+	if(adcTrackShift != trackShift) {
+		adcTrackValid = 0;
+	}
+	adcTrackShift = trackShift;
+
+	/* Restart the median window whenever mode or length changes */
+	if((adcFilterMode != currentSettings.filter.bFilterMode) || (adcMedianWindow != medianWindow)) {
+		/*@
+			loop assigns adcMedianFill[0..3];
+			loop assigns adcMedianPos[0..3];
+
+			loop invariant 0 <= i <= 4;
+		*/
+		for(i = 0; i < 4; i=i+1) {
+			adcMedianFill[i] = 0;
+			adcMedianPos[i] = 0;
+		}
+	}
+	adcFilterMode = currentSettings.filter.bFilterMode;
+	adcMedianWindow = medianWindow;
+
+	/* Same for the slope history */
+	if((adcDetectorMode != currentSettings.detector.bDetectorMode) || (adcSlopeDistance != slopeDistance)) {
+		/*@
+			loop assigns adcSlopeFill[0..3];
+			loop assigns adcSlopePos[0..3];
+
+			loop invariant 0 <= i <= 4;
+		*/
+		for(i = 0; i < 4; i=i+1) {
+			adcSlopeFill[i] = 0;
+			adcSlopePos[i] = 0;
+		}
+	}
+	adcDetectorMode = currentSettings.detector.bDetectorMode;
+	adcSlopeDistance = slopeDistance;
+
+	/* Restart the biquad histories if the stage setup changed */
+	bBiquadChanged = (adcBiquadStages != biquadStages);
+	/*@
+		loop assigns adcBiquadCoeff[0..BIQUAD_STAGES_MAX-1];
+		loop assigns adcBiquadDCGain[0..BIQUAD_STAGES_MAX-1];
+		loop assigns bBiquadChanged;
+
+		loop invariant 0 <= i <= biquadStages;
+	*/
+	for(i = 0; i < biquadStages; i=i+1) {
+		if((adcBiquadCoeff[i].b0 != biquadCoeff[i].b0) || (adcBiquadCoeff[i].b1 != biquadCoeff[i].b1) || (adcBiquadCoeff[i].b2 != biquadCoeff[i].b2) || (adcBiquadCoeff[i].a1 != biquadCoeff[i].a1) || (adcBiquadCoeff[i].a2 != biquadCoeff[i].a2)) {
+			bBiquadChanged = true;
+		}
+		adcBiquadCoeff[i] = biquadCoeff[i];
+		adcBiquadDCGain[i] = biquadDCGain[i];
+	}
+	adcBiquadStages = biquadStages;
+	if(bBiquadChanged) {
+		adcBiquadPrimed = 0;
+	}
+	SREG = sregOld;
+
+	/* The filtered signal has a different centerline now */
+	if(bBiquadChanged && adcRunning) {
+		adcStartCalibration();
+	}
+
+	/* Sampling changes require reprogramming ADC and Timer1 */
+	if(adcSamplingValid(currentSettings.sampling.sampleRate, currentSettings.sampling.bPrescaler, currentSettings.sampling.bFlags, currentSettings.sampling.bActiveChannels)) {
+		if((adcSampleRate != currentSettings.sampling.sampleRate) || (adcPrescaler != currentSettings.sampling.bPrescaler) || (adcSamplingFlags != currentSettings.sampling.bFlags) || (adcActiveMask != currentSettings.sampling.bActiveChannels)) {
+			bool bChannelsChanged = (adcActiveMask != currentSettings.sampling.bActiveChannels);
+
+			adcSampleRate = currentSettings.sampling.sampleRate;
+			adcPrescaler = currentSettings.sampling.bPrescaler;
+			adcSamplingFlags = currentSettings.sampling.bFlags;
+			adcActiveMask = currentSettings.sampling.bActiveChannels;
+			if(adcRunning) {
+				adcConfigureSampling();
+
+				/* Newly enabled channels have no centerline yet */
+				if(bChannelsChanged) {
+					adcStartCalibration();
+				}
+			}
+		}
+	}
+
+	/* Qualification can never require more channels than are sampled */
+	{
+		uint8_t minChannels = currentSettings.qualifier.bMinChannels;
+		uint8_t activeChannels = adcChannelCount((adcActiveMask != 0) ? adcActiveMask : 0x0F);
+		uint16_t coincidenceConversions = ((uint16_t)currentSettings.qualifier.bCoincidenceWindow) * activeChannels;
+
+		if(minChannels < 1) { minChannels = 1; }
+		if(minChannels > activeChannels) { minChannels = activeChannels; }
+
+		sregOld = SREG;
+		#ifndef FRAMAC_SKIP
+			cli();
+		#endif
+		if((adcMinSamples != minSamples) || (adcMinChannels != minChannels) || (adcCoincidenceConversions != coincidenceConversions)) {
+			/* Restart qualification, channels have to re-arm */
+			adcAboveMask = 0;
+			adcQualifiedMask = 0;
+			adcVoteMask = 0;
+			for(i = 0; i < 4; i=i+1) {
+				adcAboveCount[i] = 0;
+			}
+		}
+		adcMinSamples = minSamples;
+		adcMinChannels = minChannels;
+		adcCoincidenceConversions = coincidenceConversions;
+		SREG = sregOld;
+	}
 }
 
 /*@
@@ -93,19 +1066,18 @@ void adcStartCalibration() {
 	assigns currentADCValues[0..3];
 	assigns currentMovingAverage[0..3];
 	assigns currentMovingDeviation[0..3];
+	assigns adcMovingAverageAccu[0..3];
+	assigns adcRunning;
 	assigns PRR;
 	assigns ADMUX;
 	assigns ADCSRB;
 	assigns ADCSRA;
 
-	ensures adcMovingAverageCapCenterline == 0;
 	ensures adcTriggered == false;
+	ensures adcRunning == true;
 	ensures \forall integer iChannel; 0 <= iChannel < 4
 		==> (refCenterline[iChannel] == 0) && (currentADCValues[iChannel] == 0) && (currentMovingAverage[iChannel] == 0) && (currentMovingDeviation[iChannel] == 0);
 	ensures (PRR & 0x01) == 0;
-	ensures ADMUX == 0x41;
-	ensures ADCSRB == 0x00;
-	ensures ADCSRA == (0xBF | 0x40);
 */
 void adcInit() {
 	uint8_t i;
@@ -118,6 +1090,7 @@ void adcInit() {
 		loop assigns currentADCValues[0..3];
 		loop assigns currentMovingAverage[0..3];
 		loop assigns currentMovingDeviation[0..3];
+		loop assigns adcMovingAverageAccu[0..3];
 
 		loop invariant 0 <= i < 4;
 	*/
@@ -126,6 +1099,7 @@ void adcInit() {
 		currentADCValues[i] = 0;
 		currentMovingAverage[i] = 0;
 		currentMovingDeviation[i] = 0;
+		adcMovingAverageAccu[i] = 0;
 	}
 
 	uint8_t sregOld = SREG;
@@ -133,23 +1107,27 @@ void adcInit() {
 		cli();
 	#endif
 	{
-		/* In case we have no previous calibration start a new calibration sequence */
-		if((refCenterline[0] == 0.0f) && (refCenterline[1] == 0.0f) && (refCenterline[2] == 0.0f) && (refCenterline[3] == 0.0f)) {
+		/* Fall back to the default free running /128 mode if settings are unusable */
+		if(!adcSamplingValid(adcSampleRate, adcPrescaler, adcSamplingFlags, adcActiveMask)) {
+			adcSampleRate = 0;
+			adcPrescaler = 7;
+			adcSamplingFlags = 0;
+			adcActiveMask = 0x0F;
+		}
+
+		/*
+			Restore the stored calibration if it has been taken with the same
+			channels (it is verified against the first live samples),
+			otherwise start a new calibration sequence
+		*/
+		if(!adcRestoreCalibration()) {
 			adcStartCalibration();
 		}
 
-		PRR = PRR & ~(0x01);
-		ADMUX = 0x40; /* AVCC reference voltage, MUX 0, right aligned */
-		ADCSRB = 0x00; /* Free running trigger mode, no comparator multiplexed */
-		ADCSRA = 0xBF; /* /128 prescaler, interrupts enabled, autotriggering, enable; do not start */
+		adcConfigureSampling();
+		adcRunning = true;
 	}
 	SREG = sregOld;
 
-	/*
-		Now start conversion and advance the MUX value
-	*/
-	ADCSRA = ADCSRA | 0x40;
-	ADMUX = (ADMUX & 0xE0) | ((ADMUX & 0x03) + 1);
-
 	return;
 }
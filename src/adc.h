@@ -7,14 +7,83 @@
 	#define false 0
 #endif
 
-extern float refCenterline[4];
+/*
+	All filtered values (centerline, moving average, deviation) are kept
+	in signed Q10.5 fixed point, i.e. ADC counts multiplied by 32. This
+	keeps a full 10 bit sample inside an int16_t.
+*/
+#define ADC_Q_SHIFT							5
+#define ADC_Q_ONE							(1 << ADC_Q_SHIFT)
+
+/*
+	The moving average coefficient is applied as Q0.12 (4096 == 1.0)
+*/
+#define ADC_ALPHA_SHIFT						12
+#define ADC_ALPHA_ONE						(1 << ADC_ALPHA_SHIFT)
+
+/*
+	Upper bound for the running median window. Each sample slot costs
+	4 bytes of RAM per channel (history and sorted copy)
+*/
+#ifndef ADC_MEDIAN_WINDOW_MAX
+	#define ADC_MEDIAN_WINDOW_MAX			15
+#endif
+
+/*
+	Maximum distance (in samples per channel) the slope detector can
+	look back. Costs 2 bytes of RAM per channel and sample
+*/
+#ifndef ADC_SLOPE_DISTANCE_MAX
+	#define ADC_SLOPE_DISTANCE_MAX			8
+#endif
+
+/*
+	Allowed time constants of the baseline tracker as power of two
+	samples per channel (16 up to 16M samples)
+*/
+#define ADC_TRACK_SHIFT_MIN					4
+#define ADC_TRACK_SHIFT_MAX					24
+
+/*
+	Upper bound of the calibration length in samples per channel. Keeps
+	the 32 bit Q10.5 centerline accumulators from overflowing
+*/
+#define ADC_INITSAMPLES_MAX					65535UL
+/*
+	Samples per channel used to verify a calibration restored from EEPROM
+	at boot
+*/
+#ifndef ADC_WARMSTART_SAMPLES
+	#define ADC_WARMSTART_SAMPLES			32
+#endif
+
+/*
+	Number of ADC clock cycles reserved for one auto triggered conversion
+	(13.5 according to the datasheet) when validating sample rates
+*/
+#define ADC_CONVERSION_CYCLES				14
+
+extern int16_t refCenterline[4];
 extern uint16_t currentADCValues[4];
-extern float currentMovingAverage[4];
-extern float currentMovingDeviation[4];
+extern int16_t currentMovingAverage[4];
+extern uint16_t currentMovingDeviation[4];
 extern unsigned long int adcMovingAverageCapCenterline;
-extern bool adcTriggered; /* This is reset from the main loop but set from our interrupt handler ... */
+extern bool adcTriggered; /* Pending piezo event - set by the detector, consumed when the output is asserted (see trigger.h) */
 
 void adcStartCalibration();
+void adcApplySettings();
+bool adcSamplingValid(uint16_t sampleRate, uint8_t bPrescaler, uint8_t bFlags, uint8_t bActiveChannels);
+uint8_t adcActiveChannels();
+bool adcNoiseStatistics(uint16_t* lpSigmaOut, uint16_t* lpThresholdOut);
+bool adcCalibrationRead(int16_t* lpCenterline, uint16_t* lpSigma, uint8_t* lpActiveChannels);
+bool adcCalibrationRestored();
+bool adcRestoreCalibration();
 void adcInit();
 
+/*
+	Main loop part of the ADC module (finishes calibration runs outside
+	of interrupt context)
+*/
+void adcTask();
+
 #endif
@@ -0,0 +1,173 @@
+#ifndef __is_included__0b3f6e2a_ca7d_11f1_9c41_02fc00000001
+#define __is_included__0b3f6e2a_ca7d_11f1_9c41_02fc00000001 1
+
+/*
+	Fixed point biquad (second order IIR) stage
+
+	Direct form I with Q2.14 coefficients. The signal inside a stage is
+	kept in Q4 around the ADC midscale (512 counts) so a full scale input
+	spans +-2^13 and stage outputs are saturated to +-2^14. The 32 bit
+	accumulator does not overflow for coefficient sets passing
+	biquadValid:
+
+		feedback	|a1| < 2^15, |a2| < 2^14 (stability), |y| < 2^14
+					-> |a1 y1| + |a2 y2| < 2^29 + 2^28
+		feedforward	|b0| + |b1| + |b2| <= 2^16 (BIQUAD_B_SUM_MAX), |x| < 2^14
+					-> |b0 x + b1 x1 + b2 x2| <= 2^30
+
+	which sums up to less than 1.75 * 2^30 < 2^31. Stability alone does
+	not bound the b coefficients, three of them near full int16 range
+	would exceed 2^31.
+
+	This header is shared between the firmware (ADC interrupt) and the
+	host side filter harness so both run exactly the same arithmetic.
+	Only requires stdint.h to be included before.
+*/
+
+#define BIQUAD_COEFF_SHIFT				14
+#define BIQUAD_COEFF_ONE				(1 << BIQUAD_COEFF_SHIFT)
+#define BIQUAD_SIGNAL_SHIFT				4
+#define BIQUAD_SIGNAL_LIMIT				16383
+#define BIQUAD_MIDSCALE					512
+#define BIQUAD_OUTPUT_MAX				(((2 * BIQUAD_MIDSCALE) << BIQUAD_SIGNAL_SHIFT) - 1)
+#define BIQUAD_B_SUM_MAX				(4L * BIQUAD_COEFF_ONE)			/* Covers notch and high pass designs with b = g * (1, -2 cos w, 1), g <= 1 */
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+struct biquadCoefficients {
+	int16_t									b0;
+	int16_t									b1;
+	int16_t									b2;
+	int16_t									a1;							/* Feedback coefficients with a0 = 1, subtracted */
+	int16_t									a2;
+};
+
+struct biquadState {
+	int16_t									x1;
+	int16_t									x2;
+	int16_t									y1;
+	int16_t									y2;
+};
+
+/*
+	Both poles inside the unit circle (stability triangle |a2| < 1,
+	|a1| < 1 + a2)
+*/
+static inline int biquadStable(const struct biquadCoefficients* lpCoeff) {
+	if((lpCoeff->a2 >= BIQUAD_COEFF_ONE) || (lpCoeff->a2 <= -BIQUAD_COEFF_ONE)) {
+		return 0;
+	}
+	if(((int32_t)lpCoeff->a1 >= (int32_t)BIQUAD_COEFF_ONE + lpCoeff->a2) || (-(int32_t)lpCoeff->a1 >= (int32_t)BIQUAD_COEFF_ONE + lpCoeff->a2)) {
+		return 0;
+	}
+	return 1;
+}
+
+/*
+	Feedforward bound required for the accumulator (see above)
+*/
+static inline int biquadBounded(const struct biquadCoefficients* lpCoeff) {
+	int32_t sum = 0;
+
+	sum = sum + ((lpCoeff->b0 < 0) ? -(int32_t)lpCoeff->b0 : (int32_t)lpCoeff->b0);
+	sum = sum + ((lpCoeff->b1 < 0) ? -(int32_t)lpCoeff->b1 : (int32_t)lpCoeff->b1);
+	sum = sum + ((lpCoeff->b2 < 0) ? -(int32_t)lpCoeff->b2 : (int32_t)lpCoeff->b2);
+
+	return (sum <= BIQUAD_B_SUM_MAX) ? 1 : 0;
+}
+
+/*
+	Check done before coefficients are accepted
+*/
+static inline int biquadValid(const struct biquadCoefficients* lpCoeff) {
+	return (biquadStable(lpCoeff) && biquadBounded(lpCoeff)) ? 1 : 0;
+}
+
+static inline int16_t biquadSaturate(int32_t value) {
+	if(value > BIQUAD_SIGNAL_LIMIT) { return BIQUAD_SIGNAL_LIMIT; }
+	if(value < -BIQUAD_SIGNAL_LIMIT) { return -BIQUAD_SIGNAL_LIMIT; }
+	return (int16_t)value;
+}
+
+/*
+	One filter step. x is the stage input in Q4 around midscale, the
+	result the stage output in the same format.
+*/
+static inline int16_t biquadStep(const struct biquadCoefficients* lpCoeff, struct biquadState* lpState, int16_t x) {
+	int32_t accu;
+	int16_t y;
+
+	accu = (int32_t)lpCoeff->b0 * x
+		+ (int32_t)lpCoeff->b1 * lpState->x1
+		+ (int32_t)lpCoeff->b2 * lpState->x2
+		- (int32_t)lpCoeff->a1 * lpState->y1
+		- (int32_t)lpCoeff->a2 * lpState->y2;
+
+	y = biquadSaturate((accu + (1L << (BIQUAD_COEFF_SHIFT - 1))) >> BIQUAD_COEFF_SHIFT);
+
+	lpState->x2 = lpState->x1;
+	lpState->x1 = x;
+	lpState->y2 = lpState->y1;
+	lpState->y1 = y;
+
+	return y;
+}
+
+/*
+	Loads the stage history with the steady state response to a constant
+	input x so the filter starts without a step transient (which would
+	otherwise end up in the calibrated centerline). dcGain is the DC
+	gain of the stage in Q2.14
+*/
+static inline int16_t biquadPrime(int16_t dcGain, struct biquadState* lpState, int16_t x) {
+	int16_t y = biquadSaturate(((int32_t)dcGain * x + (1L << (BIQUAD_COEFF_SHIFT - 1))) >> BIQUAD_COEFF_SHIFT);
+
+	lpState->x1 = x;
+	lpState->x2 = x;
+	lpState->y1 = y;
+	lpState->y2 = y;
+
+	return y;
+}
+
+/*
+	Runs a raw ADC sample through bStages cascaded stages. Returns the
+	filtered value in ADC counts with BIQUAD_SIGNAL_SHIFT fractional bits
+	(midscale added back and clamped to the ADC range). With bPrime
+	set the stage histories are initialized instead (first sample after
+	a restart).
+*/
+static inline int16_t biquadCascade(
+	const struct biquadCoefficients* lpCoeff,
+	const int16_t* lpDCGain,
+	struct biquadState* lpState,
+	uint8_t bStages,
+	int bPrime,
+	uint16_t sample
+) {
+	int16_t v = (int16_t)(((int16_t)sample - BIQUAD_MIDSCALE) * (1 << BIQUAD_SIGNAL_SHIFT));
+	uint8_t stage;
+
+	if(bPrime) {
+		for(stage = 0; stage < bStages; stage=stage+1) {
+			v = biquadPrime(lpDCGain[stage], &(lpState[stage]), v);
+		}
+	} else {
+		for(stage = 0; stage < bStages; stage=stage+1) {
+			v = biquadStep(&(lpCoeff[stage]), &(lpState[stage]), v);
+		}
+	}
+
+	v = v + (BIQUAD_MIDSCALE << BIQUAD_SIGNAL_SHIFT);
+	if(v < 0) { return 0; }
+	if(v > BIQUAD_OUTPUT_MAX) { return BIQUAD_OUTPUT_MAX; }
+	return v;
+}
+
+#ifdef __cplusplus
+	} /* extern "C" { */
+#endif
+
+#endif
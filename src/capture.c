@@ -0,0 +1,102 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <stdint.h>
+
+#include "./main.h"
+#include "./capture.h"
+
+/*
+	Waveform capture storage
+
+	The buffer is written from the ADC interrupt only. Readout functions
+	disable interrupts while they touch the shared state.
+*/
+
+uint16_t captureBuffer[CAPTURE_SLOTS];
+uint16_t captureWritePos;
+uint16_t captureFill;
+uint16_t capturePostRemaining;
+uint16_t capturePostTrigger;
+uint8_t captureState;
+
+/*
+	Restarts recording. With bForceTrigger the trigger is fired right
+	away (on the samples recorded so far if the capture was already
+	armed, otherwise the window contains only post trigger samples)
+*/
+void captureArm(bool bForceTrigger) {
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	if((!bForceTrigger) || (captureState != captureState_Armed)) {
+		captureWritePos = 0;
+		captureFill = 0;
+		capturePostRemaining = 0;
+		captureState = captureState_Armed;
+	}
+	if(bForceTrigger) {
+		captureTrigger();
+	}
+
+	SREG = sregOld;
+}
+
+/*@
+	requires \valid(lpValidSamples) && \valid(lpTriggerIndex);
+	assigns *lpValidSamples, *lpTriggerIndex;
+*/
+uint8_t captureStatus(uint16_t* lpValidSamples, uint16_t* lpTriggerIndex) {
+	uint8_t state;
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	state = captureState;
+	(*lpValidSamples) = captureFill;
+	if((state == captureState_Frozen) && (captureFill > capturePostTrigger)) {
+		(*lpTriggerIndex) = captureFill - 1 - capturePostTrigger;
+	} else {
+		(*lpTriggerIndex) = 0;
+	}
+
+	SREG = sregOld;
+	return state;
+}
+
+/*@
+	requires \valid(lpOut + (0..2*bCount-1));
+	assigns lpOut[0..2*bCount-1];
+*/
+uint8_t captureRead(uint16_t offset, uint8_t bCount, uint8_t* lpOut) {
+	uint8_t i;
+	uint16_t idx;
+
+	/*
+		The buffer is not touched by the ISR while frozen so it can be
+		read with interrupts enabled
+	*/
+	if(captureState != captureState_Frozen) {
+		return 0;
+	}
+	if(offset >= captureFill) {
+		return 0;
+	}
+	if(bCount > captureFill - offset) {
+		bCount = (uint8_t)(captureFill - offset);
+	}
+
+	/* Oldest sample of the window */
+	idx = (captureWritePos + CAPTURE_SLOTS - captureFill + offset) % CAPTURE_SLOTS;
+	for(i = 0; i < bCount; i=i+1) {
+		lpOut[2*i] = (uint8_t)(captureBuffer[idx] & 0xFF);
+		lpOut[2*i+1] = (uint8_t)((captureBuffer[idx] >> 8) & 0xFF);
+		idx = idx + 1;
+		if(idx >= CAPTURE_SLOTS) { idx = 0; }
+	}
+
+	return bCount;
+}
@@ -0,0 +1,113 @@
+#ifndef __is_included__5e21b7a4_ca8a_11f1_8f3d_02fc00000001
+#define __is_included__5e21b7a4_ca8a_11f1_8f3d_02fc00000001 1
+
+/*
+	Waveform capture
+
+	All raw samples are continuously written into a ring buffer in
+	conversion order (every slot carries the channel number in its upper
+	bits, so the depth per channel grows when fewer channels are active).
+	When the detector fires - or when the host forces a trigger - another
+	postTrigger samples are recorded and the buffer is frozen so the
+	pre and post trigger window can be read out in chunks.
+
+	The buffer size is a build time parameter (CAPTURE_SLOTS, two bytes
+	of RAM per slot) and is reported together with the capture status.
+
+	Requires main.h to be included before.
+*/
+
+#ifndef CAPTURE_SLOTS
+	#define CAPTURE_SLOTS					128
+#endif
+
+/*
+	Samples per readout packet. The response always carries the full chunk
+	(58 bytes framed), which only fits the transmit ring while the host has
+	read everything queued before - otherwise it is refused and counted in
+	the telemetry (see i2cTransmitPacket)
+*/
+#define CAPTURE_CHUNK_MAX					24
+
+#define CAPTURE_CHANNEL_SHIFT				12
+#define CAPTURE_VALUE_MASK					0x03FF
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+enum captureState {
+	captureState_Armed						= 0x00,		/* Recording, waiting for a trigger */
+	captureState_Triggered					= 0x01,		/* Recording the post trigger samples */
+	captureState_Frozen						= 0x02,		/* Window complete, ready for readout */
+	captureState_Disabled					= 0x03,		/* Buffer in use by the sample stream (see stream.h) */
+};
+
+extern struct eepromSettings currentSettings;
+
+extern uint16_t captureBuffer[CAPTURE_SLOTS];
+extern uint16_t captureWritePos;
+extern uint16_t captureFill;
+extern uint16_t capturePostRemaining;
+extern uint16_t capturePostTrigger;			/* Post trigger length of the current window */
+extern uint8_t captureState;
+
+/*@
+	assigns captureState, captureWritePos, captureFill, capturePostRemaining;
+*/
+void captureArm(bool bForceTrigger);
+
+/*@
+	assigns \nothing;
+*/
+uint8_t captureStatus(uint16_t* lpValidSamples, uint16_t* lpTriggerIndex);
+
+/*
+	Copies up to bCount samples starting at offset (0 is the oldest
+	sample of the frozen window) into lpOut as little endian 16 bit
+	values (the wire format of the readout). Returns the number of samples
+	copied, 0 if the capture is not frozen or the offset is out of range
+*/
+uint8_t captureRead(uint16_t offset, uint8_t bCount, uint8_t* lpOut);
+
+/*
+	Called from the ADC interrupt for every raw sample
+*/
+static inline void captureStore(uint8_t channel, uint16_t sample) {
+	if(captureState >= captureState_Frozen) {
+		return;
+	}
+
+	captureBuffer[captureWritePos] = sample | (((uint16_t)channel) << CAPTURE_CHANNEL_SHIFT);
+	captureWritePos = captureWritePos + 1;
+	if(captureWritePos >= CAPTURE_SLOTS) { captureWritePos = 0; }
+	if(captureFill < CAPTURE_SLOTS) { captureFill = captureFill + 1; }
+
+	if(captureState == captureState_Triggered) {
+		capturePostRemaining = capturePostRemaining - 1;
+		if(capturePostRemaining == 0) {
+			captureState = captureState_Frozen;
+		}
+	}
+}
+
+/*
+	Called from the ADC interrupt after the sample that made the detector
+	fire has been stored
+*/
+static inline void captureTrigger() {
+	if(captureState != captureState_Armed) {
+		return;
+	}
+
+	capturePostRemaining = currentSettings.capture.postTrigger;
+	if(capturePostRemaining >= CAPTURE_SLOTS) { capturePostRemaining = CAPTURE_SLOTS - 1; }
+	capturePostTrigger = capturePostRemaining;
+	captureState = (capturePostRemaining == 0) ? captureState_Frozen : captureState_Triggered;
+}
+
+#ifdef __cplusplus
+	} /* extern "C" { */
+#endif
+
+#endif
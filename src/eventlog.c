@@ -0,0 +1,110 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <stdint.h>
+
+#include "./main.h"
+#include "./sysclk.h"
+#include "./adc.h"
+#include "./telemetry.h"
+#include "./trigger.h"
+#include "./eventlog.h"
+
+/*
+	Trigger event log storage
+
+	The ring is only written from the ADC interrupt and read with
+	interrupts disabled from the I2C message handler.
+*/
+
+struct eventlogEntry eventlogCurrent;
+bool eventlogOpen;
+uint8_t eventlogAboveMask;
+uint8_t eventlogConversions;
+
+static struct eventlogEntry eventlogRing[EVENTLOG_DEPTH];
+static uint8_t eventlogHead;		/* Index of the oldest entry */
+static uint8_t eventlogCount;
+static uint8_t eventlogLost;
+
+/*
+	Moves the current event into the ring. If the ring is full the
+	oldest event is overwritten - the most recent events are the
+	interesting ones. Only called from interrupt context
+*/
+/*@
+	assigns eventlogRing[0..EVENTLOG_DEPTH-1];
+	assigns eventlogHead, eventlogCount, eventlogLost;
+	assigns eventlogOpen;
+*/
+void eventlogClose() {
+	uint8_t idx;
+
+	if(eventlogCount == EVENTLOG_DEPTH) {
+		eventlogHead = (eventlogHead + 1) % EVENTLOG_DEPTH;
+		eventlogCount = eventlogCount - 1;
+		if(eventlogLost < 0xFF) { eventlogLost = eventlogLost + 1; }
+	}
+
+	idx = (eventlogHead + eventlogCount) % EVENTLOG_DEPTH;
+	eventlogRing[idx] = eventlogCurrent;
+	eventlogCount = eventlogCount + 1;
+
+	eventlogOpen = false;
+}
+
+void eventlogInit() {
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	eventlogOpen = false;
+	eventlogHead = 0;
+	eventlogCount = 0;
+	eventlogLost = 0;
+
+	SREG = sregOld;
+}
+
+/*@
+	requires \valid(lpOut) && \valid(lpLost);
+	assigns *lpOut, *lpLost;
+	assigns eventlogHead, eventlogCount;
+*/
+uint8_t eventlogRead(struct eventlogEntry* lpOut, bool bPop, uint8_t* lpLost) {
+	uint8_t count;
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	count = eventlogCount;
+	if(count > 0) {
+		(*lpOut) = eventlogRing[eventlogHead];
+		if(bPop) {
+			eventlogHead = (eventlogHead + 1) % EVENTLOG_DEPTH;
+			eventlogCount = eventlogCount - 1;
+		}
+	}
+	(*lpLost) = eventlogLost;
+
+	SREG = sregOld;
+	return count;
+}
+
+/*@
+	assigns eventlogHead, eventlogCount, eventlogLost;
+*/
+void eventlogClear() {
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	eventlogHead = 0;
+	eventlogCount = 0;
+	eventlogLost = 0;
+
+	SREG = sregOld;
+}
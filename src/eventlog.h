@@ -0,0 +1,118 @@
+#ifndef __is_included__3c9d4f1e_ca84_11f1_a7c2_02fc00000001
+#define __is_included__3c9d4f1e_ca84_11f1_a7c2_02fc00000001 1
+
+/*
+	Trigger event log
+
+	Every piezo event (one or more channels crossing their threshold) is
+	recorded from the ADC interrupt: the time of the first crossing, the
+	channel that crossed first, the order in which the other channels
+	followed and the peak deviation of every channel. An event stays open
+	while any channel is above its threshold or the output is asserted
+	and is then moved into a small ring buffer that can be read and
+	drained over I2C.
+
+	Requires main.h, sysclk.h, adc.h and trigger.h to be included before.
+*/
+
+#ifndef EVENTLOG_DEPTH
+	#define EVENTLOG_DEPTH					8
+#endif
+
+#define EVENTLOG_FLAG__FIRED				0x01		/* Output has been asserted during the event */
+
+#define EVENTLOG_OFFSET_NONE				0xFF		/* Channel did not cross during the event */
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+struct eventlogEntry {
+	uint32_t								dwTimestamp;				/* micros() at the first crossing */
+	uint8_t									bTriggerMode;				/* Trigger mode active at that time */
+	uint8_t									bFirstChannel;
+	uint8_t									bFlags;						/* EVENTLOG_FLAG__ values */
+	uint8_t									bCrossedMask;				/* Channels that crossed during the event */
+	uint8_t									bCrossOffset[4];			/* ADC conversions between first crossing and the crossing of this channel */
+	uint16_t								peakDeviation[4];			/* Maximum deviation from the centerline (Q10.5) */
+};
+
+extern struct eventlogEntry eventlogCurrent;
+extern bool eventlogOpen;
+extern uint8_t eventlogAboveMask;
+extern uint8_t eventlogConversions;
+
+void eventlogClose();
+
+/*@
+	assigns eventlogOpen;
+*/
+void eventlogInit();
+
+/*
+	Copies the oldest event into lpOut and optionally removes it from the
+	ring. Returns the number of pending events (before removal), lpLost
+	receives the number of events dropped since the last clear because
+	the ring was full
+*/
+uint8_t eventlogRead(struct eventlogEntry* lpOut, bool bPop, uint8_t* lpLost);
+
+void eventlogClear();
+
+/*
+	Called from the ADC interrupt for every sample after the trigger
+	decision has been taken. dev is the current deviation of channel,
+	bCrossed tells if the detector of that channel fired on this sample
+*/
+static inline void eventlogSample(uint8_t channel, uint16_t dev, bool bCrossed) {
+	uint8_t channelBit = (1 << channel);
+
+	if(!eventlogOpen) {
+		uint8_t i;
+
+		if(!bCrossed) {
+			return;
+		}
+
+		eventlogCurrent.dwTimestamp = micros();
+		eventlogCurrent.bTriggerMode = (uint8_t)currentSettings.trigMode;
+		eventlogCurrent.bFirstChannel = channel;
+		eventlogCurrent.bFlags = 0;
+		eventlogCurrent.bCrossedMask = 0;
+		for(i = 0; i < 4; i=i+1) {
+			eventlogCurrent.bCrossOffset[i] = EVENTLOG_OFFSET_NONE;
+			eventlogCurrent.peakDeviation[i] = 0;
+		}
+		eventlogAboveMask = 0;
+		eventlogConversions = 0;
+		eventlogOpen = true;
+	} else if(eventlogConversions < (EVENTLOG_OFFSET_NONE - 1)) {
+		eventlogConversions = eventlogConversions + 1;
+	}
+
+	if(bCrossed) {
+		eventlogAboveMask = eventlogAboveMask | channelBit;
+		if((eventlogCurrent.bCrossedMask & channelBit) == 0) {
+			eventlogCurrent.bCrossedMask = eventlogCurrent.bCrossedMask | channelBit;
+			eventlogCurrent.bCrossOffset[channel] = eventlogConversions;
+		}
+	} else {
+		eventlogAboveMask = eventlogAboveMask & (~channelBit);
+	}
+
+	if(dev > eventlogCurrent.peakDeviation[channel]) {
+		eventlogCurrent.peakDeviation[channel] = dev;
+	}
+
+	if(triggerDebounceRemaining != 0) {
+		eventlogCurrent.bFlags = eventlogCurrent.bFlags | EVENTLOG_FLAG__FIRED;
+	} else if(eventlogAboveMask == 0) {
+		eventlogClose();
+	}
+}
+
+#ifdef __cplusplus
+	} /* extern "C" { */
+#endif
+
+#endif
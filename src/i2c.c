@@ -5,25 +5,79 @@
 #include <stdint.h>
 
 #include "./main.h"
+#include "./sysclk.h"
 #include "./i2c.h"
+#include "./telemetry.h"
+#include "./profiler.h"
+#include "./capture.h"
+#include "./stream.h"
+
+#if F_CPU < (16 * I2C_SCL_MAX)
+	#error CPU clock too low for fast mode I2C
+#endif
 
 /*
 	I2C buffered I/O
 */
 
-static volatile uint8_t i2cBufferRX[I2C_BUFFER_SIZE_RX];
-static volatile int i2cBufferRX_Head = 0;
-static volatile int i2cBufferRX_Tail = 0;
+/*
+	Received bytes are parsed by a state machine directly in the TWI
+	interrupt. Complete frames with a valid checksum are stored linearly
+	(opcode, length, payload) in one of I2C_FRAME_SLOTS frame slots and
+	flagged ready for the main loop. While the main loop handles one frame
+	the next one can already be received into the other slot.
+*/
+enum i2cRxState {
+	i2cRxState_Sync0							= 0,		/* Waiting for the first 0xAA */
+	i2cRxState_Sync1							= 1,		/* Waiting for 0x55 */
+	i2cRxState_Sync2							= 2,		/* Waiting for 0xAA */
+	i2cRxState_Sync3							= 3,		/* Waiting for 0x55 */
+	i2cRxState_OpCode							= 4,		/* Sync complete - 0xAA repeats the sync, anything else is the opcode */
+	i2cRxState_Length							= 5,
+	i2cRxState_Payload							= 6,
+	i2cRxState_Checksum							= 7,
+};
+
+static volatile uint8_t i2cFrames[I2C_FRAME_SLOTS][I2C_BUFFER_SIZE_RX];
+static volatile uint8_t i2cFrameReady[I2C_FRAME_SLOTS];
+static volatile uint8_t i2cFrameSlotRX = 0;			/* Slot filled by the interrupt */
+static volatile uint8_t i2cFrameSlotMain = 0;		/* Next slot handled by the main loop */
+
+static uint8_t i2cRxState = i2cRxState_Sync0;
+static uint8_t i2cRxIndex = 0;
+static uint8_t i2cRxRemaining = 0;
+static uint8_t i2cRxChecksum = 0;
+static bool i2cRxDropFrame = false;					/* Both slots busy - frame is parsed but not stored */
+static bool i2cRxSkipping = false;					/* Currently skipping garbage (counted once per resync) */
+
+/*
+	Register map - double buffered. The main loop writes into the buffer
+	that is not published, the interrupt latches the published one at
+	the start of every read transaction
+*/
+#define I2C_REGISTER_NONE				0xFF
+#define I2C_REGISTER_READY				0xFE		/* Selected (and latched) when the ready status is read */
+#define I2C_REGISTER_STREAM				0xFD		/* Selected (and latched) while the sample stream is read */
+
+static volatile uint8_t i2cRegisters[2][I2C_REGISTER_MAP_SIZE];
+static volatile uint8_t i2cRegisterFront = 0;				/* Published buffer */
+static volatile uint8_t i2cRegisterReading = I2C_REGISTER_NONE;	/* Buffer latched by a running read transaction */
+static volatile uint8_t i2cRegisterSelected = I2C_REGISTER_NONE;	/* Selected register, none in packet mode */
+static volatile uint8_t i2cRegisterPos = 0;
+static bool i2cStreamFiller = false;					/* Current stream block is an empty filler */
+static bool i2cRxFirstByte = false;
 
 static volatile uint8_t i2cBufferTX[I2C_BUFFER_SIZE_TX];
-static volatile int i2cBufferTX_Head = 0;
-static volatile int i2cBufferTX_Tail = 0;
+static volatile uint8_t i2cBufferTX_Head = 0;
+static volatile uint8_t i2cBufferTX_Tail = 0;
+static volatile bool i2cTxDropped = false;			/* Reported once through the ready status */
 
 /*@
-	assigns \nothing;
+	assigns telemetryCounters.dwBusErrors;
 */
 static inline void i2cEventBusError() {
 	// Currently we force a reset by using the watchdog after 1s delay
+	telemetryCounters.dwBusErrors = telemetryCounters.dwBusErrors + 1;
 	return;
 }
 
@@ -32,7 +86,7 @@ static inline void i2cEventBusError() {
 	requires i2cBufferTX_Tail < I2C_BUFFER_SIZE_TX;
 	behavior bufferUnderrun:
 		assumes i2cBufferTX_Head == i2cBufferTX_Tail;
-		assigns \nothing;
+		assigns telemetryCounters.dwTxUnderruns;
 	behavior bufferDefault:
 		assumes i2cBufferTX_Head != i2cBufferTX_Tail;
 		assigns i2cBufferTX_Tail;
@@ -45,41 +99,218 @@ static inline void i2cEventBusError() {
 */
 static inline uint8_t i2cEventTransmit() {
 	if(i2cBufferTX_Head == i2cBufferTX_Tail) {
-		/* Empty buffer - buffer underrun ... ToDo */
+		/* Empty buffer - buffer underrun, the master reads 0x00 */
+		telemetryCounters.dwTxUnderruns = telemetryCounters.dwTxUnderruns + 1;
 		return 0x00;
 	} else {
-		uint8_t r = i2cBufferTX[i2cBufferTX_Tail];
-		i2cBufferTX_Tail = (i2cBufferTX_Tail + 1) % I2C_BUFFER_SIZE_TX;
+		uint8_t bTail = i2cBufferTX_Tail;
+		uint8_t r = i2cBufferTX[bTail];
+
+		/* Compare instead of modulo - cheap for any buffer size */
+		bTail = bTail + 1;
+		if(bTail >= I2C_BUFFER_SIZE_TX) { bTail = 0; }
+		i2cBufferTX_Tail = bTail;
 		return r;
 	}
 }
 
 /*@
-	requires i2cBufferRX_Head >= 0;
-	requires i2cBufferRX_Head < I2C_BUFFER_SIZE_RX;
-	behavior bufferOverflow:
-		assumes (i2cBufferRX_Head + 1) % I2C_BUFFER_SIZE_RX == i2cBufferRX_Tail;
-		assigns \nothing;
-	behavior bufferAvail:
-		assumes (i2cBufferRX_Head + 1) % I2C_BUFFER_SIZE_RX != i2cBufferRX_Tail;
-		assigns i2cBufferRX_Head;
-		assigns i2cBufferRX[i2cBufferRX_Head];
-		ensures i2cBufferRX_Head >= 0;
-		ensures i2cBufferRX_Head < I2C_BUFFER_SIZE_RX;
-		ensures i2cBufferRX_Head == \old((i2cBufferRX_Head + 1) % I2C_BUFFER_SIZE_RX);
-	disjoint behaviors;
-	complete behaviors;
+	assigns i2cRxState, i2cRxSkipping;
+	assigns telemetryCounters.dwResyncs;
+	ensures (i2cRxState == i2cRxState_Sync0) || (i2cRxState == i2cRxState_Sync1);
+*/
+static inline void i2cEventResync(uint8_t data) {
+	if(!i2cRxSkipping) {
+		telemetryCounters.dwResyncs = telemetryCounters.dwResyncs + 1;
+		i2cRxSkipping = true;
+	}
+	/* The offending byte may already start the next sync pattern */
+	i2cRxState = (data == 0xAA) ? i2cRxState_Sync1 : i2cRxState_Sync0;
+}
+
+/*@
+	assigns i2cRxState, i2cRxIndex, i2cRxSkipping;
+	assigns telemetryCounters.dwResyncs;
+	ensures i2cRxState == i2cRxState_Sync0;
+*/
+static inline void i2cEventFrameAbort() {
+	/*
+		Frames never span write transactions. A frame that is still
+		incomplete when the transaction ends has been truncated and
+		must not swallow the start of the next frame
+	*/
+	if(i2cRxState != i2cRxState_Sync0) {
+		telemetryCounters.dwResyncs = telemetryCounters.dwResyncs + 1;
+		i2cRxState = i2cRxState_Sync0;
+		i2cRxIndex = 0;
+	}
+	i2cRxSkipping = false;
+}
+
+/*@
+	requires i2cFrameSlotRX < I2C_FRAME_SLOTS;
+	requires i2cRxIndex < I2C_BUFFER_SIZE_RX;
+	assigns i2cRxState, i2cRxIndex, i2cRxRemaining, i2cRxChecksum, i2cRxDropFrame, i2cRxSkipping;
+	assigns i2cFrames[i2cFrameSlotRX][0 .. I2C_BUFFER_SIZE_RX-1];
+	assigns i2cFrameReady[i2cFrameSlotRX], i2cFrameSlotRX;
+	assigns telemetryCounters.dwResyncs, telemetryCounters.dwChecksumErrors, telemetryCounters.dwRxOverflows;
+	ensures i2cFrameSlotRX < I2C_FRAME_SLOTS;
+	ensures i2cRxIndex < I2C_BUFFER_SIZE_RX;
 */
 static inline void i2cEventReceived(uint8_t data) {
-	// Do whatever we want with the received data
-	if(((i2cBufferRX_Head + 1) % I2C_BUFFER_SIZE_RX) == i2cBufferRX_Tail) {
-		// Buffer overflow. ToDo
-		return;
+	switch(i2cRxState) {
+		case i2cRxState_Sync0:
+			if(data == 0xAA) {
+				i2cRxState = i2cRxState_Sync1;
+			} else {
+				i2cEventResync(data);
+			}
+			break;
+		case i2cRxState_Sync1:
+		case i2cRxState_Sync3:
+			if(data == 0x55) {
+				i2cRxState = i2cRxState + 1;
+			} else {
+				i2cEventResync(data);
+			}
+			break;
+		case i2cRxState_Sync2:
+			if(data == 0xAA) {
+				i2cRxState = i2cRxState_Sync3;
+			} else {
+				i2cEventResync(data);
+			}
+			break;
+		case i2cRxState_OpCode:
+			if(data == 0xAA) {
+				/* Additional 0xAA, 0x55 sequence used for resynchronization */
+				i2cRxState = i2cRxState_Sync3;
+				break;
+			}
+			i2cRxSkipping = false;
+			/*
+				If the main loop has not yet released the slot the frame is
+				still parsed (so we stay in sync) but dropped at the end
+			*/
+			i2cRxDropFrame = (i2cFrameReady[i2cFrameSlotRX] != 0) ? true : false;
+			i2cRxChecksum = data;
+			i2cRxIndex = 1;
+			if(!i2cRxDropFrame) {
+				i2cFrames[i2cFrameSlotRX][0] = data;
+			}
+			i2cRxState = i2cRxState_Length;
+			break;
+		case i2cRxState_Length:
+			if(data > (I2C_BUFFER_SIZE_RX - 2)) {
+				/* Cannot be one of our frames - most likely a sync pattern inside garbage */
+				i2cEventResync(data);
+				break;
+			}
+			i2cRxChecksum = i2cRxChecksum ^ data;
+			if(!i2cRxDropFrame) {
+				i2cFrames[i2cFrameSlotRX][1] = data;
+			}
+			i2cRxIndex = 2;
+			i2cRxRemaining = data;
+			i2cRxState = (data == 0) ? i2cRxState_Checksum : i2cRxState_Payload;
+			break;
+		case i2cRxState_Payload:
+			i2cRxChecksum = i2cRxChecksum ^ data;
+			if(!i2cRxDropFrame) {
+				i2cFrames[i2cFrameSlotRX][i2cRxIndex] = data;
+			}
+			i2cRxIndex = i2cRxIndex + 1;
+			i2cRxRemaining = i2cRxRemaining - 1;
+			if(i2cRxRemaining == 0) {
+				i2cRxState = i2cRxState_Checksum;
+			}
+			break;
+		case i2cRxState_Checksum:
+			/*
+				The checksum includes OpCode and Length but not the synchronization pattern
+				since the sync pattern could have an indefinite length
+			*/
+			if((i2cRxChecksum ^ data) != 0) {
+				telemetryCounters.dwChecksumErrors = telemetryCounters.dwChecksumErrors + 1;
+			} else if(i2cRxDropFrame) {
+				telemetryCounters.dwRxOverflows = telemetryCounters.dwRxOverflows + 1;
+			} else {
+				i2cFrameReady[i2cFrameSlotRX] = 1;
+				i2cFrameSlotRX = (i2cFrameSlotRX + 1) % I2C_FRAME_SLOTS;
+			}
+			i2cRxIndex = 0;
+			i2cRxState = i2cRxState_Sync0;
+			break;
+		default:
+			i2cRxState = i2cRxState_Sync0;
+			break;
+	}
+}
+
+/*@
+	requires \valid_read(lpSnapshot + (0 .. I2C_REGISTER_MAP_SIZE-1));
+*/
+bool i2cRegisterPublish(uint8_t* lpSnapshot) {
+	uint8_t i;
+	uint8_t bBack = i2cRegisterFront ^ 0x01;
+
+	/* The interrupt only ever latches the front buffer, so this cannot change below */
+	if(i2cRegisterReading == bBack) {
+		return false;
+	}
+
+	for(i = 0; i < I2C_REGISTER_MAP_SIZE; i=i+1) {
+		i2cRegisters[bBack][i] = lpSnapshot[i];
 	}
-	i2cBufferRX[i2cBufferRX_Head] = data;
-	i2cBufferRX_Head = (i2cBufferRX_Head + 1) % I2C_BUFFER_SIZE_RX;
+	i2cRegisterFront = bBack;
+	return true;
 }
 
+/*@
+	assigns i2cTxDropped;
+*/
+static inline uint8_t i2cEventReadyStatus(uint8_t bPos) {
+	uint8_t i;
+	uint8_t r = 0x00;
+
+	if(bPos == 0) {
+		for(i = 0; i < I2C_FRAME_SLOTS; i=i+1) {
+			if(i2cFrameReady[i] != 0) { r = I2C_READY__BUSY; }
+		}
+		if(i2cBufferTX_Head != i2cBufferTX_Tail) { r = r | I2C_READY__RESPONSE; }
+		if(i2cTxDropped) {
+			r = r | I2C_READY__DROPPED;
+			i2cTxDropped = false;
+		}
+	} else if(bPos == 1) {
+		r = (uint8_t)((i2cBufferTX_Tail <= i2cBufferTX_Head) ? (i2cBufferTX_Head - i2cBufferTX_Tail) : (I2C_BUFFER_SIZE_TX - i2cBufferTX_Tail + i2cBufferTX_Head));
+	}
+	return r;
+}
+
+/*@
+	requires (i2cRegisterReading < 2) || (i2cRegisterReading == I2C_REGISTER_READY) || (i2cRegisterReading == I2C_REGISTER_STREAM);
+	assigns i2cRegisterPos;
+*/
+static inline uint8_t i2cEventTransmitRegister() {
+	uint8_t r = 0x00;
+	if(i2cRegisterReading == I2C_REGISTER_STREAM) {
+		r = streamTransmit(i2cRegisterPos, &i2cStreamFiller);
+		i2cRegisterPos = i2cRegisterPos + 1;
+		if(i2cRegisterPos >= STREAM_BLOCK_BYTES) { i2cRegisterPos = 0; }
+	} else if(i2cRegisterReading == I2C_REGISTER_READY) {
+		r = i2cEventReadyStatus(i2cRegisterPos);
+		if(i2cRegisterPos < 2) { i2cRegisterPos = i2cRegisterPos + 1; }
+	} else if(i2cRegisterPos < I2C_REGISTER_MAP_SIZE) {
+		r = i2cRegisters[i2cRegisterReading][i2cRegisterPos];
+		i2cRegisterPos = i2cRegisterPos + 1;
+	}
+	return r;
+}
+
+/*
+	The slave needs no speed setting - see I2C_SCL_MAX
+*/
 void i2cSlaveInit(uint8_t address) {
 	#ifndef FRAMAC_SKIP
 		cli();
@@ -99,144 +330,165 @@ void i2cSlaveInit(uint8_t address) {
 	ensures TWCR == 0xC5;
 */
 ISR(TWI_vect) {
+	#if PIEZO_PROFILER
+		uint16_t tsStart = cycleCounterRead();
+	#endif
+
 	switch(TW_STATUS) { /* Note: TW_STATUS is an macro that masks status bits from TWSR) */
 		case TW_SR_SLA_ACK:
 			/*
 				Slave will read, slave has been addresses and address
-				has been acknowledged
+				has been acknowledged. Any write leaves register mode
 			*/
+			i2cRegisterSelected = I2C_REGISTER_NONE;
+			i2cRxFirstByte = true;
+			i2cEventFrameAbort(); /* Repeated start without a stop */
 			break;
 		case TW_SR_DATA_ACK:
 			/*
 				We have received data. This is now contained in the TWI
-				data register (TWDR)
+				data register (TWDR). A register select can only be the
+				first byte of a write outside of a packet
 			*/
-			i2cEventReceived(TWDR);
+			{
+				uint8_t data = TWDR;
+				if(!(i2cRxFirstByte && (i2cRxState == i2cRxState_Sync0))) {
+					i2cEventReceived(data);
+				} else if((data & I2C_REGISTER_SELECT_MASK) == I2C_REGISTER_SELECT) {
+					i2cRegisterSelected = data & (~I2C_REGISTER_SELECT_MASK);
+				} else if(data == I2C_READY_SELECT) {
+					i2cRegisterSelected = I2C_REGISTER_READY;
+				} else if(data == I2C_STREAM_SELECT) {
+					i2cRegisterSelected = I2C_REGISTER_STREAM;
+				} else {
+					i2cEventReceived(data);
+				}
+				i2cRxFirstByte = false;
+			}
+			break;
+		case TW_SR_STOP:
+			/* Write transaction finished */
+			i2cEventFrameAbort();
 			break;
 		case TW_ST_SLA_ACK:
+			/*
+				Slave selected and data requested - either from the register
+				map or from the transmit ring
+			*/
+			if(i2cRegisterSelected == I2C_REGISTER_READY) {
+				/* Only valid for a single read - the response follows in packet mode */
+				i2cRegisterSelected = I2C_REGISTER_NONE;
+				i2cRegisterReading = I2C_REGISTER_READY;
+				i2cRegisterPos = 0;
+				TWDR = i2cEventTransmitRegister();
+			} else if(i2cRegisterSelected == I2C_REGISTER_STREAM) {
+				/* Every read starts at a block boundary */
+				i2cRegisterReading = I2C_REGISTER_STREAM;
+				i2cRegisterPos = 0;
+				TWDR = i2cEventTransmitRegister();
+			} else if(i2cRegisterSelected != I2C_REGISTER_NONE) {
+				i2cRegisterReading = i2cRegisterFront;
+				i2cRegisterPos = i2cRegisterSelected;
+				TWDR = i2cEventTransmitRegister();
+			} else {
+				TWDR = i2cEventTransmit();
+			}
+			break;
 		case TW_ST_DATA_ACK:
 			/*
-				Either slave selected (SLA_ACK) and data requested or data
-				transmitted, ACK received and next data requested
+				Data transmitted, ACK received and next data requested
 			*/
-			TWDR = i2cEventTransmit();
+			if(i2cRegisterReading != I2C_REGISTER_NONE) {
+				TWDR = i2cEventTransmitRegister();
+			} else {
+				TWDR = i2cEventTransmit();
+			}
+			break;
+		case TW_ST_DATA_NACK:
+		case TW_ST_LAST_DATA:
+			/* Read transaction finished - release the latched register buffer */
+			i2cRegisterReading = I2C_REGISTER_NONE;
 			break;
 		case TW_BUS_ERROR:
+			i2cRegisterReading = I2C_REGISTER_NONE;
+			i2cEventFrameAbort();
 			i2cEventBusError();
 			break;
 		default:
 			break;
 	}
 	TWCR = 0xC5; // Set TWIE (TWI Interrupt enable), TWEN (TWI Enable), TWEA (TWI Enable Acknowledgement), TWINT (Clear TWINT flag by writing a 1)
+
+	#if PIEZO_PROFILER
+		profilerRecord(profilerSlot_TwiInterrupt, cycleCounterElapsed(tsStart));
+	#endif
 }
 
 /*
-    Synchronous message loop
+	Synchronous message loop - hands the next frame received by the
+	interrupt to the command handler and releases its slot afterwards.
+
+	Frame layout inside the slot:
+		+0				OpCode
+		+1				Length
+		+2 ...			Payload (Length bytes)
 */
 void i2cMessageLoop() {
-    unsigned long int i;
-
-    uint8_t rcvBytes = (i2cBufferRX_Tail <= i2cBufferRX_Head) ? (i2cBufferRX_Head - i2cBufferRX_Tail) : (I2C_BUFFER_SIZE_RX - i2cBufferRX_Tail + i2cBufferRX_Head);
-
-    if(rcvBytes < 5) {
-        return; /* Nothing has been received */
-    }
-
-    /* check for next sync pattern ... */
-    while(rcvBytes > 4) {
-        if((i2cBufferRX[i2cBufferRX_Tail] == 0xAA)
-            && (i2cBufferRX[(i2cBufferRX_Tail+1) % I2C_BUFFER_SIZE_RX] == 0x55)
-            && (i2cBufferRX[(i2cBufferRX_Tail+2) % I2C_BUFFER_SIZE_RX] == 0xAA)
-            && (i2cBufferRX[(i2cBufferRX_Tail+3) % I2C_BUFFER_SIZE_RX] == 0x55)
-            && (i2cBufferRX[(i2cBufferRX_Tail+4) % I2C_BUFFER_SIZE_RX] != 0xAA)) {
-            /* Discovered start of packet */
-            break;
-        }
-
-        /* Moving on till we discover the sync pattern ... */
-        rcvBytes = rcvBytes - 1;
-        i2cBufferRX_Tail = (i2cBufferRX_Tail + 1) % I2C_BUFFER_SIZE_RX;
-    }
-    if(rcvBytes <= 6) {
-        return; /* Inconclusive */
-    }
-
-    /*
-        Possible packet present ... check if it's fully available. If not
-        continue waiting.
-
-        Layout:
-            +0              0xAA
-            +1              0x55
-            +2              0xAA
-            +3              0x55
-            +4              OpCode
-            +5              Length
-            ...
-            +(5 + len + 1)  Checksum
-    */
-    uint8_t requiredPacketLength = 4 + 2 + 1 + i2cBufferRX[(i2cBufferRX_Tail + 5) % I2C_BUFFER_SIZE_RX];
-    if(rcvBytes < requiredPacketLength) {
-        return; /* We have to wait longer ... */
-    }
-
-    /*
-		Perform checksum check ...
-
-		The checksum includes OpCode and Length but not the synchronization pattern
-		since the sync pattern could have an indefinite length
-	*/
-    uint8_t chksum = 0x00;
-    for(i = 4; i < requiredPacketLength; i=i+1) {
-        chksum = chksum ^ i2cBufferRX[(i2cBufferRX_Tail + i) % I2C_BUFFER_SIZE_RX];
-    }
-
-    if(chksum != 0) {
-        /*
-            Drop packet and resync ... ToDo: Should we count
-            checksum mismatches or provide some kind of notification?
-
-            We simply skip the synchronization pattern - the sync loop above
-            will perform resynchronization anyways just in case there is
-			a packet start somewhere shifted in between ...
-        */
-        i2cBufferRX_Tail = (i2cBufferRX_Tail + 4) % I2C_BUFFER_SIZE_RX;
-        return;
-    }
-
-    /*
-        We got a full packet that's correctly checksummed ...
-    */
-    handleI2CMessage(i2cBufferRX, I2C_BUFFER_SIZE_RX, i2cBufferRX_Tail+4, requiredPacketLength-4-1);
-    i2cBufferRX_Tail = (i2cBufferRX_Tail + requiredPacketLength) % I2C_BUFFER_SIZE_RX; /* Drop data */
+	uint8_t bSlot = i2cFrameSlotMain;
+
+	if(i2cFrameReady[bSlot] == 0) {
+		return; /* Nothing has been received */
+	}
+
+	handleI2CMessage(i2cFrames[bSlot], I2C_BUFFER_SIZE_RX, 0, 2 + i2cFrames[bSlot][1]);
+
+	i2cFrameReady[bSlot] = 0;
+	i2cFrameSlotMain = (bSlot + 1) % I2C_FRAME_SLOTS;
 }
 
-void i2cTransmitBytes(
-    uint8_t* lpMessage,
-    unsigned long int dwLength
-) {
-    unsigned long int i;
+/*
+	Free space of the transmit ring. One slot stays unused so a full ring
+	cannot be mistaken for an empty one. The interrupt only advances the
+	tail, so the result can only grow till the bytes are queued
+*/
+static uint8_t i2cTransmitFree() {
+	uint8_t bTail = i2cBufferTX_Tail;
+	uint8_t bHead = i2cBufferTX_Head;
+	uint8_t bUsed = (bTail <= bHead) ? (bHead - bTail) : (I2C_BUFFER_SIZE_TX - bTail + bHead);
+
+	return (I2C_BUFFER_SIZE_TX - 1) - bUsed;
+}
 
-    if(lpMessage == 0) { return; }
-    if(dwLength == 0) { return; }
+static bool i2cTransmitReserve(unsigned long int dwLength) {
+	if(dwLength > i2cTransmitFree()) {
+		/* Queueing anyway would overwrite unread bytes and corrupt both frames */
+		i2cTxDropped = true;
+		telemetryCounters.dwTxRejected = telemetryCounters.dwTxRejected + 1;
+		return false;
+	}
+	return true;
+}
+
+bool i2cTransmitBytes(
+	uint8_t* lpMessage,
+	unsigned long int dwLength
+) {
+	unsigned long int i;
 
-    /*
-        Check capacity
-    */
-    unsigned long int dwBufferedBytes = (i2cBufferTX_Tail <= i2cBufferTX_Head) ? (i2cBufferTX_Head - i2cBufferTX_Tail) : (I2C_BUFFER_SIZE_TX - i2cBufferTX_Tail + i2cBufferTX_Head);
-    unsigned long int dwCapacity = I2C_BUFFER_SIZE_TX - dwBufferedBytes;
+	if(lpMessage == 0) { return false; }
+	if(dwLength == 0) { return true; }
 
-    if(dwLength > dwCapacity) { return; }
+	if(!i2cTransmitReserve(dwLength)) { return false; }
 
-    for(i = 0; i < dwLength; i=i+1) {
-        i2cBufferTX[i2cBufferTX_Head] = lpMessage[i];
-        i2cBufferTX_Head = (i2cBufferTX_Head + 1) % I2C_BUFFER_SIZE_TX;
-    }
+	for(i = 0; i < dwLength; i=i+1) {
+		i2cBufferTX[i2cBufferTX_Head] = lpMessage[i];
+		i2cBufferTX_Head = (i2cBufferTX_Head + 1) % I2C_BUFFER_SIZE_TX;
+	}
 
-    return;
+	return true;
 }
 
-void i2cTransmitPacket(
+bool i2cTransmitPacket(
 	uint8_t* lpPacket,
 	uint8_t bOpCode,
 	unsigned long int dwPayloadLength
@@ -244,6 +496,9 @@ void i2cTransmitPacket(
 	unsigned long int i;
 	uint8_t bChecksum = 0x00;
 
+	/* Sync pattern, opcode, length, payload and checksum */
+	if(!i2cTransmitReserve(dwPayloadLength + 7)) { return false; }
+
 	i2cBufferTX[ i2cBufferTX_Head                        ] = 0xAA;
 	i2cBufferTX[(i2cBufferTX_Head+1) % I2C_BUFFER_SIZE_TX] = 0x55;
 	i2cBufferTX[(i2cBufferTX_Head+2) % I2C_BUFFER_SIZE_TX] = 0xAA;
@@ -263,13 +518,16 @@ void i2cTransmitPacket(
 
 	i2cBufferTX_Head = (i2cBufferTX_Head+6+i+1) % I2C_BUFFER_SIZE_TX;
 
-	return;
+	return true;
 }
 
-void i2cQueuePreamble() {
+bool i2cQueuePreamble() {
+	if(!i2cTransmitReserve(4)) { return false; }
+
 	i2cBufferTX[ i2cBufferTX_Head                        ] = 0xAA;
 	i2cBufferTX[(i2cBufferTX_Head+1) % I2C_BUFFER_SIZE_TX] = 0x55;
 	i2cBufferTX[(i2cBufferTX_Head+2) % I2C_BUFFER_SIZE_TX] = 0xAA;
 	i2cBufferTX[(i2cBufferTX_Head+3) % I2C_BUFFER_SIZE_TX] = 0x55;
 	i2cBufferTX_Head = (i2cBufferTX_Head + 4) % I2C_BUFFER_SIZE_TX;
+	return true;
 }
@@ -1,14 +1,82 @@
 #ifndef I2C_BUFFER_SIZE_RX
-	#define I2C_BUFFER_SIZE_RX 64
+	#define I2C_BUFFER_SIZE_RX 60			/* Size of one received frame slot (opcode, length and payload) */
+#endif
+#ifndef I2C_FRAME_SLOTS
+	#define I2C_FRAME_SLOTS 2
 #endif
 #ifndef I2C_BUFFER_SIZE_TX
 	#define I2C_BUFFER_SIZE_TX 64
 #endif
+#if I2C_BUFFER_SIZE_TX > 255
+	#error I2C_BUFFER_SIZE_TX has to fit the 8 bit ring indices
+#endif
+
+/*
+	Bus speed. The TWI slave follows the clock of the master (the bit rate
+	register is only used in master mode), standard (100 kHz) and fast mode
+	(400 kHz) are both supported. Fast mode requires the CPU clock to be at
+	least 16 times the SCL frequency. At 400 kHz a byte takes 9 SCL periods
+	or 360 CPU cycles at 16 MHz - if the interrupt is served later (e.g.
+	while the ADC interrupt is running) the TWI holds SCL low until it has
+	been handled, so the bus slows down but no data is lost.
+*/
+#define I2C_SCL_MAX								400000UL
 
 #ifndef PIEZO_I2C_ADDRESS
 	#define PIEZO_I2C_ADDRESS 0x11
 #endif
 
+/*
+	Register map read mode
+
+	A write of the single byte I2C_REGISTER_SELECT | n while no packet is
+	being received selects byte n of the register map. Every following
+	read transaction (usually issued with a repeated start) returns the
+	map starting at that byte. The map is a snapshot refreshed by the main
+	loop once per millisecond and served directly by the interrupt, so no
+	packet has to be queued. Reads beyond the map return 0x00. The next
+	write transaction returns to packet mode.
+*/
+#define I2C_REGISTER_SELECT						0x80
+#define I2C_REGISTER_SELECT_MASK				0xE0
+#define I2C_REGISTER_MAP_SIZE					32
+
+enum i2cRegister {
+	i2cReg_Status								= 0x00,		/* I2C_REGSTATUS__ flags */
+	i2cReg_TriggerMode							= 0x01,
+	i2cReg_Sequence								= 0x02,		/* Incremented with every snapshot */
+	i2cReg_ActiveChannels						= 0x03,
+	i2cReg_RawValues							= 0x04,		/* 4 x 16 bit, like i2cCmd_ReadCurrentValues */
+	i2cReg_Averages								= 0x0C,		/* 4 x 16 bit, like i2cCmd_ReadCurrentAverages */
+	i2cReg_Triggers								= 0x14,		/* 32 bit, output assertions of all trigger modes */
+	i2cReg_Millis								= 0x18,		/* 32 bit, uptime when the snapshot has been taken */
+	i2cReg_ChecksumErrors						= 0x1C,		/* 16 bit, lower half of the telemetry counter */
+	i2cReg_RxOverflows							= 0x1E,		/* 16 bit, lower half of the telemetry counter */
+};
+
+/*
+	Ready status - a write of the single byte I2C_READY_SELECT selects two
+	bytes evaluated live by the interrupt on every read: I2C_READY__ flags
+	and the number of bytes queued in the transmit ring. Lets the host poll
+	for the completion of a command instead of sleeping
+*/
+#define I2C_READY_SELECT						0xC0
+
+/*
+	Stream mode - a write of the single byte I2C_STREAM_SELECT selects the
+	sample stream (see stream.h) for all following reads
+*/
+#define I2C_STREAM_SELECT						0xC1
+
+#define I2C_READY__BUSY							0x01		/* A received command has not been handled yet */
+#define I2C_READY__RESPONSE						0x02		/* The transmit ring holds data */
+#define I2C_READY__DROPPED						0x04		/* A response did not fit the transmit ring and has been discarded (cleared by this read) */
+
+#define I2C_REGSTATUS__CALIBRATING				0x01		/* Centerline calibration running */
+#define I2C_REGSTATUS__OUTPUT					0x02		/* Trigger output asserted */
+#define I2C_REGSTATUS__STOREBUSY				0x04		/* Settings are being written to EEPROM */
+#define I2C_REGSTATUS__CAPTUREFROZEN			0x08		/* Capture window complete */
+
 #ifdef __cplusplus
     extern "C" {
 #endif
@@ -32,6 +100,59 @@ enum i2cCommand {
 
 	i2cCmd_GetAlphaValue						= 11,
 	i2cCmd_SetAlphaValue						= 12,
+
+	i2cCmd_GetFilterMode						= 13,
+	i2cCmd_SetFilterMode						= 14,
+
+	i2cCmd_GetDetectorMode						= 15,
+	i2cCmd_SetDetectorMode						= 16,
+
+	i2cCmd_GetTriggerLatency					= 17,
+
+	i2cCmd_GetSampling							= 18,
+	i2cCmd_SetSampling							= 19,
+
+	i2cCmd_GetActiveChannels					= 20,
+	i2cCmd_SetActiveChannels					= 21,
+
+	i2cCmd_GetBiquad							= 22,
+	i2cCmd_SetBiquad							= 23,
+
+	i2cCmd_GetThresholdMode						= 24,
+	i2cCmd_SetThresholdMode						= 25,
+	i2cCmd_GetNoiseStatistics					= 26,
+
+	i2cCmd_GetBaselineTracking					= 27,
+	i2cCmd_SetBaselineTracking					= 28,
+
+	i2cCmd_ReadEvent							= 29,
+	i2cCmd_ClearEvents							= 30,
+
+	i2cCmd_GetCaptureStatus						= 31,
+	i2cCmd_SetCaptureConfig						= 32,
+	i2cCmd_ArmCapture							= 33,
+	i2cCmd_ReadCapture							= 34,
+
+	i2cCmd_GetTelemetry							= 35,
+	i2cCmd_ResetTelemetry						= 36,
+
+	i2cCmd_GetProfile							= 37,		/* Only available in builds with PIEZO_PROFILER */
+	i2cCmd_ResetProfile							= 38,
+
+	i2cCmd_GetQualifier							= 39,
+	i2cCmd_SetQualifier							= 40,
+
+	i2cCmd_GetStoreStatus						= 41,
+
+	i2cCmd_GetTuningProfiles					= 42,
+	i2cCmd_SaveTuningProfile					= 43,
+	i2cCmd_ActivateTuningProfile				= 44,
+
+	i2cCmd_GetSettings							= 45,
+	i2cCmd_SetSettings							= 46,
+
+	i2cCmd_SetStream							= 47,
+	i2cCmd_GetStreamStatus						= 48,
 };
 
 /*@
@@ -45,18 +166,36 @@ void i2cSlaveInit(
 	uint8_t address
 );
 
-void i2cTransmitBytes(
+/*
+	Queue data into the transmit ring. Nothing is queued if the data does
+	not fit the free space (I2C_BUFFER_SIZE_TX-1 bytes minus the bytes the
+	host has not read yet) - the functions return false in this case and
+	the host learns about it from I2C_READY__DROPPED
+*/
+bool i2cTransmitBytes(
 	uint8_t* lpMessage,
 	unsigned long int dwLength
 );
 
-void i2cTransmitPacket(
+bool i2cTransmitPacket(
 	uint8_t* lpPacket,
 	uint8_t bOpCode,
 	unsigned long int dwPayloadLength
 );
 
-void i2cQueuePreamble();
+bool i2cQueuePreamble();
+
+/*
+	Publishes a new register map snapshot (I2C_REGISTER_MAP_SIZE bytes).
+	Returns false if the interrupt is still reading the buffer the
+	snapshot would go to - try again on the next pass in this case
+*/
+/*@
+	requires \valid_read(lpSnapshot + (0 .. I2C_REGISTER_MAP_SIZE-1));
+*/
+bool i2cRegisterPublish(
+	uint8_t* lpSnapshot
+);
 
 void i2cMessageLoop();
 
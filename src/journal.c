@@ -0,0 +1,464 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+#include <stdint.h>
+
+#include "./main.h"
+#include "./journal.h"
+
+/*
+	EEPROM settings journal (see journal.h for the layout)
+
+	journalShadow mirrors what a boot would load once the running session
+	has been committed, journalPending is the snapshot taken by the last
+	store. The writer compares both byte by byte and appends a record for
+	every difference.
+
+	Profiles are written from their own image (journalProfileImage). A
+	store or profile save issued while the other one is being written is
+	queued and picked up by journalTask once the running phase finished,
+	so none of the entry points ever waits for the EEPROM.
+*/
+
+enum journalPhase {
+	journalPhase_Idle						= 0x00,
+	journalPhase_Records					= 0x01,		/* Appending records, a commit record finishes the session */
+	journalPhase_Compact					= 0x02,		/* Writing the full image into the other base slot */
+	journalPhase_Profile					= 0x03,		/* Writing a profile slot */
+};
+
+static uint8_t journalShadow[sizeof(struct eepromSettings)];
+static uint8_t journalPending[sizeof(struct eepromSettings)];
+static uint8_t journalProfileImage[sizeof(struct eepromSettings)];
+
+static enum journalPhase journalPhase;
+static bool journalBaseValid;
+static uint8_t journalBaseSlot;
+static uint16_t journalGeneration;				/* Generation of the active base slot */
+static uint16_t journalCommitted;				/* Records up to and including the last commit */
+static uint16_t journalWritePos;				/* Next record to be written */
+
+static bool journalStoreQueued;					/* journalPending waits for a running profile write */
+static uint8_t journalProfileSlot;				/* Target of journalPhase_Profile */
+static uint8_t journalProfileQueued;			/* Profile waiting for a running store, JOURNAL_PROFILE_NONE if none */
+
+#define JOURNAL_PROFILE_NONE					0xFF
+
+static unsigned long int journalScan;			/* Next image byte to compare (records) or write (compaction, profile) */
+static uint8_t journalRecord[JOURNAL_RECORD_SIZE];
+static uint8_t journalRecordByte;				/* Bytes of journalRecord already written, 0 if no record is in flight */
+
+#define journalSlotAddress(slot)				(JOURNAL_EEPROM_START + (unsigned long int)(slot)*JOURNAL_SLOT_SIZE)
+#define journalRecordAddress(idx)				(JOURNAL_RECORD_START + (unsigned long int)(idx)*JOURNAL_RECORD_SIZE)
+#define journalProfileAddress(idx)				(JOURNAL_PROFILE_START + (unsigned long int)(idx)*sizeof(struct eepromSettings))
+
+static uint8_t journalRecordCheck(
+	uint16_t generation,
+	uint8_t bOffset,
+	uint8_t bValue
+) {
+	uint8_t crc = 0;
+
+	crc = _crc8_ccitt_update(crc, (uint8_t)(generation & 0xFF));
+	crc = _crc8_ccitt_update(crc, (uint8_t)(generation >> 8));
+	crc = _crc8_ccitt_update(crc, bOffset);
+	crc = _crc8_ccitt_update(crc, bValue);
+
+	return crc;
+}
+
+static bool journalImageValid(uint8_t* lpImage) {
+	unsigned long int i;
+	uint8_t chkSum;
+
+	chkSum = 0;
+	for(i = 0; i < sizeof(struct eepromSettings)-2; i=i+1) {
+		chkSum = chkSum ^ lpImage[i];
+	}
+
+	return ((chkSum == lpImage[sizeof(struct eepromSettings)-2]) && ((chkSum ^ 0xFF) == lpImage[sizeof(struct eepromSettings)-1])) ? true : false;
+}
+
+static bool journalReadRecord(
+	unsigned long int dwIndex,
+	uint8_t* lpOffset,
+	uint8_t* lpValue
+) {
+	uint8_t bRecord[JOURNAL_RECORD_SIZE];
+
+	eeprom_read_block(bRecord, (const void*)journalRecordAddress(dwIndex), JOURNAL_RECORD_SIZE);
+
+	if(bRecord[0] != (uint8_t)(journalGeneration & 0xFF)) {
+		return false; /* Left over from an older generation (or never written) */
+	}
+	if(bRecord[3] != journalRecordCheck(journalGeneration, bRecord[1], bRecord[2])) {
+		return false; /* Torn write */
+	}
+	if((bRecord[1] != JOURNAL_OFFSET_COMMIT) && (bRecord[1] >= sizeof(struct eepromSettings))) {
+		return false;
+	}
+
+	(*lpOffset) = bRecord[1];
+	(*lpValue) = bRecord[2];
+	return true;
+}
+
+bool journalLoad(struct eepromSettings* lpSettings) {
+	unsigned long int i;
+	uint8_t slot;
+	uint16_t generation;
+	uint8_t bOffset;
+	uint8_t bValue;
+	uint8_t* lpImage = (uint8_t*)lpSettings;
+
+	journalPhase = journalPhase_Idle;
+	journalRecordByte = 0;
+	journalBaseValid = false;
+	journalStoreQueued = false;
+	journalProfileQueued = JOURNAL_PROFILE_NONE;
+
+	/* Newest base slot with a valid image (generations compared with wrap around) */
+	for(slot = 0; slot < 2; slot=slot+1) {
+		eeprom_read_block(journalShadow, (const void*)journalSlotAddress(slot), sizeof(struct eepromSettings));
+		if(!journalImageValid(journalShadow)) {
+			continue;
+		}
+
+		generation = eeprom_read_word((const uint16_t*)(journalSlotAddress(slot) + sizeof(struct eepromSettings)));
+		if((!journalBaseValid) || (((int16_t)(generation - journalGeneration)) > 0)) {
+			journalBaseValid = true;
+			journalBaseSlot = slot;
+			journalGeneration = generation;
+		}
+	}
+
+	if(!journalBaseValid) {
+		/* The first store compacts into slot 0 with generation 0 */
+		journalBaseSlot = 1;
+		journalGeneration = 0xFFFF;
+		journalCommitted = 0;
+		journalWritePos = 0;
+		return false;
+	}
+
+	eeprom_read_block(journalShadow, (const void*)journalSlotAddress(journalBaseSlot), sizeof(struct eepromSettings));
+
+	/* Locate the last commit - records of an interrupted session behind it are ignored */
+	journalCommitted = 0;
+	for(i = 0; i < JOURNAL_RECORDS; i=i+1) {
+		if(!journalReadRecord(i, &bOffset, &bValue)) {
+			break;
+		}
+		if(bOffset == JOURNAL_OFFSET_COMMIT) {
+			journalCommitted = i + 1;
+		}
+	}
+
+	/* Replay */
+	for(i = 0; i < sizeof(struct eepromSettings); i=i+1) {
+		lpImage[i] = journalShadow[i];
+	}
+	for(i = 0; i < journalCommitted; i=i+1) {
+		journalReadRecord(i, &bOffset, &bValue);
+		if(bOffset != JOURNAL_OFFSET_COMMIT) {
+			lpImage[bOffset] = bValue;
+		}
+	}
+
+	if(journalImageValid(lpImage)) {
+		for(i = 0; i < sizeof(struct eepromSettings); i=i+1) {
+			journalShadow[i] = lpImage[i];
+		}
+		journalWritePos = journalCommitted;
+	} else {
+		/* Journal is inconsistent, fall back to the base image and compact on the next store */
+		for(i = 0; i < sizeof(struct eepromSettings); i=i+1) {
+			lpImage[i] = journalShadow[i];
+		}
+		journalCommitted = JOURNAL_RECORDS;
+		journalWritePos = JOURNAL_RECORDS;
+	}
+
+	return true;
+}
+
+/*
+	Starts the next queued store or profile write - only while idle
+*/
+static void journalStartQueued() {
+	if(journalStoreQueued) {
+		journalStoreQueued = false;
+		journalScan = 0;
+		journalPhase = (journalBaseValid) ? journalPhase_Records : journalPhase_Compact;
+	} else if(journalProfileQueued != JOURNAL_PROFILE_NONE) {
+		journalProfileSlot = journalProfileQueued;
+		journalProfileQueued = JOURNAL_PROFILE_NONE;
+		journalScan = 0;
+		journalPhase = journalPhase_Profile;
+	}
+}
+
+void journalStore(struct eepromSettings* lpSettings) {
+	unsigned long int i;
+
+	for(i = 0; i < sizeof(struct eepromSettings); i=i+1) {
+		journalPending[i] = ((uint8_t*)lpSettings)[i];
+	}
+
+	if(journalPhase == journalPhase_Profile) {
+		/* journalScan belongs to the profile write, the store follows it */
+		journalStoreQueued = true;
+		return;
+	}
+
+	/* Restart the comparison, records already written are contained in the shadow */
+	journalScan = 0;
+	if(journalPhase == journalPhase_Idle) {
+		journalPhase = (journalBaseValid) ? journalPhase_Records : journalPhase_Compact;
+	}
+}
+
+static void journalTask_Records() {
+	if(journalRecordByte == 0) {
+		/* Find the next difference */
+		while((journalScan < sizeof(struct eepromSettings)) && (journalPending[journalScan] == journalShadow[journalScan])) {
+			journalScan = journalScan + 1;
+		}
+
+		if(journalScan < sizeof(struct eepromSettings)) {
+			if(journalWritePos + 2 > JOURNAL_RECORDS) {
+				/* No space left for this record and the commit */
+				journalScan = 0;
+				journalPhase = journalPhase_Compact;
+				return;
+			}
+			journalRecord[1] = (uint8_t)journalScan;
+			journalRecord[2] = journalPending[journalScan];
+			journalScan = journalScan + 1;
+		} else if(journalWritePos != journalCommitted) {
+			journalRecord[1] = JOURNAL_OFFSET_COMMIT;
+			journalRecord[2] = 0x00;
+		} else {
+			/* Nothing changed */
+			journalPhase = journalPhase_Idle;
+			return;
+		}
+		journalRecord[0] = (uint8_t)(journalGeneration & 0xFF);
+		journalRecord[3] = journalRecordCheck(journalGeneration, journalRecord[1], journalRecord[2]);
+	}
+
+	eeprom_write_byte((uint8_t*)(journalRecordAddress(journalWritePos) + journalRecordByte), journalRecord[journalRecordByte]);
+	journalRecordByte = journalRecordByte + 1;
+	if(journalRecordByte < JOURNAL_RECORD_SIZE) {
+		return;
+	}
+
+	/* Record complete */
+	journalRecordByte = 0;
+	journalWritePos = journalWritePos + 1;
+	if(journalRecord[1] == JOURNAL_OFFSET_COMMIT) {
+		journalCommitted = journalWritePos;
+		journalPhase = journalPhase_Idle;
+	} else {
+		journalShadow[journalRecord[1]] = journalRecord[2];
+	}
+}
+
+static void journalTask_Compact() {
+	unsigned long int i;
+	unsigned long int dwSlot = journalSlotAddress(journalBaseSlot ^ 0x01);
+	uint16_t nextGeneration = journalGeneration + 1;
+
+	/*
+		Image first, generation last (low byte first) so an interrupted
+		compaction never looks newer than the slot it replaces
+	*/
+	if(journalScan < sizeof(struct eepromSettings)) {
+		eeprom_update_byte((uint8_t*)(dwSlot + journalScan), journalPending[journalScan]);
+		journalScan = journalScan + 1;
+		return;
+	}
+	if(journalScan == sizeof(struct eepromSettings)) {
+		eeprom_update_byte((uint8_t*)(dwSlot + journalScan), (uint8_t)(nextGeneration & 0xFF));
+		journalScan = journalScan + 1;
+		return;
+	}
+	eeprom_update_byte((uint8_t*)(dwSlot + journalScan), (uint8_t)(nextGeneration >> 8));
+
+	/* New base, the journal starts over */
+	journalBaseSlot = journalBaseSlot ^ 0x01;
+	journalGeneration = nextGeneration;
+	journalBaseValid = true;
+	journalCommitted = 0;
+	journalWritePos = 0;
+	for(i = 0; i < sizeof(struct eepromSettings); i=i+1) {
+		journalShadow[i] = journalPending[i];
+	}
+	journalPhase = journalPhase_Idle;
+}
+
+static void journalTask_Profile() {
+	eeprom_update_byte((uint8_t*)(journalProfileAddress(journalProfileSlot) + journalScan), journalProfileImage[journalScan]);
+	journalScan = journalScan + 1;
+	if(journalScan == sizeof(struct eepromSettings)) {
+		journalPhase = journalPhase_Idle;
+	}
+}
+
+void journalTask() {
+	if(journalPhase == journalPhase_Idle) {
+		journalStartQueued();
+		if(journalPhase == journalPhase_Idle) {
+			return;
+		}
+	}
+	if(!eeprom_is_ready()) {
+		return; /* Previous byte still being programmed */
+	}
+
+	switch(journalPhase) {
+		case journalPhase_Records:		journalTask_Records(); break;
+		case journalPhase_Compact:		journalTask_Compact(); break;
+		case journalPhase_Profile:		journalTask_Profile(); break;
+		default:						break;
+	}
+}
+
+bool journalProfileSave(
+	uint8_t bProfile,
+	struct eepromSettings* lpSettings
+) {
+	unsigned long int i;
+
+	if(bProfile >= JOURNAL_PROFILES) {
+		return false;
+	}
+
+	/*
+		The image of a running profile write cannot be replaced by one for
+		another slot - that slot would be left half written
+	*/
+	if((journalPhase == journalPhase_Profile) && (journalProfileSlot != bProfile)) {
+		return false;
+	}
+
+	for(i = 0; i < sizeof(struct eepromSettings); i=i+1) {
+		journalProfileImage[i] = ((uint8_t*)lpSettings)[i];
+	}
+
+	if(journalPhase == journalPhase_Profile) {
+		/* Same slot - start over with the new image */
+		journalScan = 0;
+		return true;
+	}
+
+	/* Replaces a profile that is still queued, nothing of it has been written yet */
+	journalProfileQueued = bProfile;
+	if(journalPhase == journalPhase_Idle) {
+		journalStartQueued();
+	}
+	return true;
+}
+
+/*
+	A profile that is queued or being written is only complete in RAM
+*/
+static bool journalProfileInRAM(uint8_t bProfile) {
+	if((journalPhase == journalPhase_Profile) && (journalProfileSlot == bProfile)) {
+		return true;
+	}
+	return (journalProfileQueued == bProfile) ? true : false;
+}
+
+static bool journalProfileCheck(uint8_t bProfile) {
+	unsigned long int i;
+	uint8_t chkSum = 0;
+	const uint8_t* lpSlot = (const uint8_t*)journalProfileAddress(bProfile);
+
+	for(i = 0; i < sizeof(struct eepromSettings)-2; i=i+1) {
+		chkSum = chkSum ^ eeprom_read_byte(&(lpSlot[i]));
+	}
+
+	return ((chkSum == eeprom_read_byte(&(lpSlot[sizeof(struct eepromSettings)-2]))) && ((chkSum ^ 0xFF) == eeprom_read_byte(&(lpSlot[sizeof(struct eepromSettings)-1])))) ? true : false;
+}
+
+bool journalProfileLoad(
+	uint8_t bProfile,
+	struct eepromSettings* lpSettings
+) {
+	const struct eepromSettings* lpSlot = (const struct eepromSettings*)journalProfileAddress(bProfile);
+	enum triggerMode trigMode;
+	uint16_t debounceLength;
+	bool bInRAM;
+
+	if(bProfile >= JOURNAL_PROFILES) {
+		return false;
+	}
+
+	/*
+		Verified in place, a copy of the image would cost 78 bytes of stack
+		below the I2C handler. Profile slots are only written by journalTask
+		which runs in the same main loop, so the slot cannot change till it
+		has been copied
+	*/
+	bInRAM = journalProfileInRAM(bProfile);
+	if(!(bInRAM ? journalImageValid(journalProfileImage) : journalProfileCheck(bProfile))) {
+		return false;
+	}
+
+	if(bInRAM) {
+		trigMode = ((struct eepromSettings*)journalProfileImage)->trigMode;
+		debounceLength = ((struct eepromSettings*)journalProfileImage)->debounceLength;
+	} else {
+		eeprom_read_block(&trigMode, (const void*)&(lpSlot->trigMode), sizeof(trigMode));
+		debounceLength = eeprom_read_word(&(lpSlot->debounceLength));
+	}
+
+	/* Trigger mode and debounce length are read directly by the trigger interrupts */
+	{
+		uint8_t sregOld = SREG;
+		#ifndef FRAMAC_SKIP
+			cli();
+		#endif
+
+		lpSettings->trigMode = trigMode;
+		lpSettings->debounceLength = debounceLength;
+
+		SREG = sregOld;
+	}
+
+	/* Rewrites the two fields above with identical bytes, nothing the interrupts could see torn */
+	if(bInRAM) {
+		(*lpSettings) = *((struct eepromSettings*)journalProfileImage);
+	} else {
+		eeprom_read_block(lpSettings, (const void*)lpSlot, sizeof(struct eepromSettings));
+	}
+	return true;
+}
+
+uint8_t journalProfilesValid() {
+	uint8_t i;
+	uint8_t bMask = 0;
+
+	for(i = 0; i < JOURNAL_PROFILES; i=i+1) {
+		if(journalProfileInRAM(i) ? journalImageValid(journalProfileImage) : journalProfileCheck(i)) {
+			bMask = bMask | (1 << i);
+		}
+	}
+	return bMask;
+}
+
+enum journalState journalStatus(
+	uint16_t* lpGeneration,
+	uint16_t* lpRecordsUsed
+) {
+	(*lpGeneration) = journalGeneration;
+	(*lpRecordsUsed) = journalWritePos;
+
+	if(journalStoreQueued || (journalProfileQueued != JOURNAL_PROFILE_NONE)) {
+		return journalState_Busy;
+	}
+	return (journalPhase == journalPhase_Idle) ? journalState_Idle : journalState_Busy;
+}
@@ -0,0 +1,133 @@
+#ifndef __is_included__e81a5c3e_cb12_11f1_a6d4_02fc00000001
+#define __is_included__e81a5c3e_cb12_11f1_a6d4_02fc00000001 1
+
+/*
+	Settings journal
+
+	Settings are not rewritten as a whole block any more. The EEPROM holds
+	two base slots with a full settings image and a 16 bit generation each
+	and behind them a journal of 4 byte records:
+
+		[generation low byte] [offset] [value] [check]
+
+	A store only appends records for the bytes that differ from the
+	persisted image, followed by a commit record (offset JOURNAL_OFFSET_COMMIT).
+	On boot the newest valid base slot is loaded and all records up to the
+	last commit belonging to its generation are replayed. When the journal
+	runs full the image is compacted into the other base slot with the next
+	generation and the journal starts over at its first record. Each record
+	position is thus written once per generation and the base slots alternate
+	which spreads wear over the whole EEPROM.
+
+	Behind the journal JOURNAL_PROFILES tuning profiles are kept. Each one
+	is a complete settings image including its checksum that is written in
+	place (only differing bytes) and loaded on demand.
+
+	Writing happens from the main loop, one byte whenever the EEPROM is
+	ready, so a store never blocks I2C processing. The host polls
+	journalStatus (i2cCmd_GetStoreStatus) to learn when it is done.
+
+	Requires main.h to be included before.
+*/
+
+#ifndef JOURNAL_EEPROM_START
+	#define JOURNAL_EEPROM_START				0
+#endif
+#ifndef JOURNAL_EEPROM_END
+	#define JOURNAL_EEPROM_END					(E2END+1)
+#endif
+#ifndef JOURNAL_PROFILES
+	#define JOURNAL_PROFILES					4
+#endif
+
+#define JOURNAL_SLOT_SIZE						(sizeof(struct eepromSettings)+2)		/* Image followed by the generation */
+#define JOURNAL_PROFILE_START					(JOURNAL_EEPROM_END - JOURNAL_PROFILES*sizeof(struct eepromSettings))
+#define JOURNAL_RECORD_START					(JOURNAL_EEPROM_START + 2*JOURNAL_SLOT_SIZE)
+#define JOURNAL_RECORD_SIZE						4
+#define JOURNAL_RECORDS							((JOURNAL_PROFILE_START - JOURNAL_RECORD_START) / JOURNAL_RECORD_SIZE)
+
+#define JOURNAL_OFFSET_COMMIT					0xFE		/* Offset used by commit records, settings have to stay smaller */
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+enum journalState {
+	journalState_Idle						= 0x00,		/* The last stored settings are persisted */
+	journalState_Busy						= 0x01,		/* Records or a compacted image are being written */
+};
+
+/*
+	Loads the newest persisted settings into lpSettings. Returns false if
+	no valid image has been found, the contents of lpSettings are undefined
+	in this case and the next journalStore writes a fresh base slot.
+*/
+/*@
+	requires \valid(lpSettings);
+	assigns *lpSettings;
+*/
+bool journalLoad(struct eepromSettings* lpSettings);
+
+/*
+	Takes a snapshot of lpSettings (including its checksum) to be persisted.
+	A store issued while another one is still in progress replaces the
+	pending snapshot, one issued during a profile write follows it.
+*/
+/*@
+	requires \valid(lpSettings);
+*/
+void journalStore(struct eepromSettings* lpSettings);
+
+/*
+	Writes lpSettings (including its checksum) into profile slot bProfile
+	in the background like a store, queued behind a running store. Returns
+	false if a different profile slot is still being written.
+*/
+/*@
+	requires bProfile < JOURNAL_PROFILES;
+	requires \valid(lpSettings);
+*/
+bool journalProfileSave(
+	uint8_t bProfile,
+	struct eepromSettings* lpSettings
+);
+
+/*
+	Loads profile slot bProfile into lpSettings. Returns false and leaves
+	lpSettings untouched if the slot does not hold a valid image. A profile
+	that has not been written completely yet is served from RAM.
+*/
+/*@
+	requires bProfile < JOURNAL_PROFILES;
+	requires \valid(lpSettings);
+	assigns *lpSettings;
+*/
+bool journalProfileLoad(
+	uint8_t bProfile,
+	struct eepromSettings* lpSettings
+);
+
+/*
+	Bitmask of profile slots holding a valid image
+*/
+uint8_t journalProfilesValid();
+
+/*
+	Writes at most one byte - called from the main loop
+*/
+void journalTask();
+
+/*@
+	requires \valid(lpGeneration) && \valid(lpRecordsUsed);
+	assigns *lpGeneration, *lpRecordsUsed;
+*/
+enum journalState journalStatus(
+	uint16_t* lpGeneration,
+	uint16_t* lpRecordsUsed
+);
+
+#ifdef __cplusplus
+	} /* extern "C" { */
+#endif
+
+#endif
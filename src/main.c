@@ -7,9 +7,31 @@
 #include <stdint.h>
 
 #include "./main.h"
+#include "./biquad.h"
 #include "./sysclk.h"
 #include "./i2c.h"
 #include "./adc.h"
+#include "./telemetry.h"
+#include "./trigger.h"
+#include "./eventlog.h"
+#include "./capture.h"
+#include "./stream.h"
+#include "./profiler.h"
+#include "./journal.h"
+
+/*
+	The largest fixed size responses have to fit the empty transmit ring
+	(payload plus 7 bytes for sync pattern, opcode, length and checksum)
+*/
+#if (3+CAPTURE_CHUNK_MAX*2+7) > (I2C_BUFFER_SIZE_TX-1)
+	#error Capture chunk does not fit the transmit ring
+#endif
+#if (SETTINGS_BLOCK_SIZE+7) > (I2C_BUFFER_SIZE_TX-1)
+	#error Settings block does not fit the transmit ring
+#endif
+#if (1+TELEMETRY_COUNTERS*4+7) > (I2C_BUFFER_SIZE_TX-1)
+	#error Telemetry counters do not fit the transmit ring
+#endif
 
 /*
 	Pin mapping
@@ -30,17 +52,33 @@
 
 
 
-#ifndef SETTINGS_EEPROM_LOCATION
-	#define SETTINGS_EEPROM_LOCATION 0
-#endif
-
 struct eepromSettings currentSettings;
-static uint32_t debounceCounter;
-static unsigned long int debounceStart;
+static uint8_t activeTuningProfile = TUNINGPROFILE_NONE;		/* Last saved or activated tuning profile */
 
-static void eepromSave() {
+/*
+	Prepares currentSettings to be written as a whole image (settings
+	journal or tuning profile)
+*/
+static void eepromSnapshot() {
 	unsigned long int i;
 	uint8_t chkSum;
+	int16_t centerline[4];
+	uint16_t noiseSigma[4];
+	uint8_t bActiveChannels;
+
+	/*
+		Take over the live calibration. While a calibration (or the
+		verification of a restored one) is running the previous block is
+		kept - it is verified against the live signal before use anyways
+	*/
+	if(adcCalibrationRead(centerline, noiseSigma, &bActiveChannels)) {
+		for(i = 0; i < 4; i=i+1) {
+			currentSettings.calibration.centerline[i] = centerline[i];
+			currentSettings.calibration.noiseSigma[i] = noiseSigma[i];
+		}
+		currentSettings.calibration.bActiveChannels = bActiveChannels;
+		currentSettings.calibration.bValid = SETTINGS_CALIBRATION_VALID;
+	}
 
 	chkSum = 0;
 	for(i = 0; i < sizeof(struct eepromSettings)-2; i=i+1) {
@@ -49,41 +87,146 @@ static void eepromSave() {
 
 	currentSettings.xorChecksum = chkSum;
 	currentSettings.negChecksum = (chkSum ^ 0xFF);
+}
 
-	eeprom_write_block(&currentSettings, SETTINGS_EEPROM_LOCATION, sizeof(struct eepromSettings));
+static void eepromSave() {
+	eepromSnapshot();
+
+	/* Written in the background by journalTask, only changed bytes are touched */
+	journalStore(&currentSettings);
 }
 
 static void eepromDefaults() {
+	unsigned long int i;
+
 	currentSettings.trigMode 							= PIEZOBOARD_DEFAULT__TRIGGERMODE;
 	currentSettings.movingAverage.thresholdFactor 		= PIEZOBOARD_DEFAULT__THRESHOLD;
 	currentSettings.movingAverage.dMovingAverageAlpha 	= PIEZOBOARD_DEFAULT__MOVINGAVERAGEALPHA;
 	currentSettings.movingAverage.dwInitSamples 		= PIEZOBOARD_DEFAULT__INITSAMPLES;
 	currentSettings.debounceLength 						= PIEZOBOARD_DEFAULT__DEBOUNCELENGTH;
+	currentSettings.filter.bFilterMode					= PIEZOBOARD_DEFAULT__FILTERMODE;
+	currentSettings.filter.bMedianWindow				= PIEZOBOARD_DEFAULT__MEDIANWINDOW;
+	currentSettings.detector.bDetectorMode				= PIEZOBOARD_DEFAULT__DETECTORMODE;
+	currentSettings.detector.bSlopeDistance				= PIEZOBOARD_DEFAULT__SLOPEDISTANCE;
+	currentSettings.detector.slopeThreshold				= PIEZOBOARD_DEFAULT__SLOPETHRESHOLD;
+	currentSettings.sampling.sampleRate					= PIEZOBOARD_DEFAULT__SAMPLERATE;
+	currentSettings.sampling.bPrescaler					= PIEZOBOARD_DEFAULT__ADCPRESCALER;
+	currentSettings.sampling.bFlags						= PIEZOBOARD_DEFAULT__SAMPLINGFLAGS;
+	currentSettings.sampling.bActiveChannels			= PIEZOBOARD_DEFAULT__ACTIVECHANNELS;
+	currentSettings.threshold.bThresholdMode			= PIEZOBOARD_DEFAULT__THRESHOLDMODE;
+	currentSettings.threshold.bSigmaFactor				= PIEZOBOARD_DEFAULT__SIGMAFACTOR;
+	currentSettings.baseline.bTrackShift				= PIEZOBOARD_DEFAULT__TRACKSHIFT;
+	currentSettings.baseline.bFreezeMargin				= PIEZOBOARD_DEFAULT__FREEZEMARGIN;
+	currentSettings.capture.postTrigger					= PIEZOBOARD_DEFAULT__CAPTUREPOSTTRIGGER;
+	currentSettings.qualifier.bReleasePercent			= PIEZOBOARD_DEFAULT__RELEASEPERCENT;
+	currentSettings.qualifier.bMinSamples				= PIEZOBOARD_DEFAULT__MINSAMPLES;
+	currentSettings.qualifier.bMinChannels				= PIEZOBOARD_DEFAULT__MINCHANNELS;
+	currentSettings.qualifier.bCoincidenceWindow		= PIEZOBOARD_DEFAULT__COINCIDENCEWINDOW;
+	currentSettings.biquad.bStages						= PIEZOBOARD_DEFAULT__BIQUADSTAGES;
+	for(i = 0; i < BIQUAD_STAGES_MAX; i=i+1) {
+		/* Pass through stages */
+		currentSettings.biquad.coefficients[i][0]		= BIQUAD_COEFF_ONE;
+		currentSettings.biquad.coefficients[i][1]		= 0;
+		currentSettings.biquad.coefficients[i][2]		= 0;
+		currentSettings.biquad.coefficients[i][3]		= 0;
+		currentSettings.biquad.coefficients[i][4]		= 0;
+	}
 
-	currentSettings.movingAverageRefCenterline[0]		= 0.0f;
-	currentSettings.movingAverageRefCenterline[1]		= 0.0f;
-	currentSettings.movingAverageRefCenterline[2]		= 0.0f;
-	currentSettings.movingAverageRefCenterline[3]		= 0.0f;
+	currentSettings.calibration.bValid					= 0;
+	currentSettings.calibration.bActiveChannels			= 0;
+	for(i = 0; i < 4; i=i+1) {
+		currentSettings.calibration.centerline[i]		= 0;
+		currentSettings.calibration.noiseSigma[i]		= 0;
+	}
 
 	eepromSave();
 }
 
-static void eepromLoad() {
-	unsigned long int i;
-	uint8_t chkSum;
+/*
+	Refreshes the register map served in I2C register mode. Runs at most
+	once per millisecond; if the interrupt is still reading the buffer the
+	snapshot is retried on the next pass
+*/
+static unsigned long int registerSnapshotMillis = 0;
+static uint8_t registerSnapshotSequence = 0;
 
-	eeprom_read_block(&currentSettings, SETTINGS_EEPROM_LOCATION, sizeof(struct eepromSettings));
+static void registerSnapshotUpdate() {
+	uint8_t i;
+	uint8_t bMap[I2C_REGISTER_MAP_SIZE];
+	uint16_t rawValues[4];
+	int16_t averages[4];
+	uint32_t dwTriggers;
+	uint16_t checksumErrors;
+	uint16_t rxOverflows;
+	bool bCalibrating;
+	bool bOutput;
+	uint16_t wGeneration;
+	uint16_t wRecords;
+	unsigned long int dwNow = millis();
 
-	chkSum = 0;
-	for(i = 0; i < sizeof(struct eepromSettings)-2; i=i+1) {
-		chkSum = chkSum ^ ((char*)(&currentSettings))[i];
+	if(dwNow == registerSnapshotMillis) {
+		return;
+	}
+
+	{
+		uint8_t sregOld = SREG;
+		#ifndef FRAMAC_SKIP
+			cli();
+		#endif
+
+		for(i = 0; i < 4; i=i+1) {
+			rawValues[i] = currentADCValues[i];
+			averages[i] = currentMovingAverage[i];
+		}
+		dwTriggers = telemetryCounters.dwTriggers[0] + telemetryCounters.dwTriggers[1] + telemetryCounters.dwTriggers[2] + telemetryCounters.dwTriggers[3];
+		checksumErrors = (uint16_t)telemetryCounters.dwChecksumErrors;
+		rxOverflows = (uint16_t)telemetryCounters.dwRxOverflows;
+		bCalibrating = (adcMovingAverageCapCenterline != 0) ? true : false;
+		bOutput = (triggerDebounceRemaining != 0) ? true : false;
+
+		SREG = sregOld;
+	}
+
+	bMap[i2cReg_Status] = 0;
+	if(bCalibrating) { bMap[i2cReg_Status] = bMap[i2cReg_Status] | I2C_REGSTATUS__CALIBRATING; }
+	if(bOutput) { bMap[i2cReg_Status] = bMap[i2cReg_Status] | I2C_REGSTATUS__OUTPUT; }
+	if(journalStatus(&wGeneration, &wRecords) != journalState_Idle) { bMap[i2cReg_Status] = bMap[i2cReg_Status] | I2C_REGSTATUS__STOREBUSY; }
+	if(captureState == captureState_Frozen) { bMap[i2cReg_Status] = bMap[i2cReg_Status] | I2C_REGSTATUS__CAPTUREFROZEN; }
+
+	bMap[i2cReg_TriggerMode] = (uint8_t)currentSettings.trigMode;
+	bMap[i2cReg_Sequence] = registerSnapshotSequence;
+	bMap[i2cReg_ActiveChannels] = adcActiveChannels();
+
+	/* Channels that are not sampled are reported as 0, averages in whole ADC counts */
+	for(i = 0; i < 4; i=i+1) {
+		if((bMap[i2cReg_ActiveChannels] & (1 << i)) == 0) {
+			rawValues[i] = 0;
+			averages[i] = 0;
+		}
+		bMap[i2cReg_RawValues+2*i  ] = (uint8_t)(rawValues[i] & 0xFF);
+		bMap[i2cReg_RawValues+2*i+1] = (uint8_t)((rawValues[i] >> 8) & 0xFF);
+		bMap[i2cReg_Averages+2*i   ] = (uint8_t)((((uint16_t)(averages[i] >> ADC_Q_SHIFT))     ) & 0xFF);
+		bMap[i2cReg_Averages+2*i+1 ] = (uint8_t)((((uint16_t)(averages[i] >> ADC_Q_SHIFT)) >> 8) & 0xFF);
+	}
+
+	for(i = 0; i < 4; i=i+1) {
+		bMap[i2cReg_Triggers+i] = (uint8_t)((dwTriggers >> (8*i)) & 0xFF);
+		bMap[i2cReg_Millis+i] = (uint8_t)((dwNow >> (8*i)) & 0xFF);
+	}
+	bMap[i2cReg_ChecksumErrors  ] = (uint8_t)(checksumErrors & 0xFF);
+	bMap[i2cReg_ChecksumErrors+1] = (uint8_t)((checksumErrors >> 8) & 0xFF);
+	bMap[i2cReg_RxOverflows  ] = (uint8_t)(rxOverflows & 0xFF);
+	bMap[i2cReg_RxOverflows+1] = (uint8_t)((rxOverflows >> 8) & 0xFF);
+
+	if(i2cRegisterPublish(bMap)) {
+		registerSnapshotMillis = dwNow;
+		registerSnapshotSequence = registerSnapshotSequence + 1;
 	}
+}
 
-	if((chkSum == currentSettings.xorChecksum) && ((chkSum ^ 0xFF) == currentSettings.negChecksum)) {
-		refCenterline[0] = currentSettings.movingAverageRefCenterline[0];
-		refCenterline[1] = currentSettings.movingAverageRefCenterline[1];
-		refCenterline[2] = currentSettings.movingAverageRefCenterline[2];
-		refCenterline[3] = currentSettings.movingAverageRefCenterline[3];
+static void eepromLoad() {
+	if(journalLoad(&currentSettings)) {
+		/* The stored calibration is restored and verified by adcInit */
 		return;
 	}
 
@@ -153,6 +296,7 @@ int main() {
 
 	/* Load settings from EEPROM */
 	eepromLoad();
+	adcApplySettings();
 
 	#if 0
 		/*
@@ -163,71 +307,35 @@ int main() {
 		PORTB = PORTB | 0x02;
 	#endif
 
+	/* Cycle counter for latency measurements and trigger output logic */
+	cycleCounterInit();
+	triggerInit();
+	eventlogInit();
+	#if PIEZO_PROFILER
+		profilerReset();
+	#endif
+
 	/* Intiialize ADC */
 	adcInit();
 
 	for(;;) {
-		i2cMessageLoop();
-
-		switch(currentSettings.trigMode) {
-			case triggerMode_PiezoOnly:
-			{
-				if((adcTriggered != false) && (debounceCounter == 0)) {
-					adcTriggered = false;
-					PORTB = PORTB | 0x02;
-					debounceCounter = currentSettings.debounceLength;
-					debounceStart = millis();
-				}
-				break;
-			}
-			case triggerMode_PiezoVeto:
-			{
-				if((adcTriggered != false) && (debounceCounter == 0) && ((PINB & 0x04) != 0)) {
-					adcTriggered = false;
-					PORTB = PORTB | 0x02;
-					debounceCounter = currentSettings.debounceLength;
-					debounceStart = millis();
-				}
-				break;
-			}
-			case triggerMode_Capacitive:
-			{
-				if((PINB & 0x04) != 0) {
-					PORTB = PORTB | 0x02;
-					debounceCounter = currentSettings.debounceLength;
-					debounceStart = millis();
-				}
-				break;
-			}
-			case triggerMode_PiezoOrCapacitive:
-			{
-				if(((adcTriggered != false) && (debounceCounter == 0)) || ((PINB & 0x04) != 0)) {
-					adcTriggered = false;
-					PORTB = PORTB | 0x02;
-					debounceCounter = currentSettings.debounceLength;
-					debounceStart = millis();
-				}
-				break;
-			}
-		}
+		/*
+			Trigger decisions and the debounce release are handled in
+			interrupt context (see trigger.c) so I2C processing cannot
+			delay the output
+		*/
+		#if PIEZO_PROFILER
+			uint16_t tsLoop = profilerLoopStart();
+		#endif
 
-		if(debounceCounter > 0) {
-			unsigned long int debounceEnd;
-			unsigned long int milCurrent = millis();
-			debounceEnd = debounceStart + debounceCounter;
+		i2cMessageLoop();
+		adcTask();
+		journalTask();
+		registerSnapshotUpdate();
 
-			if(debounceEnd < debounceStart) {
-				if((milCurrent > debounceEnd) && (milCurrent < debounceStart)) {
-					debounceCounter = 0;
-					PORTB = PORTB & (~0x02);
-				}
-			} else {
-				if((milCurrent > debounceEnd) || (milCurrent < debounceStart)) {
-					debounceCounter = 0;
-					PORTB = PORTB & (~0x02);
-				}
-			}
-		}
+		#if PIEZO_PROFILER
+			profilerLoopEnd(tsLoop);
+		#endif
 	}
 }
 
@@ -236,6 +344,160 @@ static uint8_t handleI2CMessage_Response_IDAndVersion[16+1] = {
 	0x01
 };
 
+/*
+	Serializes the active settings into the block layout described in the
+	README (SETTINGS_BLOCK_LAYOUT). Calibration data is not part of the block
+*/
+static void settingsBlockEncode(uint8_t* lpBlock) {
+	uint8_t i;
+	uint8_t j;
+	uint16_t alphaPermille = (uint16_t)(currentSettings.movingAverage.dMovingAverageAlpha * 1000.0 + 0.5);
+
+	lpBlock[0] = SETTINGS_BLOCK_LAYOUT;
+	lpBlock[1] = SETTINGS_BLOCK_VERSION;
+	lpBlock[2] = (uint8_t)currentSettings.trigMode;
+	lpBlock[3] = (uint8_t)(currentSettings.movingAverage.thresholdFactor & 0xFF);
+	lpBlock[4] = (uint8_t)((currentSettings.movingAverage.thresholdFactor >> 8) & 0xFF);
+	lpBlock[5] = (uint8_t)(alphaPermille & 0xFF);
+	lpBlock[6] = (uint8_t)((alphaPermille >> 8) & 0xFF);
+	lpBlock[7] = (uint8_t)(currentSettings.movingAverage.dwInitSamples & 0xFF);
+	lpBlock[8] = (uint8_t)((currentSettings.movingAverage.dwInitSamples >> 8) & 0xFF);
+	lpBlock[9] = (uint8_t)((currentSettings.movingAverage.dwInitSamples >> 16) & 0xFF);
+	lpBlock[10] = (uint8_t)((currentSettings.movingAverage.dwInitSamples >> 24) & 0xFF);
+	lpBlock[11] = (uint8_t)(currentSettings.debounceLength & 0xFF);
+	lpBlock[12] = (uint8_t)((currentSettings.debounceLength >> 8) & 0xFF);
+	lpBlock[13] = currentSettings.filter.bFilterMode;
+	lpBlock[14] = currentSettings.filter.bMedianWindow;
+	lpBlock[15] = currentSettings.detector.bDetectorMode;
+	lpBlock[16] = currentSettings.detector.bSlopeDistance;
+	lpBlock[17] = (uint8_t)(currentSettings.detector.slopeThreshold & 0xFF);
+	lpBlock[18] = (uint8_t)((currentSettings.detector.slopeThreshold >> 8) & 0xFF);
+	lpBlock[19] = (uint8_t)(currentSettings.sampling.sampleRate & 0xFF);
+	lpBlock[20] = (uint8_t)((currentSettings.sampling.sampleRate >> 8) & 0xFF);
+	lpBlock[21] = currentSettings.sampling.bPrescaler;
+	lpBlock[22] = currentSettings.sampling.bFlags;
+	lpBlock[23] = currentSettings.sampling.bActiveChannels;
+	lpBlock[24] = currentSettings.threshold.bThresholdMode;
+	lpBlock[25] = currentSettings.threshold.bSigmaFactor;
+	lpBlock[26] = currentSettings.baseline.bTrackShift;
+	lpBlock[27] = currentSettings.baseline.bFreezeMargin;
+	lpBlock[28] = (uint8_t)(currentSettings.capture.postTrigger & 0xFF);
+	lpBlock[29] = (uint8_t)((currentSettings.capture.postTrigger >> 8) & 0xFF);
+	lpBlock[30] = currentSettings.qualifier.bReleasePercent;
+	lpBlock[31] = currentSettings.qualifier.bMinSamples;
+	lpBlock[32] = currentSettings.qualifier.bMinChannels;
+	lpBlock[33] = currentSettings.qualifier.bCoincidenceWindow;
+	lpBlock[34] = currentSettings.biquad.bStages;
+	for(i = 0; i < BIQUAD_STAGES_MAX; i=i+1) {
+		for(j = 0; j < 5; j=j+1) {
+			lpBlock[35+10*i+2*j] = (uint8_t)(((uint16_t)currentSettings.biquad.coefficients[i][j]) & 0xFF);
+			lpBlock[36+10*i+2*j] = (uint8_t)((((uint16_t)currentSettings.biquad.coefficients[i][j]) >> 8) & 0xFF);
+		}
+	}
+}
+
+#define settingsBlockByte(idx)			(lpRingbuffer[dwBase + 2 + (idx)])
+#define settingsBlockWord(idx)			(((uint16_t)settingsBlockByte(idx)) | (((uint16_t)settingsBlockByte((idx)+1)) << 8))
+
+/*
+	Validates a complete settings block and only if every field is in
+	range applies all of them at once. Returns false if anything has been
+	rejected, the active settings are untouched in that case
+*/
+static bool settingsBlockApply(
+	volatile uint8_t* lpRingbuffer,
+	unsigned long int dwBase
+) {
+	uint8_t i;
+	uint8_t j;
+	uint16_t threshold = settingsBlockWord(3);
+	uint16_t alphaPermille = settingsBlockWord(5);
+	uint32_t dwInitSamples = ((uint32_t)settingsBlockWord(7)) | (((uint32_t)settingsBlockWord(9)) << 16);
+	uint16_t debounceLength = settingsBlockWord(11);
+	struct biquadCoefficients coeff;
+
+	if((settingsBlockByte(0) != SETTINGS_BLOCK_LAYOUT) || (settingsBlockByte(1) != SETTINGS_BLOCK_VERSION)) {
+		return false;
+	}
+
+	if(settingsBlockByte(2) > triggerMode_PiezoOrCapacitive) { return false; }
+	if(threshold > 1023) { return false; }
+	if(alphaPermille > 1000) { return false; }
+	if((dwInitSamples < 1) || (dwInitSamples > ADC_INITSAMPLES_MAX)) { return false; }
+	if(debounceLength < 1) { return false; }
+	if((settingsBlockByte(13) != filterMode_MovingAverage) && (settingsBlockByte(13) != filterMode_RunningMedian)) { return false; }
+	if((settingsBlockByte(14) < 1) || (settingsBlockByte(14) > ADC_MEDIAN_WINDOW_MAX)) { return false; }
+	if((settingsBlockByte(15) != detectorMode_Deviation) && (settingsBlockByte(15) != detectorMode_Slope)) { return false; }
+	if((settingsBlockByte(16) < 1) || (settingsBlockByte(16) > ADC_SLOPE_DISTANCE_MAX)) { return false; }
+	if(!adcSamplingValid(settingsBlockWord(19), settingsBlockByte(21), settingsBlockByte(22), settingsBlockByte(23))) { return false; }
+	if((settingsBlockByte(24) != thresholdMode_Absolute) && (settingsBlockByte(24) != thresholdMode_NoiseSigma)) { return false; }
+	if(settingsBlockByte(25) == 0) { return false; }
+	if((settingsBlockByte(26) != 0) && ((settingsBlockByte(26) < ADC_TRACK_SHIFT_MIN) || (settingsBlockByte(26) > ADC_TRACK_SHIFT_MAX))) { return false; }
+	if((settingsBlockByte(27) < 1) || (settingsBlockByte(27) > 100)) { return false; }
+	if(settingsBlockWord(28) >= CAPTURE_SLOTS) { return false; }
+	if((settingsBlockByte(30) < 1) || (settingsBlockByte(30) > 100)) { return false; }
+	if(settingsBlockByte(31) < 1) { return false; }
+	if((settingsBlockByte(32) < 1) || (settingsBlockByte(32) > 4)) { return false; }
+	if(settingsBlockByte(34) > BIQUAD_STAGES_MAX) { return false; }
+	for(i = 0; i < BIQUAD_STAGES_MAX; i=i+1) {
+		coeff.b0 = (int16_t)settingsBlockWord(35+10*i);
+		coeff.b1 = (int16_t)settingsBlockWord(37+10*i);
+		coeff.b2 = (int16_t)settingsBlockWord(39+10*i);
+		coeff.a1 = (int16_t)settingsBlockWord(41+10*i);
+		coeff.a2 = (int16_t)settingsBlockWord(43+10*i);
+		if(!biquadValid(&coeff)) {
+			return false; /* Would oscillate or overflow the accumulator */
+		}
+	}
+
+	/* Trigger mode and debounce length are used by the trigger interrupts directly */
+	{
+		uint8_t sregOld = SREG;
+		#ifndef FRAMAC_SKIP
+			cli();
+		#endif
+
+		currentSettings.trigMode = (enum triggerMode)settingsBlockByte(2);
+		currentSettings.debounceLength = debounceLength;
+
+		SREG = sregOld;
+	}
+
+	currentSettings.movingAverage.thresholdFactor = threshold;
+	currentSettings.movingAverage.dMovingAverageAlpha = ((float)alphaPermille) / 1000.0;
+	currentSettings.movingAverage.dwInitSamples = dwInitSamples;
+	currentSettings.filter.bFilterMode = settingsBlockByte(13);
+	currentSettings.filter.bMedianWindow = settingsBlockByte(14);
+	currentSettings.detector.bDetectorMode = settingsBlockByte(15);
+	currentSettings.detector.bSlopeDistance = settingsBlockByte(16);
+	currentSettings.detector.slopeThreshold = settingsBlockWord(17);
+	currentSettings.sampling.sampleRate = settingsBlockWord(19);
+	currentSettings.sampling.bPrescaler = settingsBlockByte(21);
+	currentSettings.sampling.bFlags = settingsBlockByte(22);
+	currentSettings.sampling.bActiveChannels = settingsBlockByte(23);
+	currentSettings.threshold.bThresholdMode = settingsBlockByte(24);
+	currentSettings.threshold.bSigmaFactor = settingsBlockByte(25);
+	currentSettings.baseline.bTrackShift = settingsBlockByte(26);
+	currentSettings.baseline.bFreezeMargin = settingsBlockByte(27);
+	currentSettings.capture.postTrigger = settingsBlockWord(28);
+	currentSettings.qualifier.bReleasePercent = settingsBlockByte(30);
+	currentSettings.qualifier.bMinSamples = settingsBlockByte(31);
+	currentSettings.qualifier.bMinChannels = settingsBlockByte(32);
+	currentSettings.qualifier.bCoincidenceWindow = settingsBlockByte(33);
+	currentSettings.biquad.bStages = settingsBlockByte(34);
+	for(i = 0; i < BIQUAD_STAGES_MAX; i=i+1) {
+		for(j = 0; j < 5; j=j+1) {
+			currentSettings.biquad.coefficients[i][j] = (int16_t)settingsBlockWord(35+10*i+2*j);
+		}
+	}
+
+	adcApplySettings();
+	return true;
+}
+
+#undef settingsBlockWord
+#undef settingsBlockByte
+
 /*
 	Handle an I2C message. The message is contained in an ringbuffer and it's
 	checksum has already been checked (it's not included in the message size).
@@ -273,6 +535,7 @@ void handleI2CMessage(
 			uint8_t bNewThreshold = lpRingbuffer[dwBase+2];
 
 			currentSettings.movingAverage.thresholdFactor = bNewThreshold;
+			adcApplySettings();
 			/* ToDo: Write into EEPROM? */
 
 			break;
@@ -295,6 +558,15 @@ void handleI2CMessage(
 				SREG = oldSREG;
 			}
 
+			/* Channels that are not sampled are reported as 0 */
+			{
+				uint8_t i;
+				uint8_t activeChannels = adcActiveChannels();
+				for(i = 0; i < 4; i=i+1) {
+					if((activeChannels & (1 << i)) == 0) { bufferedCounts[i] = 0; }
+				}
+			}
+
 			uint8_t bResponse[4*2];
 			bResponse[0] = ((uint8_t)(bufferedCounts[0] & 0xFF));
 			bResponse[1] = ((uint8_t)((bufferedCounts[0] >> 8) & 0xFF));
@@ -310,7 +582,7 @@ void handleI2CMessage(
 		}
 		case i2cCmd_ReadCurrentAverages:
 		{
-			float bufferedAverages[4];
+			int16_t bufferedAverages[4];
 			{
 				uint8_t oldSREG = SREG;
 				#ifndef FRAMAC_SKIP
@@ -325,16 +597,26 @@ void handleI2CMessage(
 				SREG = oldSREG;
 			}
 
+			/* Channels that are not sampled are reported as 0 */
+			{
+				uint8_t i;
+				uint8_t activeChannels = adcActiveChannels();
+				for(i = 0; i < 4; i=i+1) {
+					if((activeChannels & (1 << i)) == 0) { bufferedAverages[i] = 0; }
+				}
+			}
+
 			uint8_t bResponse[4*2];
 
-			bResponse[0] = (uint8_t)((((uint16_t)bufferedAverages[0])     ) & 0xFF);
-			bResponse[1] = (uint8_t)((((uint16_t)bufferedAverages[0]) >> 8) & 0xFF);
-			bResponse[2] = (uint8_t)((((uint16_t)bufferedAverages[1])     ) & 0xFF);
-			bResponse[3] = (uint8_t)((((uint16_t)bufferedAverages[1]) >> 8) & 0xFF);
-			bResponse[4] = (uint8_t)((((uint16_t)bufferedAverages[2])     ) & 0xFF);
-			bResponse[5] = (uint8_t)((((uint16_t)bufferedAverages[2]) >> 8) & 0xFF);
-			bResponse[6] = (uint8_t)((((uint16_t)bufferedAverages[3])     ) & 0xFF);
-			bResponse[7] = (uint8_t)((((uint16_t)bufferedAverages[3]) >> 8) & 0xFF);
+			/* Averages are kept in Q10.5 - report whole ADC counts */
+			bResponse[0] = (uint8_t)((((uint16_t)(bufferedAverages[0] >> ADC_Q_SHIFT))     ) & 0xFF);
+			bResponse[1] = (uint8_t)((((uint16_t)(bufferedAverages[0] >> ADC_Q_SHIFT)) >> 8) & 0xFF);
+			bResponse[2] = (uint8_t)((((uint16_t)(bufferedAverages[1] >> ADC_Q_SHIFT))     ) & 0xFF);
+			bResponse[3] = (uint8_t)((((uint16_t)(bufferedAverages[1] >> ADC_Q_SHIFT)) >> 8) & 0xFF);
+			bResponse[4] = (uint8_t)((((uint16_t)(bufferedAverages[2] >> ADC_Q_SHIFT))     ) & 0xFF);
+			bResponse[5] = (uint8_t)((((uint16_t)(bufferedAverages[2] >> ADC_Q_SHIFT)) >> 8) & 0xFF);
+			bResponse[6] = (uint8_t)((((uint16_t)(bufferedAverages[3] >> ADC_Q_SHIFT))     ) & 0xFF);
+			bResponse[7] = (uint8_t)((((uint16_t)(bufferedAverages[3] >> ADC_Q_SHIFT)) >> 8) & 0xFF);
 
 			i2cTransmitPacket(bResponse, i2cCmd_ReadCurrentAverages, sizeof(bResponse));
 			break;
@@ -364,6 +646,7 @@ void handleI2CMessage(
 		}
 		case i2cCmd_Reset:
 			eepromDefaults();
+			adcApplySettings();
 			adcStartCalibration();
 			break;
 		case i2cCmd_Recalibrate:
@@ -388,8 +671,601 @@ void handleI2CMessage(
 			if(alphaPct > 100) { alphaPct = 100; }
 
 			currentSettings.movingAverage.dMovingAverageAlpha = ((float)alphaPct) / 100.0;
+			adcApplySettings();
+			break;
+		}
+		case i2cCmd_GetFilterMode:
+		{
+			uint8_t bResponse[2];
+			bResponse[0] = currentSettings.filter.bFilterMode;
+			bResponse[1] = currentSettings.filter.bMedianWindow;
+			i2cTransmitPacket(bResponse, i2cCmd_GetFilterMode, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_SetFilterMode:
+		{
+			if(dwMessageSize < 4) {
+				break; /* Invalid message */
+			}
+			uint8_t newMode = lpRingbuffer[dwBase + 2];
+			uint8_t newWindow = lpRingbuffer[dwBase + 3];
+
+			if((newMode != filterMode_MovingAverage) && (newMode != filterMode_RunningMedian)) {
+				break; /* Invalid message */
+			}
+			if((newWindow < 1) || (newWindow > ADC_MEDIAN_WINDOW_MAX)) {
+				break; /* Invalid message */
+			}
+
+			currentSettings.filter.bFilterMode = newMode;
+			currentSettings.filter.bMedianWindow = newWindow;
+			adcApplySettings();
+			break;
+		}
+		case i2cCmd_GetDetectorMode:
+		{
+			uint8_t bResponse[4];
+			bResponse[0] = currentSettings.detector.bDetectorMode;
+			bResponse[1] = currentSettings.detector.bSlopeDistance;
+			bResponse[2] = (uint8_t)(currentSettings.detector.slopeThreshold & 0xFF);
+			bResponse[3] = (uint8_t)((currentSettings.detector.slopeThreshold >> 8) & 0xFF);
+			i2cTransmitPacket(bResponse, i2cCmd_GetDetectorMode, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_SetDetectorMode:
+		{
+			if(dwMessageSize < 6) {
+				break; /* Invalid message */
+			}
+			uint8_t newMode = lpRingbuffer[dwBase + 2];
+			uint8_t newDistance = lpRingbuffer[dwBase + 3];
+			uint16_t newThreshold = ((uint16_t)lpRingbuffer[dwBase + 4]) | (((uint16_t)lpRingbuffer[dwBase + 5]) << 8);
+
+			if((newMode != detectorMode_Deviation) && (newMode != detectorMode_Slope)) {
+				break; /* Invalid message */
+			}
+			if((newDistance < 1) || (newDistance > ADC_SLOPE_DISTANCE_MAX)) {
+				break; /* Invalid message */
+			}
+
+			currentSettings.detector.bDetectorMode = newMode;
+			currentSettings.detector.bSlopeDistance = newDistance;
+			currentSettings.detector.slopeThreshold = newThreshold;
+			adcApplySettings();
+			break;
+		}
+		case i2cCmd_GetTriggerLatency:
+		{
+			uint16_t latencyLast;
+			uint16_t latencyMax;
+			{
+				uint8_t oldSREG = SREG;
+				#ifndef FRAMAC_SKIP
+					cli();
+				#endif
+
+				latencyLast = triggerLatencyLast;
+				latencyMax = triggerLatencyMax;
+				triggerLatencyMax = 0;
+
+				SREG = oldSREG;
+			}
+
+			uint8_t bResponse[4];
+			bResponse[0] = (uint8_t)(latencyLast & 0xFF);
+			bResponse[1] = (uint8_t)((latencyLast >> 8) & 0xFF);
+			bResponse[2] = (uint8_t)(latencyMax & 0xFF);
+			bResponse[3] = (uint8_t)((latencyMax >> 8) & 0xFF);
+			i2cTransmitPacket(bResponse, i2cCmd_GetTriggerLatency, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_GetSampling:
+		{
+			uint8_t bResponse[4];
+			bResponse[0] = (uint8_t)(currentSettings.sampling.sampleRate & 0xFF);
+			bResponse[1] = (uint8_t)((currentSettings.sampling.sampleRate >> 8) & 0xFF);
+			bResponse[2] = currentSettings.sampling.bPrescaler;
+			bResponse[3] = currentSettings.sampling.bFlags;
+			i2cTransmitPacket(bResponse, i2cCmd_GetSampling, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_SetSampling:
+		{
+			if(dwMessageSize < 6) {
+				break; /* Invalid message */
+			}
+			uint16_t newRate = ((uint16_t)lpRingbuffer[dwBase + 2]) | (((uint16_t)lpRingbuffer[dwBase + 3]) << 8);
+			uint8_t newPrescaler = lpRingbuffer[dwBase + 4];
+			uint8_t newFlags = lpRingbuffer[dwBase + 5];
+
+			if(!adcSamplingValid(newRate, newPrescaler, newFlags, currentSettings.sampling.bActiveChannels)) {
+				break; /* Invalid message */
+			}
+
+			currentSettings.sampling.sampleRate = newRate;
+			currentSettings.sampling.bPrescaler = newPrescaler;
+			currentSettings.sampling.bFlags = newFlags;
+			adcApplySettings();
+			break;
+		}
+		case i2cCmd_GetActiveChannels:
+		{
+			uint8_t bResponse[1];
+			bResponse[0] = currentSettings.sampling.bActiveChannels;
+			i2cTransmitPacket(bResponse, i2cCmd_GetActiveChannels, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_SetActiveChannels:
+		{
+			if(dwMessageSize < 3) {
+				break; /* Invalid message */
+			}
+			uint8_t newChannels = lpRingbuffer[dwBase + 2];
+
+			if(!adcSamplingValid(currentSettings.sampling.sampleRate, currentSettings.sampling.bPrescaler, currentSettings.sampling.bFlags, newChannels)) {
+				break; /* Invalid message (or sample rate not achievable with that many channels) */
+			}
+
+			currentSettings.sampling.bActiveChannels = newChannels;
+			adcApplySettings();
 			break;
 		}
+		case i2cCmd_GetBiquad:
+		{
+			if(dwMessageSize < 3) {
+				break; /* Invalid message */
+			}
+			uint8_t bStage = lpRingbuffer[dwBase + 2];
+			uint8_t i;
+
+			if(bStage >= BIQUAD_STAGES_MAX) {
+				break; /* Invalid message */
+			}
+
+			uint8_t bResponse[2+5*2];
+			bResponse[0] = currentSettings.biquad.bStages;
+			bResponse[1] = bStage;
+			for(i = 0; i < 5; i=i+1) {
+				bResponse[2+2*i] = (uint8_t)(((uint16_t)currentSettings.biquad.coefficients[bStage][i]) & 0xFF);
+				bResponse[3+2*i] = (uint8_t)((((uint16_t)currentSettings.biquad.coefficients[bStage][i]) >> 8) & 0xFF);
+			}
+			i2cTransmitPacket(bResponse, i2cCmd_GetBiquad, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_SetBiquad:
+		{
+			if(dwMessageSize < 2+2+5*2) {
+				break; /* Invalid message */
+			}
+			uint8_t bStages = lpRingbuffer[dwBase + 2];
+			uint8_t bStage = lpRingbuffer[dwBase + 3];
+			struct biquadCoefficients newCoeff;
+
+			if((bStages > BIQUAD_STAGES_MAX) || (bStage >= BIQUAD_STAGES_MAX)) {
+				break; /* Invalid message */
+			}
+
+			newCoeff.b0 = (int16_t)(((uint16_t)lpRingbuffer[dwBase + 4]) | (((uint16_t)lpRingbuffer[dwBase + 5]) << 8));
+			newCoeff.b1 = (int16_t)(((uint16_t)lpRingbuffer[dwBase + 6]) | (((uint16_t)lpRingbuffer[dwBase + 7]) << 8));
+			newCoeff.b2 = (int16_t)(((uint16_t)lpRingbuffer[dwBase + 8]) | (((uint16_t)lpRingbuffer[dwBase + 9]) << 8));
+			newCoeff.a1 = (int16_t)(((uint16_t)lpRingbuffer[dwBase + 10]) | (((uint16_t)lpRingbuffer[dwBase + 11]) << 8));
+			newCoeff.a2 = (int16_t)(((uint16_t)lpRingbuffer[dwBase + 12]) | (((uint16_t)lpRingbuffer[dwBase + 13]) << 8));
+
+			if(!biquadValid(&newCoeff)) {
+				break; /* Invalid message - would oscillate or overflow the accumulator */
+			}
+
+			currentSettings.biquad.bStages = bStages;
+			currentSettings.biquad.coefficients[bStage][0] = newCoeff.b0;
+			currentSettings.biquad.coefficients[bStage][1] = newCoeff.b1;
+			currentSettings.biquad.coefficients[bStage][2] = newCoeff.b2;
+			currentSettings.biquad.coefficients[bStage][3] = newCoeff.a1;
+			currentSettings.biquad.coefficients[bStage][4] = newCoeff.a2;
+			adcApplySettings();
+			break;
+		}
+		case i2cCmd_GetThresholdMode:
+		{
+			uint8_t bResponse[2];
+			bResponse[0] = currentSettings.threshold.bThresholdMode;
+			bResponse[1] = currentSettings.threshold.bSigmaFactor;
+			i2cTransmitPacket(bResponse, i2cCmd_GetThresholdMode, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_SetThresholdMode:
+		{
+			if(dwMessageSize < 4) {
+				break; /* Invalid message */
+			}
+			uint8_t newMode = lpRingbuffer[dwBase + 2];
+			uint8_t newFactor = lpRingbuffer[dwBase + 3];
+
+			if((newMode != thresholdMode_Absolute) && (newMode != thresholdMode_NoiseSigma)) {
+				break; /* Invalid message */
+			}
+			if(newFactor == 0) {
+				break; /* Invalid message */
+			}
+
+			currentSettings.threshold.bThresholdMode = newMode;
+			currentSettings.threshold.bSigmaFactor = newFactor;
+			adcApplySettings();
+			break;
+		}
+		case i2cCmd_GetNoiseStatistics:
+		{
+			uint16_t sigma[4];
+			uint16_t threshold[4];
+			uint8_t i;
+			uint8_t bResponse[1+4*2+4*2];
+
+			bResponse[0] = adcNoiseStatistics(sigma, threshold) ? 0x01 : 0x00;
+			if((bResponse[0] != 0) && adcCalibrationRestored()) {
+				bResponse[0] = bResponse[0] | 0x02; /* Warm start from the stored calibration */
+			}
+			for(i = 0; i < 4; i=i+1) {
+				bResponse[1+2*i] = (uint8_t)(sigma[i] & 0xFF);
+				bResponse[2+2*i] = (uint8_t)((sigma[i] >> 8) & 0xFF);
+				bResponse[9+2*i] = (uint8_t)(threshold[i] & 0xFF);
+				bResponse[10+2*i] = (uint8_t)((threshold[i] >> 8) & 0xFF);
+			}
+			i2cTransmitPacket(bResponse, i2cCmd_GetNoiseStatistics, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_GetBaselineTracking:
+		{
+			uint8_t bResponse[2];
+			bResponse[0] = currentSettings.baseline.bTrackShift;
+			bResponse[1] = currentSettings.baseline.bFreezeMargin;
+			i2cTransmitPacket(bResponse, i2cCmd_GetBaselineTracking, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_SetBaselineTracking:
+		{
+			if(dwMessageSize < 4) {
+				break; /* Invalid message */
+			}
+			uint8_t newShift = lpRingbuffer[dwBase + 2];
+			uint8_t newMargin = lpRingbuffer[dwBase + 3];
+
+			if((newShift != 0) && ((newShift < ADC_TRACK_SHIFT_MIN) || (newShift > ADC_TRACK_SHIFT_MAX))) {
+				break; /* Invalid message */
+			}
+			if((newMargin < 1) || (newMargin > 100)) {
+				break; /* Invalid message */
+			}
+
+			currentSettings.baseline.bTrackShift = newShift;
+			currentSettings.baseline.bFreezeMargin = newMargin;
+			adcApplySettings();
+			break;
+		}
+		case i2cCmd_ReadEvent:
+		{
+			if(dwMessageSize < 3) {
+				break; /* Invalid message */
+			}
+			struct eventlogEntry event;
+			uint8_t bLost;
+			uint8_t i;
+			uint8_t bResponse[2+12+4*2];
+
+			bResponse[0] = eventlogRead(&event, (lpRingbuffer[dwBase + 2] != 0), &bLost);
+			bResponse[1] = bLost;
+			if(bResponse[0] == 0) {
+				for(i = 2; i < sizeof(bResponse); i=i+1) {
+					bResponse[i] = 0;
+				}
+			} else {
+				bResponse[2] = (uint8_t)(event.dwTimestamp & 0xFF);
+				bResponse[3] = (uint8_t)((event.dwTimestamp >> 8) & 0xFF);
+				bResponse[4] = (uint8_t)((event.dwTimestamp >> 16) & 0xFF);
+				bResponse[5] = (uint8_t)((event.dwTimestamp >> 24) & 0xFF);
+				bResponse[6] = event.bTriggerMode;
+				bResponse[7] = event.bFirstChannel;
+				bResponse[8] = event.bFlags;
+				bResponse[9] = event.bCrossedMask;
+				for(i = 0; i < 4; i=i+1) {
+					bResponse[10+i] = event.bCrossOffset[i];
+					bResponse[14+2*i] = (uint8_t)(event.peakDeviation[i] & 0xFF);
+					bResponse[15+2*i] = (uint8_t)((event.peakDeviation[i] >> 8) & 0xFF);
+				}
+			}
+			i2cTransmitPacket(bResponse, i2cCmd_ReadEvent, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_ClearEvents:
+			eventlogClear();
+			break;
+		case i2cCmd_GetCaptureStatus:
+		{
+			uint16_t validSamples;
+			uint16_t triggerIndex;
+			uint8_t bResponse[11];
+
+			bResponse[0] = captureStatus(&validSamples, &triggerIndex);
+			bResponse[1] = (uint8_t)(CAPTURE_SLOTS & 0xFF);
+			bResponse[2] = (uint8_t)((CAPTURE_SLOTS >> 8) & 0xFF);
+			bResponse[3] = (uint8_t)(sizeof(captureBuffer) & 0xFF);
+			bResponse[4] = (uint8_t)((sizeof(captureBuffer) >> 8) & 0xFF);
+			bResponse[5] = (uint8_t)(currentSettings.capture.postTrigger & 0xFF);
+			bResponse[6] = (uint8_t)((currentSettings.capture.postTrigger >> 8) & 0xFF);
+			bResponse[7] = (uint8_t)(validSamples & 0xFF);
+			bResponse[8] = (uint8_t)((validSamples >> 8) & 0xFF);
+			bResponse[9] = (uint8_t)(triggerIndex & 0xFF);
+			bResponse[10] = (uint8_t)((triggerIndex >> 8) & 0xFF);
+			i2cTransmitPacket(bResponse, i2cCmd_GetCaptureStatus, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_SetCaptureConfig:
+		{
+			if(dwMessageSize < 4) {
+				break; /* Invalid message */
+			}
+			uint16_t newPostTrigger = ((uint16_t)lpRingbuffer[dwBase + 2]) | (((uint16_t)lpRingbuffer[dwBase + 3]) << 8);
+
+			if(newPostTrigger >= CAPTURE_SLOTS) {
+				break; /* Invalid message - the trigger sample would be overwritten */
+			}
+
+			currentSettings.capture.postTrigger = newPostTrigger;
+			break;
+		}
+		case i2cCmd_ArmCapture:
+		{
+			if(dwMessageSize < 3) {
+				break; /* Invalid message */
+			}
+			if(streamActive) {
+				break; /* Capture buffer is in use by the sample stream */
+			}
+			captureArm(lpRingbuffer[dwBase + 2] != 0);
+			break;
+		}
+		case i2cCmd_ReadCapture:
+		{
+			if(dwMessageSize < 5) {
+				break; /* Invalid message */
+			}
+			uint16_t offset = ((uint16_t)lpRingbuffer[dwBase + 2]) | (((uint16_t)lpRingbuffer[dwBase + 3]) << 8);
+			uint8_t bCount = lpRingbuffer[dwBase + 4];
+			uint8_t bResponse[3+CAPTURE_CHUNK_MAX*2];
+			uint8_t i;
+
+			if(bCount > CAPTURE_CHUNK_MAX) { bCount = CAPTURE_CHUNK_MAX; }
+			bCount = captureRead(offset, bCount, &(bResponse[3]));
+
+			bResponse[0] = (uint8_t)(offset & 0xFF);
+			bResponse[1] = (uint8_t)((offset >> 8) & 0xFF);
+			bResponse[2] = bCount;
+			for(i = 3+2*bCount; i < sizeof(bResponse); i=i+1) {
+				bResponse[i] = 0;
+			}
+			i2cTransmitPacket(bResponse, i2cCmd_ReadCapture, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_GetTelemetry:
+		{
+			uint8_t bResponse[1+TELEMETRY_COUNTERS*4];
+			uint8_t i;
+
+			bResponse[0] = TELEMETRY_COUNTERS;
+			for(i = 0; i < TELEMETRY_COUNTERS; i=i+1) {
+				uint32_t dwCounter = telemetryRead(i);
+
+				bResponse[1+4*i] = (uint8_t)(dwCounter & 0xFF);
+				bResponse[2+4*i] = (uint8_t)((dwCounter >> 8) & 0xFF);
+				bResponse[3+4*i] = (uint8_t)((dwCounter >> 16) & 0xFF);
+				bResponse[4+4*i] = (uint8_t)((dwCounter >> 24) & 0xFF);
+			}
+			i2cTransmitPacket(bResponse, i2cCmd_GetTelemetry, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_ResetTelemetry:
+			telemetryReset();
+			break;
+		case i2cCmd_GetQualifier:
+		{
+			uint8_t bResponse[4];
+			bResponse[0] = currentSettings.qualifier.bReleasePercent;
+			bResponse[1] = currentSettings.qualifier.bMinSamples;
+			bResponse[2] = currentSettings.qualifier.bMinChannels;
+			bResponse[3] = currentSettings.qualifier.bCoincidenceWindow;
+			i2cTransmitPacket(bResponse, i2cCmd_GetQualifier, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_SetQualifier:
+		{
+			if(dwMessageSize < 5) {
+				break; /* Invalid message */
+			}
+			uint8_t newReleasePercent = lpRingbuffer[dwBase + 2];
+			uint8_t newMinSamples = lpRingbuffer[dwBase + 3];
+			uint8_t newMinChannels = lpRingbuffer[dwBase + 4];
+			uint8_t newWindow = (dwMessageSize >= 6) ? lpRingbuffer[dwBase + 5] : 0; /* Optional, older hosts send three bytes */
+
+			if((newReleasePercent < 1) || (newReleasePercent > 100)) {
+				break; /* Invalid message */
+			}
+			if(newMinSamples < 1) {
+				break; /* Invalid message */
+			}
+			if((newMinChannels < 1) || (newMinChannels > 4)) {
+				break; /* Invalid message */
+			}
+
+			currentSettings.qualifier.bReleasePercent = newReleasePercent;
+			currentSettings.qualifier.bMinSamples = newMinSamples;
+			currentSettings.qualifier.bMinChannels = newMinChannels;
+			currentSettings.qualifier.bCoincidenceWindow = newWindow;
+			adcApplySettings();
+			break;
+		}
+		case i2cCmd_GetTuningProfiles:
+		{
+			uint8_t bResponse[3];
+			bResponse[0] = JOURNAL_PROFILES;
+			bResponse[1] = journalProfilesValid();
+			bResponse[2] = activeTuningProfile;
+			i2cTransmitPacket(bResponse, i2cCmd_GetTuningProfiles, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_SaveTuningProfile:
+		{
+			if(dwMessageSize < 3) {
+				break; /* Invalid message */
+			}
+			uint8_t bProfile = lpRingbuffer[dwBase + 2];
+			if(bProfile >= JOURNAL_PROFILES) {
+				break; /* Invalid message */
+			}
+
+			eepromSnapshot();
+			if(!journalProfileSave(bProfile, &currentSettings)) {
+				break; /* Another profile is still being written - the host waits for an idle store first */
+			}
+			activeTuningProfile = bProfile;
+			break;
+		}
+		case i2cCmd_ActivateTuningProfile:
+		{
+			if(dwMessageSize < 3) {
+				break; /* Invalid message */
+			}
+			uint8_t bProfile = lpRingbuffer[dwBase + 2];
+			uint8_t bFlags = (dwMessageSize >= 4) ? lpRingbuffer[dwBase + 3] : 0;
+			if(bProfile >= JOURNAL_PROFILES) {
+				break; /* Invalid message */
+			}
+
+			/* All settings change at once, an empty slot leaves everything untouched */
+			if(!journalProfileLoad(bProfile, &currentSettings)) {
+				break;
+			}
+			activeTuningProfile = bProfile;
+			adcApplySettings();
+
+			/*
+				Use the centerline stored with the profile after a short
+				verification, without one the running calibration is kept
+			*/
+			adcRestoreCalibration();
+
+			if((bFlags & TUNINGPROFILE_FLAG__PERSIST) != 0) {
+				eepromSave();
+			}
+			break;
+		}
+		case i2cCmd_GetSettings:
+		{
+			uint8_t bResponse[SETTINGS_BLOCK_SIZE];
+
+			settingsBlockEncode(bResponse);
+			i2cTransmitPacket(bResponse, i2cCmd_GetSettings, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_SetSettings:
+		{
+			if(dwMessageSize < 2+SETTINGS_BLOCK_SIZE) {
+				break; /* Invalid message */
+			}
+
+			settingsBlockApply(lpRingbuffer, dwBase);
+			break;
+		}
+		case i2cCmd_SetStream:
+		{
+			if(dwMessageSize < 4) {
+				break; /* Invalid message */
+			}
+			if((lpRingbuffer[dwBase + 2] & (~STREAMFLAG__VALIDFLAGS)) != 0) {
+				break; /* Unknown flags */
+			}
+			if(lpRingbuffer[dwBase + 3] >= STREAM_ENCODING_COUNT) {
+				break; /* Unknown encoding */
+			}
+
+			streamEnable((lpRingbuffer[dwBase + 2] & STREAMFLAG__ENABLE) != 0, lpRingbuffer[dwBase + 3]);
+			break;
+		}
+		case i2cCmd_GetStreamStatus:
+		{
+			uint32_t dwDropped;
+			uint8_t bEncoding;
+			uint8_t bResponse[9];
+
+			bResponse[0] = streamStatus(&bEncoding, &dwDropped);
+			bResponse[1] = STREAM_BLOCK_BYTES;
+			bResponse[2] = streamBlockSamples(bEncoding);
+			bResponse[3] = STREAM_BLOCKS;
+			bResponse[4] = (uint8_t)(dwDropped & 0xFF);
+			bResponse[5] = (uint8_t)((dwDropped >> 8) & 0xFF);
+			bResponse[6] = (uint8_t)((dwDropped >> 16) & 0xFF);
+			bResponse[7] = (uint8_t)((dwDropped >> 24) & 0xFF);
+			bResponse[8] = bEncoding;
+			i2cTransmitPacket(bResponse, i2cCmd_GetStreamStatus, sizeof(bResponse));
+			break;
+		}
+		case i2cCmd_GetStoreStatus:
+		{
+			uint8_t bResponse[7];
+			uint16_t generation;
+			uint16_t recordsUsed;
+
+			bResponse[0] = (uint8_t)journalStatus(&generation, &recordsUsed);
+			bResponse[1] = (uint8_t)(generation & 0xFF);
+			bResponse[2] = (uint8_t)((generation >> 8) & 0xFF);
+			bResponse[3] = (uint8_t)(recordsUsed & 0xFF);
+			bResponse[4] = (uint8_t)((recordsUsed >> 8) & 0xFF);
+			bResponse[5] = (uint8_t)(JOURNAL_RECORDS & 0xFF);
+			bResponse[6] = (uint8_t)((JOURNAL_RECORDS >> 8) & 0xFF);
+			i2cTransmitPacket(bResponse, i2cCmd_GetStoreStatus, sizeof(bResponse));
+			break;
+		}
+		#if PIEZO_PROFILER
+			case i2cCmd_GetProfile:
+			{
+				if(dwMessageSize < 3) {
+					break; /* Invalid message */
+				}
+				uint8_t bSlot = lpRingbuffer[dwBase + 2];
+				struct profilerStatistics stat;
+				uint16_t meanCycles = 0;
+				uint8_t bResponse[11+PROFILER_BINS*2];
+				uint8_t i;
+
+				if(bSlot >= PROFILER_SLOTS) {
+					break; /* Invalid message */
+				}
+				profilerSnapshot(bSlot, &stat);
+				if(stat.dwCount != 0) {
+					meanCycles = (uint16_t)((stat.dwSum + (stat.dwCount >> 1)) / stat.dwCount);
+				} else {
+					stat.minCycles = 0;
+				}
+
+				bResponse[0] = bSlot;
+				bResponse[1] = (uint8_t)(stat.dwCount & 0xFF);
+				bResponse[2] = (uint8_t)((stat.dwCount >> 8) & 0xFF);
+				bResponse[3] = (uint8_t)((stat.dwCount >> 16) & 0xFF);
+				bResponse[4] = (uint8_t)((stat.dwCount >> 24) & 0xFF);
+				bResponse[5] = (uint8_t)(stat.minCycles & 0xFF);
+				bResponse[6] = (uint8_t)((stat.minCycles >> 8) & 0xFF);
+				bResponse[7] = (uint8_t)(meanCycles & 0xFF);
+				bResponse[8] = (uint8_t)((meanCycles >> 8) & 0xFF);
+				bResponse[9] = (uint8_t)(stat.maxCycles & 0xFF);
+				bResponse[10] = (uint8_t)((stat.maxCycles >> 8) & 0xFF);
+				for(i = 0; i < PROFILER_BINS; i=i+1) {
+					bResponse[11+2*i] = (uint8_t)(stat.histogram[i] & 0xFF);
+					bResponse[12+2*i] = (uint8_t)((stat.histogram[i] >> 8) & 0xFF);
+				}
+				i2cTransmitPacket(bResponse, i2cCmd_GetProfile, sizeof(bResponse));
+				break;
+			}
+			case i2cCmd_ResetProfile:
+				profilerReset();
+				break;
+		#endif
 		default:
 			/* Unknown operation - ignore */
 			break;
@@ -19,6 +19,68 @@
 #ifndef PIEZOBOARD_DEFAULT__DEBOUNCELENGTH
 	#define PIEZOBOARD_DEFAULT__DEBOUNCELENGTH 125
 #endif
+#ifndef PIEZOBOARD_DEFAULT__FILTERMODE
+	#define PIEZOBOARD_DEFAULT__FILTERMODE filterMode_MovingAverage
+#endif
+#ifndef PIEZOBOARD_DEFAULT__MEDIANWINDOW
+	#define PIEZOBOARD_DEFAULT__MEDIANWINDOW 5
+#endif
+#ifndef PIEZOBOARD_DEFAULT__DETECTORMODE
+	#define PIEZOBOARD_DEFAULT__DETECTORMODE detectorMode_Deviation
+#endif
+#ifndef PIEZOBOARD_DEFAULT__SLOPEDISTANCE
+	#define PIEZOBOARD_DEFAULT__SLOPEDISTANCE 2
+#endif
+#ifndef PIEZOBOARD_DEFAULT__SLOPETHRESHOLD
+	#define PIEZOBOARD_DEFAULT__SLOPETHRESHOLD 10
+#endif
+#ifndef PIEZOBOARD_DEFAULT__SAMPLERATE
+	#define PIEZOBOARD_DEFAULT__SAMPLERATE 0
+#endif
+#ifndef PIEZOBOARD_DEFAULT__ADCPRESCALER
+	#define PIEZOBOARD_DEFAULT__ADCPRESCALER 7
+#endif
+#ifndef PIEZOBOARD_DEFAULT__SAMPLINGFLAGS
+	#define PIEZOBOARD_DEFAULT__SAMPLINGFLAGS 0x00
+#endif
+#ifndef PIEZOBOARD_DEFAULT__ACTIVECHANNELS
+	#define PIEZOBOARD_DEFAULT__ACTIVECHANNELS 0x0F
+#endif
+
+#ifndef PIEZOBOARD_DEFAULT__BIQUADSTAGES
+	#define PIEZOBOARD_DEFAULT__BIQUADSTAGES 0
+#endif
+
+#ifndef PIEZOBOARD_DEFAULT__THRESHOLDMODE
+	#define PIEZOBOARD_DEFAULT__THRESHOLDMODE thresholdMode_Absolute
+#endif
+#ifndef PIEZOBOARD_DEFAULT__SIGMAFACTOR
+	#define PIEZOBOARD_DEFAULT__SIGMAFACTOR 50
+#endif
+
+#ifndef PIEZOBOARD_DEFAULT__TRACKSHIFT
+	#define PIEZOBOARD_DEFAULT__TRACKSHIFT 0
+#endif
+#ifndef PIEZOBOARD_DEFAULT__FREEZEMARGIN
+	#define PIEZOBOARD_DEFAULT__FREEZEMARGIN 50
+#endif
+
+#ifndef PIEZOBOARD_DEFAULT__CAPTUREPOSTTRIGGER
+	#define PIEZOBOARD_DEFAULT__CAPTUREPOSTTRIGGER 64
+#endif
+
+#ifndef PIEZOBOARD_DEFAULT__RELEASEPERCENT
+	#define PIEZOBOARD_DEFAULT__RELEASEPERCENT 100
+#endif
+#ifndef PIEZOBOARD_DEFAULT__MINSAMPLES
+	#define PIEZOBOARD_DEFAULT__MINSAMPLES 1
+#endif
+#ifndef PIEZOBOARD_DEFAULT__MINCHANNELS
+	#define PIEZOBOARD_DEFAULT__MINCHANNELS 1
+#endif
+#ifndef PIEZOBOARD_DEFAULT__COINCIDENCEWINDOW
+	#define PIEZOBOARD_DEFAULT__COINCIDENCEWINDOW 0
+#endif
 
 #ifdef __cplusplus
     extern "C" {
@@ -31,6 +93,40 @@ enum triggerMode {
 	triggerMode_PiezoOrCapacitive			= 0x03,		/* In case any probe is active trigger - piezo or external (default mode for failsafe fallback operation) */
 };
 
+enum filterMode {
+	filterMode_MovingAverage				= 0x00,		/* Exponentially weighted moving average controlled by alpha */
+	filterMode_RunningMedian				= 0x01,		/* Running median over the last medianWindow samples of each channel */
+};
+
+enum detectorMode {
+	detectorMode_Deviation					= 0x00,		/* Trigger when the filtered value deviates from the calibrated centerline */
+	detectorMode_Slope						= 0x01,		/* Trigger when the filtered value changes by more than slopeThreshold within slopeDistance samples */
+};
+
+enum thresholdMode {
+	thresholdMode_Absolute					= 0x00,		/* Deviation has to exceed thresholdFactor ADC counts */
+	thresholdMode_NoiseSigma				= 0x01,		/* Deviation has to exceed bSigmaFactor/10 standard deviations of the noise measured during calibration */
+};
+
+#define SAMPLINGFLAG__FAST8BIT					0x01		/* Left adjusted 8 bit readout (allows higher ADC clock) */
+#define SAMPLINGFLAG__VALIDFLAGS				(SAMPLINGFLAG__FAST8BIT)
+
+#define BIQUAD_STAGES_MAX						2			/* Cascaded biquad stages in front of the filter (see biquad.h) */
+
+#define SETTINGS_CALIBRATION_VALID				0xA5		/* Marks a stored calibration as usable for a warm start */
+
+/*
+	Settings block exchanged by i2cCmd_GetSettings and i2cCmd_SetSettings.
+	The layout id changes whenever fields are rearranged, the version when
+	the meaning or range of a field changes. Both have to match on writes
+*/
+#define SETTINGS_BLOCK_LAYOUT					0x01
+#define SETTINGS_BLOCK_VERSION					0x01
+#define SETTINGS_BLOCK_SIZE						(2+33+BIQUAD_STAGES_MAX*5*2)
+
+#define TUNINGPROFILE_NONE						0xFF		/* No tuning profile has been saved or activated since boot */
+#define TUNINGPROFILE_FLAG__PERSIST				0x01		/* Also store the activated profile as power up settings */
+
 struct eepromSettings {
 	enum triggerMode						trigMode;
 	struct {
@@ -39,12 +135,54 @@ struct eepromSettings {
 		uint32_t							dwInitSamples; 				/* Number of samples to use for centerline measurement */
 	} movingAverage;
 	uint16_t								debounceLength;
+	struct {
+		uint8_t								bFilterMode;				/* See enum filterMode */
+		uint8_t								bMedianWindow;				/* Number of samples per channel used by the running median */
+	} filter;
+	struct {
+		uint8_t								bDetectorMode;				/* See enum detectorMode */
+		uint8_t								bSlopeDistance;				/* Number of samples between the two compared values in slope mode */
+		uint16_t							slopeThreshold;				/* ADC counts the filtered value has to change within bSlopeDistance samples */
+	} detector;
+	struct {
+		uint16_t							sampleRate;					/* Samples per second and channel, 0 selects free running conversions */
+		uint8_t								bPrescaler;					/* ADC clock prescaler as ADPS value (1: /2, ..., 7: /128) */
+		uint8_t								bFlags;						/* SAMPLINGFLAG__ values */
+		uint8_t								bActiveChannels;			/* Bitmask of fitted piezo channels (bit 0: A0, ..., bit 3: A3) */
+	} sampling;
+	struct {
+		uint8_t								bThresholdMode;				/* See enum thresholdMode */
+		uint8_t								bSigmaFactor;				/* k in tenths of a standard deviation for thresholdMode_NoiseSigma */
+	} threshold;
+	struct {
+		uint8_t								bTrackShift;				/* Baseline tracker time constant as 2^n samples, 0 disables tracking */
+		uint8_t								bFreezeMargin;				/* Tracking pauses while the deviation exceeds this percentage of the threshold */
+	} baseline;
+	struct {
+		uint16_t							postTrigger;				/* Samples (all channels) recorded after the trigger, the rest of the capture buffer holds pre trigger samples */
+	} capture;
+	struct {
+		uint8_t								bReleasePercent;			/* A channel above threshold releases when the detector value drops to this percentage of the threshold */
+		uint8_t								bMinSamples;				/* Consecutive samples a channel has to stay above threshold to qualify */
+		uint8_t								bMinChannels;				/* Channel votes required to raise a piezo event */
+		uint8_t								bCoincidenceWindow;			/* Samples per channel a qualified channel keeps its vote, 0 requires the channels to be qualified at the same time */
+	} qualifier;
+	struct {
+		uint8_t								bStages;					/* Number of active biquad stages, 0 disables the stage */
+		int16_t								coefficients[BIQUAD_STAGES_MAX][5];	/* b0, b1, b2, a1, a2 of every stage in Q2.14 */
+	} biquad;
 
 	/*
 		Store also calibration settings so one doesn't have to recalibrate
-		every time - turns out to be reproducable anyways
+		every time - turns out to be reproducable anyways. Updated from the
+		live calibration whenever the settings are stored
 	*/
-	float 									movingAverageRefCenterline[4];
+	struct {
+		uint8_t								bValid;						/* SETTINGS_CALIBRATION_VALID if the block holds a calibration */
+		uint8_t								bActiveChannels;			/* Channel mask the calibration has been taken with */
+		int16_t								centerline[4];				/* Centerline in Q10.5 */
+		uint16_t							noiseSigma[4];				/* Noise standard deviation in Q10.5 */
+	} calibration;
 
 	/* These two have to be the last bytes */
 	uint8_t 								xorChecksum;				/* All previous bytes xor'ed */
@@ -0,0 +1,101 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <stdint.h>
+
+#include "./main.h"
+#include "./sysclk.h"
+#include "./profiler.h"
+
+#if PIEZO_PROFILER
+
+/*
+	Profiler storage, written from interrupt context and read with
+	interrupts disabled
+*/
+
+struct profilerStatistics profilerStatistics[PROFILER_SLOTS];
+
+void profilerReset() {
+	uint8_t i, j;
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	for(i = 0; i < PROFILER_SLOTS; i=i+1) {
+		profilerStatistics[i].dwCount = 0;
+		profilerStatistics[i].dwSum = 0;
+		profilerStatistics[i].minCycles = 0xFFFF;
+		profilerStatistics[i].maxCycles = 0;
+		for(j = 0; j < PROFILER_BINS; j=j+1) {
+			profilerStatistics[i].histogram[j] = 0;
+		}
+	}
+
+	SREG = sregOld;
+}
+
+void profilerSnapshot(uint8_t slot, struct profilerStatistics* lpOut) {
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	(*lpOut) = profilerStatistics[slot];
+
+	SREG = sregOld;
+}
+
+/*
+	Main loop passes easily exceed one Timer1 period (65536 cycles in normal
+	mode, only the sample period in CTC mode). The compare A and overflow
+	flags are not used otherwise (TIMSK1 is 0, the ADC auto trigger uses
+	compare B), so they are cleared at the start of a pass and tell whether
+	the counter wrapped. In that case micros() decides if it wrapped exactly
+	once - then the cycle counter difference is still exact - or the pass is
+	taken from micros() (4 us resolution) and saturated at 0xFFFF, which
+	ends up in the last histogram bin.
+*/
+#define PROFILER_TIFR1_WRAP					0x03		/* OCF1A and TOV1 */
+#define PROFILER_MICROS_SLACK				128			/* Cycles of uncertainty of two micros() readings */
+
+static unsigned long int profilerLoopMicros;
+
+uint16_t profilerLoopStart() {
+	uint16_t ts;
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	TIFR1 = PROFILER_TIFR1_WRAP;
+	ts = cycleCounterRead();
+	profilerLoopMicros = micros();
+
+	SREG = sregOld;
+	return ts;
+}
+
+void profilerLoopEnd(uint16_t tsStart) {
+	uint16_t cycles;
+	unsigned long int dwCycles;
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	cycles = cycleCounterElapsed(tsStart);
+	if((TIFR1 & PROFILER_TIFR1_WRAP) != 0) {
+		dwCycles = (micros() - profilerLoopMicros) * (F_CPU / 1000000L);
+		if((dwCycles + PROFILER_MICROS_SLACK) >= (((unsigned long int)cycleCounterTop) + 1)) {
+			/* Wrapped more than once (or close to it) */
+			cycles = (dwCycles > 0xFFFFUL) ? 0xFFFF : (uint16_t)dwCycles;
+		}
+	}
+	profilerRecord(profilerSlot_MainLoop, cycles);
+
+	SREG = sregOld;
+}
+
+#endif
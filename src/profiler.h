@@ -0,0 +1,113 @@
+#ifndef __is_included__c7d2e94a_ca9b_11f1_84e6_02fc00000001
+#define __is_included__c7d2e94a_ca9b_11f1_84e6_02fc00000001 1
+
+/*
+	Cycle budget profiler
+
+	Optional instrumentation that measures how many CPU cycles the ADC
+	interrupt, the TWI interrupt and one iteration of the main loop take
+	(Timer1 cycle counter, see sysclk.h). For every slot minimum, mean and
+	maximum are kept together with a log2 histogram. The measurement starts
+	after the interrupt prologue, so the register save and restore done by
+	the compiler (roughly 30-60 cycles) is not included. Main loop
+	iterations include the time spent in interrupts that preempted them;
+	iterations longer than 65535 cycles are recorded as 0xFFFF (last bin).
+
+	Only compiled in when the firmware is built with PIEZO_PROFILER=1
+	(make PROFILER=1) - release builds do not contain any of the code or
+	the RAM and do not answer the profiler opcodes.
+
+	Requires main.h and sysclk.h to be included before.
+*/
+
+#ifndef PIEZO_PROFILER
+	#define PIEZO_PROFILER					0
+#endif
+
+#define PROFILER_SLOTS						3
+#define PROFILER_BINS						10
+#define PROFILER_BIN_SHIFT					6			/* Bin 0 counts runs below 2^6 cycles, bin n runs from 2^(n+5) to 2^(n+6)-1, the last bin everything above */
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+enum profilerSlot {
+	profilerSlot_AdcInterrupt				= 0x00,
+	profilerSlot_TwiInterrupt				= 0x01,
+	profilerSlot_MainLoop					= 0x02,
+};
+
+#if PIEZO_PROFILER
+	struct profilerStatistics {
+		uint32_t							dwCount;
+		uint32_t							dwSum;
+		uint16_t							minCycles;
+		uint16_t							maxCycles;
+		uint16_t							histogram[PROFILER_BINS];
+	};
+
+	extern struct profilerStatistics profilerStatistics[PROFILER_SLOTS];
+
+	/*@
+		assigns profilerStatistics[0..PROFILER_SLOTS-1];
+	*/
+	void profilerReset();
+
+	/*@
+		requires slot < PROFILER_SLOTS;
+		requires \valid(lpOut);
+		assigns *lpOut;
+	*/
+	void profilerSnapshot(uint8_t slot, struct profilerStatistics* lpOut);
+
+	/*
+		Start and end of a main loop iteration (Timer1 has to be read with
+		interrupts disabled outside of interrupt context)
+	*/
+	uint16_t profilerLoopStart();
+	void profilerLoopEnd(uint16_t tsStart);
+
+	/*
+		Accounts one run of cycles to the given slot. Has to be called with
+		interrupts disabled or from interrupt context
+	*/
+	static inline void profilerRecord(uint8_t slot, uint16_t cycles) {
+		struct profilerStatistics* lpStat = &(profilerStatistics[slot]);
+		uint16_t bucket = cycles >> PROFILER_BIN_SHIFT;
+		uint8_t bin = 0;
+		uint8_t i;
+
+		while((bucket != 0) && (bin < (PROFILER_BINS - 1))) {
+			bucket = bucket >> 1;
+			bin = bin + 1;
+		}
+
+		/*
+			Counters are halved instead of saturating so mean and histogram
+			shape stay meaningful during long runs
+		*/
+		if(lpStat->histogram[bin] == 0xFFFF) {
+			for(i = 0; i < PROFILER_BINS; i=i+1) {
+				lpStat->histogram[i] = lpStat->histogram[i] >> 1;
+			}
+		}
+		lpStat->histogram[bin] = lpStat->histogram[bin] + 1;
+
+		if(lpStat->dwSum > (0xFFFFFFFFUL - cycles)) {
+			lpStat->dwSum = lpStat->dwSum >> 1;
+			lpStat->dwCount = lpStat->dwCount >> 1;
+		}
+		lpStat->dwSum = lpStat->dwSum + cycles;
+		lpStat->dwCount = lpStat->dwCount + 1;
+
+		if(cycles < lpStat->minCycles) { lpStat->minCycles = cycles; }
+		if(cycles > lpStat->maxCycles) { lpStat->maxCycles = cycles; }
+	}
+#endif
+
+#ifdef __cplusplus
+	} /* extern "C" { */
+#endif
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef __is_included__4e1b7c90_cc21_11f1_b3e8_02fc00000001
+#define __is_included__4e1b7c90_cc21_11f1_b3e8_02fc00000001 1
+
+/*
+	Smoothing in front of the detector
+
+	Fixed point exponential moving average and running median as run by
+	the ADC interrupt. Inputs and outputs are Q10.5 (see ADC_Q_SHIFT),
+	alpha is Q0.12 (see ADC_ALPHA_SHIFT). The accumulator keeps 16
+	fractional bits so small alpha values do not stall on rounding.
+
+	The running median keeps the last samples in arrival order (to know
+	which one leaves the window) and the same samples in sorted order.
+	Each new sample removes the oldest value from the sorted array and
+	inserts the new one - both by shifting, so a sample costs O(window)
+	integer compares and moves.
+
+	This header is shared between the firmware (ADC interrupt) and the
+	host side filter harness so both run exactly the same arithmetic.
+	Requires stdint.h and adc.h to be included before.
+*/
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*
+	Sets the accumulator to a Q10.5 value (i.e. the centerline after
+	a calibration)
+*/
+static inline int32_t smoothingAverageReset(int16_t value) {
+	return ((int32_t)value) << (16 - ADC_Q_SHIFT);
+}
+
+/*@
+	requires \valid(lpAccu);
+	requires alphaQ <= ADC_ALPHA_ONE;
+	assigns *lpAccu;
+*/
+static inline int16_t smoothingAverageUpdate(
+	int32_t* lpAccu,
+	uint16_t alphaQ,
+	int16_t input
+) {
+	if(alphaQ >= ADC_ALPHA_ONE) {
+		(*lpAccu) = smoothingAverageReset(input);
+	} else {
+		int32_t delta = smoothingAverageReset(input) - (*lpAccu);
+		(*lpAccu) = (*lpAccu) + (delta >> ADC_ALPHA_SHIFT) * (int32_t)alphaQ;
+	}
+	return (int16_t)(((*lpAccu) + (1L << (15 - ADC_Q_SHIFT))) >> (16 - ADC_Q_SHIFT));
+}
+
+/*
+	lpHistory and lpSorted hold bWindow values each, *lpFill and *lpPos
+	have to start at 0 (and be reset together with a changed bWindow)
+*/
+/*@
+	requires (bWindow >= 1) && (bWindow <= ADC_MEDIAN_WINDOW_MAX);
+	requires \valid(lpHistory + (0 .. bWindow-1)) && \valid(lpSorted + (0 .. bWindow-1));
+	requires \valid(lpFill) && \valid(lpPos);
+	requires (*lpFill <= bWindow) && (*lpPos < bWindow);
+*/
+static inline int16_t smoothingMedianUpdate(
+	int16_t* lpHistory,
+	int16_t* lpSorted,
+	uint8_t* lpFill,
+	uint8_t* lpPos,
+	uint8_t bWindow,
+	int16_t value
+) {
+	uint8_t fill = (*lpFill);
+	uint8_t pos = (*lpPos);
+	uint8_t i;
+
+	if(fill == bWindow) {
+		/* Window is full - drop the oldest value from the sorted array */
+		int16_t oldValue = lpHistory[pos];
+		for(i = 0; (i < fill-1) && (lpSorted[i] != oldValue); i=i+1) { }
+		for(; i < fill-1; i=i+1) {
+			lpSorted[i] = lpSorted[i+1];
+		}
+		fill = fill - 1;
+	}
+
+	lpHistory[pos] = value;
+	pos = pos + 1;
+	if(pos >= bWindow) { pos = 0; }
+
+	/* Insertion step */
+	i = fill;
+	while((i > 0) && (lpSorted[i-1] > value)) {
+		lpSorted[i] = lpSorted[i-1];
+		i = i - 1;
+	}
+	lpSorted[i] = value;
+	fill = fill + 1;
+
+	(*lpFill) = fill;
+	(*lpPos) = pos;
+
+	return lpSorted[fill >> 1];
+}
+
+#ifdef __cplusplus
+	} /* extern "C" { */
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <stdint.h>
+
+#include "./main.h"
+#include "./capture.h"
+#include "./stream.h"
+
+/*
+	Sample streaming state
+
+	Blocks are written by the ADC interrupt and released by the TWI
+	interrupt. Both do not nest so only the main loop functions below have
+	to disable interrupts while they touch the shared state.
+*/
+
+volatile bool streamActive = false;
+volatile uint8_t streamBlocksReady = 0;
+uint8_t streamWriteBlock = 0;
+uint8_t streamWritePos = 0;
+uint8_t streamReadBlock = 0;
+uint8_t streamSequence = 0;
+bool streamOverflow = false;
+uint32_t streamDroppedSamples = 0;
+uint8_t streamEncoding = STREAM_ENCODING_RAW;
+uint8_t streamWriteNibble = 0;
+uint8_t streamBlockMask = 0;
+uint8_t streamExpectedChannel = 0;
+uint8_t streamPreviousValid = 0;
+uint16_t streamPrevious[4];
+
+void streamEnable(bool bEnable, uint8_t bEncoding) {
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	streamBlocksReady = 0;
+	streamWriteBlock = 0;
+	streamWritePos = 0;
+	streamReadBlock = 0;
+	streamOverflow = false;
+	streamWriteNibble = 0;
+	streamPreviousValid = 0;
+
+	if(bEnable) {
+		if(!streamActive) {
+			streamSequence = 0;
+			streamDroppedSamples = 0;
+		}
+		captureState = captureState_Disabled;
+		streamEncoding = bEncoding;
+		streamActive = true;
+	} else if(streamActive) {
+		streamActive = false;
+		captureArm(false);
+	}
+
+	SREG = sregOld;
+}
+
+/*@
+	requires \valid(lpEncoding);
+	requires \valid(lpDroppedSamples);
+	assigns *lpEncoding, *lpDroppedSamples;
+*/
+uint8_t streamStatus(uint8_t* lpEncoding, uint32_t* lpDroppedSamples) {
+	uint8_t bFlags;
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	bFlags = streamActive ? STREAMFLAG__ENABLE : 0;
+	(*lpEncoding) = streamEncoding;
+	(*lpDroppedSamples) = streamDroppedSamples;
+
+	SREG = sregOld;
+	return bFlags;
+}
+
+uint8_t streamBlockSamples(uint8_t bEncoding) {
+	switch(bEncoding) {
+		case STREAM_ENCODING_PACKED10:		return STREAM_PACKED10_SAMPLES;
+		case STREAM_ENCODING_DELTA:			return STREAM_SAMPLES_MAX;
+		default:							return STREAM_BLOCK_SAMPLES;
+	}
+}
@@ -0,0 +1,252 @@
+#ifndef __is_included__32bf86da_ca7b_11f1_a6d6_02fc00000001
+#define __is_included__32bf86da_ca7b_11f1_a6d6_02fc00000001 1
+
+/*
+	Sample streaming
+
+	While streaming is enabled every raw sample (all active channels in
+	conversion order) is packed into fixed size blocks. Streaming and the
+	waveform capture are exclusive - the blocks live in the capture buffer
+	which is disabled meanwhile, so streaming costs no additional RAM.
+
+	The host selects stream mode by writing the single byte
+	I2C_STREAM_SELECT and drains complete blocks with bulk reads of any
+	multiple of STREAM_BLOCK_BYTES. Every block starts with
+
+		+0		STREAM_BLOCKFLAG__ flags and the stream encoding
+		+1		Sequence number (incremented with every stored block)
+
+	The rest of the block depends on the encoding selected when streaming
+	has been enabled:
+
+		STREAM_ENCODING_RAW
+			+2 ...	STREAM_BLOCK_SAMPLES samples, 16 bit little endian with
+					the channel in the upper bits like the capture buffer
+
+		STREAM_ENCODING_PACKED10 and STREAM_ENCODING_DELTA
+			+2		Number of samples in the block
+			+3		Channel of the first sample (bits 0-1) and the active
+					channel mask (bits 4-7). The channel of every further
+					sample is the next active one in ascending order
+			+4 ...	Payload
+
+	Packed blocks hold groups of 4 samples in 5 bytes: the low 8 bits of
+	the four samples followed by a byte holding the upper 2 bits of sample
+	k at bit 2k. Delta blocks are a sequence of nibbles (low nibble of a
+	byte first). A nibble in -7 ... 7 (two's complement) is the difference
+	to the previous sample of the same channel, STREAM_DELTA_ESCAPE is
+	followed by the absolute value in three nibbles (lowest first). The
+	first sample of every channel in a block is always absolute so blocks
+	can be decoded independently. A block is closed early if the channel
+	sequence restarts (sampling has been reconfigured).
+
+	If no complete block is available when the host starts reading a
+	block an empty block (all zero, no VALID flag) is returned instead.
+	A block is only released after its last byte has been read, a block
+	interrupted by the end of a read is sent again on the next read.
+
+	When all blocks are waiting for the host samples are dropped and the
+	next stored block carries STREAM_BLOCKFLAG__OVERFLOW.
+
+	Requires main.h and capture.h to be included before.
+*/
+
+#define STREAM_BLOCK_SAMPLES				16
+#define STREAM_BLOCK_WORDS					(STREAM_BLOCK_SAMPLES+1)		/* Header word and samples */
+#define STREAM_BLOCK_BYTES					(2*STREAM_BLOCK_WORDS)
+#define STREAM_BLOCKS						(CAPTURE_SLOTS / STREAM_BLOCK_WORDS)
+
+#if STREAM_BLOCKS < 2
+	#error Capture buffer too small to hold at least two stream blocks
+#endif
+
+#define STREAM_HEADER_BYTES					4			/* Header of compact encodings */
+#define STREAM_PAYLOAD_BYTES				(STREAM_BLOCK_BYTES-STREAM_HEADER_BYTES)
+#define STREAM_PACKED10_SAMPLES				((STREAM_PAYLOAD_BYTES/5)*4)
+#define STREAM_DELTA_NIBBLES				(2*STREAM_PAYLOAD_BYTES)
+#define STREAM_DELTA_ESCAPE					0x08
+#define STREAM_SAMPLES_MAX					STREAM_DELTA_NIBBLES		/* Upper bound of samples per block for any encoding */
+
+#define STREAM_BLOCKFLAG__VALID				0x80
+#define STREAM_BLOCKFLAG__OVERFLOW			0x40		/* Samples have been dropped in front of this block */
+#define STREAM_BLOCKFLAG__ENCODING			0x03		/* Mask of the encoding of this block */
+
+#define STREAM_ENCODING_RAW					0x00		/* 16 bit samples tagged with the channel */
+#define STREAM_ENCODING_PACKED10			0x01		/* 10 bit samples, 4 samples in 5 bytes */
+#define STREAM_ENCODING_DELTA				0x02		/* Nibble deltas to the previous sample of the channel */
+#define STREAM_ENCODING_COUNT				0x03
+
+#define STREAMFLAG__ENABLE					0x01
+#define STREAMFLAG__VALIDFLAGS				(STREAMFLAG__ENABLE)
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+extern volatile bool streamActive;
+extern volatile uint8_t streamBlocksReady;			/* Complete blocks not yet read by the host */
+extern uint8_t streamWriteBlock;
+extern uint8_t streamWritePos;
+extern uint8_t streamReadBlock;
+extern uint8_t streamSequence;
+extern bool streamOverflow;
+extern uint32_t streamDroppedSamples;
+extern uint8_t streamEncoding;
+extern uint8_t streamWriteNibble;
+extern uint8_t streamBlockMask;
+extern uint8_t streamExpectedChannel;
+extern uint8_t streamPreviousValid;
+extern uint16_t streamPrevious[4];
+
+/*
+	Starts or stops streaming with one of the STREAM_ENCODING_ values.
+	Starting disables the capture (and discards its window), stopping
+	re-arms it
+*/
+void streamEnable(bool bEnable, uint8_t bEncoding);
+
+/*@
+	requires \valid(lpEncoding);
+	requires \valid(lpDroppedSamples);
+	assigns *lpEncoding, *lpDroppedSamples;
+*/
+uint8_t streamStatus(uint8_t* lpEncoding, uint32_t* lpDroppedSamples);
+
+/*
+	Samples a block of the given encoding holds at most
+*/
+uint8_t streamBlockSamples(uint8_t bEncoding);
+
+static inline void streamCloseBlock(uint8_t* lpBlock) {
+	lpBlock[0] = STREAM_BLOCKFLAG__VALID | (streamOverflow ? STREAM_BLOCKFLAG__OVERFLOW : 0) | streamEncoding;
+	lpBlock[1] = streamSequence;
+	if(streamEncoding != STREAM_ENCODING_RAW) {
+		lpBlock[2] = streamWritePos;
+	}
+
+	streamSequence = streamSequence + 1;
+	streamOverflow = false;
+	streamWritePos = 0;
+	streamWriteBlock = streamWriteBlock + 1;
+	if(streamWriteBlock >= STREAM_BLOCKS) { streamWriteBlock = 0; }
+	streamBlocksReady = streamBlocksReady + 1;
+}
+
+static inline void streamPutNibble(uint8_t* lpBlock, uint8_t bNibble) {
+	uint8_t idx = STREAM_HEADER_BYTES + (streamWriteNibble >> 1);
+
+	if((streamWriteNibble & 0x01) == 0) {
+		lpBlock[idx] = bNibble;
+	} else {
+		lpBlock[idx] = lpBlock[idx] | (bNibble << 4);
+	}
+	streamWriteNibble = streamWriteNibble + 1;
+}
+
+/*
+	Called from the ADC interrupt for every raw sample. bChannelMask is
+	the active channel mask and bNextChannel the channel the following
+	sample is expected from. The compact encodings only cost a few shifts
+	per sample, there are no per block passes
+*/
+static inline void streamStore(uint8_t channel, uint16_t sample, uint8_t bChannelMask, uint8_t bNextChannel) {
+	uint8_t* lpBlock;
+	bool bFull;
+
+	if(!streamActive) {
+		return;
+	}
+
+	lpBlock = ((uint8_t*)captureBuffer) + ((uint16_t)streamWriteBlock) * STREAM_BLOCK_BYTES;
+
+	if((streamWritePos != 0) && (streamEncoding != STREAM_ENCODING_RAW)) {
+		if((channel != streamExpectedChannel) || (bChannelMask != streamBlockMask)) {
+			/* Channel sequence restarted - the host could not derive the channels anymore */
+			streamCloseBlock(lpBlock);
+			lpBlock = ((uint8_t*)captureBuffer) + ((uint16_t)streamWriteBlock) * STREAM_BLOCK_BYTES;
+		}
+	}
+
+	if((streamWritePos == 0) && (streamBlocksReady >= STREAM_BLOCKS)) {
+		/* No free block - the host does not keep up */
+		streamOverflow = true;
+		streamDroppedSamples = streamDroppedSamples + 1;
+		return;
+	}
+
+	if((streamWritePos == 0) && (streamEncoding != STREAM_ENCODING_RAW)) {
+		lpBlock[3] = channel | (bChannelMask << 4);
+		streamBlockMask = bChannelMask;
+		streamWriteNibble = 0;
+		streamPreviousValid = 0;
+	}
+	streamExpectedChannel = bNextChannel;
+
+	if(streamEncoding == STREAM_ENCODING_PACKED10) {
+		uint8_t idx = STREAM_HEADER_BYTES + (streamWritePos >> 2) * 5;
+		uint8_t k = streamWritePos & 0x03;
+
+		lpBlock[idx + k] = (uint8_t)(sample & 0xFF);
+		if(k == 0) {
+			lpBlock[idx + 4] = (uint8_t)((sample >> 8) & 0x03);
+		} else {
+			lpBlock[idx + 4] = lpBlock[idx + 4] | (uint8_t)(((sample >> 8) & 0x03) << (2*k));
+		}
+		streamWritePos = streamWritePos + 1;
+		bFull = (streamWritePos == STREAM_PACKED10_SAMPLES) ? true : false;
+	} else if(streamEncoding == STREAM_ENCODING_DELTA) {
+		int16_t delta = (int16_t)(sample - streamPrevious[channel]);
+
+		if(((streamPreviousValid & (1 << channel)) != 0) && (delta >= -7) && (delta <= 7)) {
+			streamPutNibble(lpBlock, (uint8_t)(delta & 0x0F));
+		} else {
+			streamPutNibble(lpBlock, STREAM_DELTA_ESCAPE);
+			streamPutNibble(lpBlock, (uint8_t)(sample & 0x0F));
+			streamPutNibble(lpBlock, (uint8_t)((sample >> 4) & 0x0F));
+			streamPutNibble(lpBlock, (uint8_t)((sample >> 8) & 0x0F));
+			streamPreviousValid = streamPreviousValid | (1 << channel);
+		}
+		streamPrevious[channel] = sample;
+		streamWritePos = streamWritePos + 1;
+		bFull = (streamWriteNibble > (STREAM_DELTA_NIBBLES - 4)) ? true : false; /* No room for an absolute value */
+	} else {
+		((uint16_t*)lpBlock)[1 + streamWritePos] = sample | (((uint16_t)channel) << CAPTURE_CHANNEL_SHIFT);
+		streamWritePos = streamWritePos + 1;
+		bFull = (streamWritePos == STREAM_BLOCK_SAMPLES) ? true : false;
+	}
+
+	if(bFull) {
+		streamCloseBlock(lpBlock);
+	}
+}
+
+/*
+	Called from the TWI interrupt for every byte the host reads in stream
+	mode. bPos is the byte position inside the block, the caller restarts
+	it at 0 with every read transaction. Returns the byte to transmit and
+	releases the block after its last byte
+*/
+static inline uint8_t streamTransmit(uint8_t bPos, bool* lpFiller) {
+	uint8_t r;
+
+	if(bPos == 0) {
+		(*lpFiller) = (streamBlocksReady == 0) ? true : false;
+	}
+	if(*lpFiller) {
+		return 0x00;
+	}
+
+	r = ((uint8_t*)captureBuffer)[((uint16_t)streamReadBlock) * STREAM_BLOCK_BYTES + bPos];
+	if(bPos == (STREAM_BLOCK_BYTES - 1)) {
+		streamReadBlock = streamReadBlock + 1;
+		if(streamReadBlock >= STREAM_BLOCKS) { streamReadBlock = 0; }
+		streamBlocksReady = streamBlocksReady - 1;
+	}
+	return r;
+}
+
+#ifdef __cplusplus
+	} /* extern "C" { */
+#endif
+
+#endif
@@ -217,6 +217,45 @@ void systickDisable() {
 	TIMSK0 = 0x00;
 }
 
+volatile uint16_t cycleCounterTop = 0xFFFF;
+
+void cycleCounterInit() {
+	uint8_t sregOld = SREG;
+
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	PRR = PRR & (~0x08);
+
+	TCCR1A = 0x00;		/* Normal mode, no output compare pins */
+	TCCR1B = 0x01;		/* No prescaler */
+	TIMSK1 = 0x00;		/* No interrupts - we only read TCNT1 */
+	cycleCounterTop = 0xFFFF;
+
+	SREG = sregOld;
+}
+
+void cycleCounterSetPeriod(uint16_t top) {
+	uint8_t sregOld = SREG;
+
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	if(top == 0xFFFF) {
+		TCCR1B = 0x01;		/* Normal mode, no prescaler */
+	} else {
+		OCR1A = top;
+		OCR1B = top;
+		TCNT1 = 0;
+		TCCR1B = 0x09;		/* CTC mode with TOP = OCR1A, no prescaler */
+	}
+	cycleCounterTop = top;
+
+	SREG = sregOld;
+}
+
 #ifdef __cplusplus
 	} /* extern "C" { */
 #endif
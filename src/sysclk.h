@@ -1,3 +1,6 @@
+#ifndef __is_included__74ce0dea_ca75_11f1_8061_02fc00000001
+#define __is_included__74ce0dea_ca75_11f1_8061_02fc00000001 1
+
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <math.h>
@@ -61,6 +64,64 @@ void delay(unsigned long millisecs);
 */
 void delayMicros(unsigned int microDelay);
 
+/*
+	Cycle counter
+
+	Timer1 runs without prescaler and is used as a free running 16 bit
+	cycle counter for latency measurements. Differences are valid as long
+	as the measured interval is shorter than one Timer1 period - 65536
+	cycles (4 ms at 16 MHz) in normal mode, the sample period in CTC mode
+*/
+
+/*@
+	requires \valid(&SREG);
+	assigns SREG;
+	assigns TCCR1A;
+	assigns TCCR1B;
+	assigns TIMSK1;
+*/
+void cycleCounterInit();
+
+/*
+	Changes the period of Timer1. Passing 0xFFFF selects free running
+	normal mode, any other value selects CTC mode with the given TOP value.
+	OCR1B matches at TOP too so the compare B event can be used as ADC
+	auto trigger source. The counter keeps running at F_CPU in both cases.
+*/
+/*@
+	requires \valid(&SREG);
+	assigns SREG;
+	assigns TCCR1A, TCCR1B, OCR1A, OCR1B, TCNT1;
+	assigns cycleCounterTop;
+	ensures cycleCounterTop == top;
+*/
+void cycleCounterSetPeriod(uint16_t top);
+
+extern volatile uint16_t cycleCounterTop;
+
+/*
+	Has to be called with interrupts disabled (i.e. from an ISR)
+	since the 16 bit read uses the shared TEMP register
+*/
+static inline uint16_t cycleCounterRead() {
+	return TCNT1;
+}
+
+/*
+	Cycles since tsStart, taking the current Timer1 period into account
+	(same restrictions as cycleCounterRead)
+*/
+static inline uint16_t cycleCounterElapsed(uint16_t tsStart) {
+	uint16_t tsNow = TCNT1;
+
+	if(tsNow >= tsStart) {
+		return tsNow - tsStart;
+	}
+	return (cycleCounterTop - tsStart) + tsNow + 1;
+}
+
 #ifdef __cplusplus
 	} /* extern "C" { */
 #endif
+
+#endif
@@ -0,0 +1,45 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <stdint.h>
+
+#include "./main.h"
+#include "./telemetry.h"
+
+/*
+	Telemetry counter storage
+
+	Counters are incremented in place by the modules that observe the
+	events. Reads and reset disable interrupts so the 32 bit values are
+	never torn.
+*/
+
+struct telemetryCounters telemetryCounters;
+
+uint32_t telemetryRead(uint8_t bIndex) {
+	uint32_t dwValue;
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	dwValue = ((uint32_t*)(&telemetryCounters))[bIndex];
+
+	SREG = sregOld;
+	return dwValue;
+}
+
+void telemetryReset() {
+	uint8_t i;
+	uint8_t* lpCounters = (uint8_t*)(&telemetryCounters);
+	uint8_t sregOld = SREG;
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	for(i = 0; i < sizeof(telemetryCounters); i=i+1) {
+		lpCounters[i] = 0;
+	}
+
+	SREG = sregOld;
+}
@@ -0,0 +1,58 @@
+#ifndef __is_included__a41f6c02_ca93_11f1_9b57_02fc00000001
+#define __is_included__a41f6c02_ca93_11f1_9b57_02fc00000001 1
+
+/*
+	Telemetry counters
+
+	A block of free running 32 bit counters that are incremented directly
+	in the code paths where the event happens (most of them in interrupt
+	context) and are read out as one packet over I2C. They allow one to
+	decide after the fact if a bad probe was caused by noise, bus trouble
+	or missed samples. Counters wrap around and are only cleared on reset
+	or by an explicit reset command.
+
+	Requires main.h to be included before.
+*/
+
+#define TELEMETRY_COUNTERS					13			/* Number of 32 bit counters in struct telemetryCounters */
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+struct telemetryCounters {
+	uint32_t								dwTriggers[4];				/* Output assertions, indexed by the active trigger mode */
+	uint32_t								dwDebounceSuppressed;		/* Piezo detections ignored while the output was asserted */
+	uint32_t								dwRxOverflows;				/* Frames dropped because all I2C frame slots were busy */
+	uint32_t								dwChecksumErrors;			/* Received packets dropped due to checksum mismatch */
+	uint32_t								dwResyncs;					/* Garbage skipped while searching for the sync pattern or truncated frames */
+	uint32_t								dwTxUnderruns;				/* Bytes requested by the master with an empty transmit ring */
+	uint32_t								dwBusErrors;				/* TWI bus errors */
+	uint32_t								dwCalibrations;				/* Completed centerline calibrations */
+	uint32_t								dwAdcOverruns;				/* ADC interrupts that took longer than a conversion */
+	uint32_t								dwTxRejected;				/* Responses discarded because they did not fit the transmit ring */
+};
+
+extern struct telemetryCounters telemetryCounters;
+
+/*
+	Reads counter bIndex (in declaration order) without tearing it. The
+	counters are read one by one so the interrupts are only blocked for
+	a single copy and no snapshot of the whole block is kept on the stack
+*/
+/*@
+	requires bIndex < TELEMETRY_COUNTERS;
+	assigns \nothing;
+*/
+uint32_t telemetryRead(uint8_t bIndex);
+
+/*@
+	assigns telemetryCounters;
+*/
+void telemetryReset();
+
+#ifdef __cplusplus
+	} /* extern "C" { */
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <stdint.h>
+
+#include "./main.h"
+#include "./sysclk.h"
+#include "./adc.h"
+#include "./telemetry.h"
+#include "./trigger.h"
+
+/*
+	Trigger output module
+
+	Timer2 runs in CTC mode with a period of 1 ms. Its compare interrupt
+	is only enabled while the output is asserted and counts down the
+	debounce time.
+*/
+
+#define TRIGGER_TIMER2_TOP		((F_CPU / 128L / 1000L) - 1)
+
+volatile uint16_t triggerDebounceRemaining;
+volatile uint16_t triggerLatencyLast;
+volatile uint16_t triggerLatencyMax;
+
+/*@
+	assigns triggerDebounceRemaining;
+	assigns PORTB;
+	assigns TIMSK2;
+*/
+ISR(TIMER2_COMPA_vect) {
+	uint16_t remaining = triggerDebounceRemaining;
+
+	if(remaining > 1) {
+		triggerDebounceRemaining = remaining - 1;
+		return;
+	}
+
+	/*
+		Debounce time is over. While the external probe is still active
+		in a mode that passes it through we keep the output asserted
+	*/
+	if(((currentSettings.trigMode == triggerMode_Capacitive) || (currentSettings.trigMode == triggerMode_PiezoOrCapacitive)) && ((PINB & 0x04) != 0)) {
+		triggerDebounceRemaining = (currentSettings.debounceLength > 0) ? currentSettings.debounceLength : 1;
+		return;
+	}
+
+	triggerDebounceRemaining = 0;
+	TIMSK2 = TIMSK2 & (~0x02);
+	PORTB = PORTB & (~0x02);
+
+	/* Piezo events that arrived during the debounce time fire again */
+	triggerEvaluate(0, false, false);
+}
+
+/*
+	External probe on PB2 (PCINT2)
+*/
+ISR(PCINT0_vect) {
+	triggerEvaluate(0, false, false);
+}
+
+void triggerInit() {
+	uint8_t sregOld = SREG;
+
+	#ifndef FRAMAC_SKIP
+		cli();
+	#endif
+
+	triggerDebounceRemaining = 0;
+	triggerLatencyLast = 0;
+	triggerLatencyMax = 0;
+
+	PRR = PRR & (~0x40);
+
+	TCCR2A = 0x02;					/* CTC mode */
+	TCCR2B = 0x05;					/* /128 prescaler */
+	OCR2A = TRIGGER_TIMER2_TOP;		/* 1 ms period */
+	TIMSK2 = 0x00;					/* Compare interrupt only enabled while asserted */
+
+	PCMSK0 = PCMSK0 | 0x04;			/* PCINT2 (PB2) */
+	PCIFR = 0x01;
+	PCICR = PCICR | 0x01;
+
+	SREG = sregOld;
+}
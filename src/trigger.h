@@ -0,0 +1,98 @@
+#ifndef __is_included__7a62b8dc_ca75_11f1_b2a3_02fc00000001
+#define __is_included__7a62b8dc_ca75_11f1_b2a3_02fc00000001 1
+
+/*
+	Trigger output logic
+
+	The decision whether the output (PB1) has to be asserted is taken
+	directly inside the interrupt that observed the event - the ADC
+	interrupt for piezo events and the pin change interrupt for the
+	external probe (PB2). Releasing the output after the debounce time
+	is done by the Timer2 compare interrupt (1 ms tick) so the main loop
+	is not involved at all.
+
+	Requires main.h, adc.h, sysclk.h and telemetry.h to be included before.
+*/
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+extern struct eepromSettings currentSettings;
+
+extern volatile uint16_t triggerDebounceRemaining;		/* Milliseconds till the output is released, 0 if not asserted */
+extern volatile uint16_t triggerLatencyLast;			/* Cycles between ADC interrupt entry and output edge of last piezo trigger */
+extern volatile uint16_t triggerLatencyMax;				/* Maximum of the above since last readout */
+
+/*@
+	assigns TCCR2A, TCCR2B, OCR2A, TIMSK2;
+	assigns PCMSK0, PCICR;
+	assigns triggerDebounceRemaining;
+*/
+void triggerInit();
+
+/*
+	Asserts the output and starts the debounce timer. Only called from
+	interrupt context
+*/
+static inline void triggerAssert() {
+	PORTB = PORTB | 0x02;
+	adcTriggered = false;
+
+	telemetryCounters.dwTriggers[currentSettings.trigMode & 0x03] = telemetryCounters.dwTriggers[currentSettings.trigMode & 0x03] + 1;
+
+	triggerDebounceRemaining = (currentSettings.debounceLength > 0) ? currentSettings.debounceLength : 1;
+
+	/* Restart the 1 ms tick and enable the compare interrupt */
+	TCNT2 = 0;
+	TIFR2 = 0x02;
+	TIMSK2 = TIMSK2 | 0x02;
+}
+
+/*
+	Evaluate the current trigger mode. Called from interrupt context
+	whenever one of the sources might have changed. tsStart is the cycle
+	counter value at the entry of the ADC interrupt that caused the call
+	and is used for the latency statistics (pass 0 together with
+	bMeasure = false for other sources). bNewDetection is only set for
+	the sample on which the detector raised a new event, so a detection
+	suppressed by the debounce time is counted once and not for every
+	conversion while adcTriggered stays pending
+*/
+static inline void triggerEvaluate(uint16_t tsStart, bool bMeasure, bool bNewDetection) {
+	bool bFire;
+
+	if(triggerDebounceRemaining != 0) {
+		if(bNewDetection) {
+			/* Piezo detection while the output is still asserted */
+			telemetryCounters.dwDebounceSuppressed = telemetryCounters.dwDebounceSuppressed + 1;
+		}
+		return; /* Output is still asserted */
+	}
+
+	switch(currentSettings.trigMode) {
+		case triggerMode_PiezoOnly:			bFire = (adcTriggered != false); break;
+		case triggerMode_PiezoVeto:			bFire = (adcTriggered != false) && ((PINB & 0x04) != 0); break;
+		case triggerMode_Capacitive:		bFire = ((PINB & 0x04) != 0); bMeasure = false; break;
+		case triggerMode_PiezoOrCapacitive:	bFire = (adcTriggered != false) || ((PINB & 0x04) != 0); break;
+		default:							bFire = false; break;
+	}
+
+	if(bFire) {
+		triggerAssert();
+
+		if(bMeasure) {
+			uint16_t latency = cycleCounterElapsed(tsStart);
+			triggerLatencyLast = latency;
+			if(latency > triggerLatencyMax) {
+				triggerLatencyMax = latency;
+			}
+		}
+	}
+}
+
+#ifdef __cplusplus
+	} /* extern "C" { */
+#endif
+
+#endif